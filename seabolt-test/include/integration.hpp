@@ -41,6 +41,7 @@ extern "C" {
 #define BOLT_IPV4_HOST  SETTING("BOLT_IPV4_HOST", "127.0.0.1")
 #define BOLT_IPV6_HOST  SETTING("BOLT_IPV6_HOST", "::1")
 #define BOLT_PORT       SETTING("BOLT_PORT", "7687")
+#define BOLT_UNIX_PATH  SETTING("BOLT_UNIX_PATH", "/tmp/bolt.sock")
 #define BOLT_USER       SETTING("BOLT_USER", "neo4j")
 #define BOLT_PASSWORD   SETTING("BOLT_PASSWORD", "password")
 #define BOLT_USER_AGENT SETTING("BOLT_USER_AGENT", "seabolt/1.0.0a")
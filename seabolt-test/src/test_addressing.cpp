@@ -104,3 +104,20 @@ SCENARIO("Test address resolution (IPv4 and IPv6)", "[dns]")
     }
     BoltAddress_destroy(address);
 }
+
+SCENARIO("Test address resolution (Unix domain socket)", "[unix]")
+{
+    const char * host = "/var/run/neo4j/bolt.sock";
+    struct BoltAddress * address = BoltAddress_create(host, "7687");
+    for (int i = 0; i < 2; i++)
+    {
+        REQUIRE(BoltAddress_resolve_b(address) == 0);
+        REQUIRE(address->n_resolved_hosts == 1);
+        char host_string[108];
+        int af = BoltAddress_copy_resolved_host(address, 0, &host_string[0], sizeof(host_string));
+        REQUIRE(af == AF_UNIX);
+        REQUIRE(strcmp(host_string, host) == 0);
+        REQUIRE(address->resolved_port == 0);
+    }
+    BoltAddress_destroy(address);
+}
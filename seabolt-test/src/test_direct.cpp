@@ -18,9 +18,20 @@
  */
 
 
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include "integration.hpp"
 #include "catch.hpp"
 
+extern "C" {
+    #include "bolt/buffering.h"
+    #include "bolt/mem.h"
+}
+
 
 SCENARIO("Test basic secure connection (IPv4)", "[integration][ipv4][secure]")
 {
@@ -62,6 +73,71 @@ SCENARIO("Test basic secure connection (IPv6)", "[integration][ipv6][secure]")
     }
 }
 
+SCENARIO("Test secure connection with restricted TLS versions", "[integration][ipv6][secure]")
+{
+    GIVEN("a local server address and a security context")
+    {
+        struct BoltAddress * address = bolt_get_address(BOLT_IPV6_HOST, BOLT_PORT);
+        struct BoltSecurityContext * context = BoltSecurityContext_create();
+        WHEN("an invalid version range is set")
+        {
+            THEN("the range should be rejected")
+            {
+                REQUIRE(BoltSecurityContext_set_tls_versions(context, BOLT_TLS_1_3, BOLT_TLS_1_2) == -1);
+                REQUIRE(BoltSecurityContext_set_tls_versions(context, 0x0301, BOLT_TLS_1_3) == -1);
+            }
+        }
+        WHEN("a secure connection is opened with versions restricted to TLS 1.2")
+        {
+            REQUIRE(BoltSecurityContext_set_tls_versions(context, BOLT_TLS_1_2, BOLT_TLS_1_2) == 0);
+            struct BoltConnection * connection = BoltConnection_create();
+            connection->security_context = context;
+            BoltConnection_open_b(connection, BOLT_SECURE_SOCKET, address);
+            THEN("the connection should be secured using TLS 1.2")
+            {
+                REQUIRE(connection->status == BOLT_CONNECTED);
+                REQUIRE(connection->metrics.tls_version == BOLT_TLS_1_2);
+            }
+            BoltConnection_close_b(connection);
+            BoltConnection_destroy(connection);
+        }
+        BoltSecurityContext_destroy(context);
+        BoltAddress_destroy(address);
+    }
+}
+
+SCENARIO("Test secure connection with kernel TLS offload requested", "[integration][ipv6][secure]")
+{
+    GIVEN("a local server address and a security context with kernel TLS enabled")
+    {
+        struct BoltAddress * address = bolt_get_address(BOLT_IPV6_HOST, BOLT_PORT);
+        struct BoltSecurityContext * context = BoltSecurityContext_create();
+        REQUIRE(BoltSecurityContext_set_kernel_tls(context, 1) == 0);
+        WHEN("a secure connection is opened and used")
+        {
+            struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+            struct BoltConnection * connection = BoltConnection_create();
+            connection->security_context = context;
+            BoltConnection_open_b(connection, BOLT_SECURE_SOCKET, address);
+            BoltConnection_init_b(connection, &profile);
+            BoltConnection_cypher(connection, "UNWIND range(1, 1000) AS n RETURN n", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            THEN("data should be exchanged whether or not the kernel supports offload")
+            {
+                REQUIRE(connection->status == BOLT_READY);
+                REQUIRE(BoltConnection_fetch_summary_b(connection, pull) == 1000);
+            }
+            BoltConnection_close_b(connection);
+            BoltConnection_destroy(connection);
+        }
+        BoltSecurityContext_destroy(context);
+        BoltAddress_destroy(address);
+    }
+}
+
 SCENARIO("Test basic insecure connection (IPv4)", "[integration][ipv4][insecure]")
 {
     GIVEN("a local server address")
@@ -102,6 +178,78 @@ SCENARIO("Test basic insecure connection (IPv6)", "[integration][ipv6][insecure]
     }
 }
 
+SCENARIO("Test basic Unix domain socket connection", "[integration][unix]")
+{
+    GIVEN("a local server socket path")
+    {
+        struct BoltAddress * address = bolt_get_address(BOLT_UNIX_PATH, BOLT_PORT);
+        WHEN("a Unix domain socket connection is opened and initialised")
+        {
+            struct BoltConnection * connection = BoltConnection_create();
+            BoltConnection_open_b(connection, BOLT_UNIX_SOCKET, address);
+            BoltConnection_init_b(connection, &BOLT_PROFILE);
+            THEN("the connection should be ready")
+            {
+                REQUIRE(connection->status == BOLT_READY);
+            }
+            BoltConnection_close_b(connection);
+            BoltConnection_destroy(connection);
+        }
+        WHEN("a TCP connection is opened to the socket path")
+        {
+            struct BoltConnection * connection = BoltConnection_create();
+            BoltConnection_open_b(connection, BOLT_SOCKET, address);
+            THEN("the connection should be rejected as unsupported")
+            {
+                REQUIRE(connection->status == BOLT_DEFUNCT);
+                REQUIRE(connection->error == BOLT_UNSUPPORTED);
+            }
+            BoltConnection_close_b(connection);
+            BoltConnection_destroy(connection);
+        }
+        BoltAddress_destroy(address);
+    }
+}
+
+SCENARIO("Test socket options applied on open", "[integration][ipv4][insecure]")
+{
+    GIVEN("a local server address")
+    {
+        struct BoltAddress * address = bolt_get_address(BOLT_IPV4_HOST, BOLT_PORT);
+        struct BoltConnection * connection = BoltConnection_create();
+        int value = 0;
+        socklen_t value_size = sizeof(value);
+        WHEN("a connection is opened with default options")
+        {
+            BoltConnection_open_b(connection, BOLT_SOCKET, address);
+            THEN("delays should be disabled")
+            {
+                REQUIRE(connection->status == BOLT_CONNECTED);
+                getsockopt(connection->socket, IPPROTO_TCP, TCP_NODELAY, &value, &value_size);
+                REQUIRE(value != 0);
+            }
+        }
+        WHEN("a connection is opened with adjusted bulk throughput options")
+        {
+            BoltSocketOptions_preset(&connection->socket_options, BOLT_SOCKET_BULK_THROUGHPUT);
+            connection->socket_options.no_delay = 0;
+            connection->socket_options.user_timeout = 5000;
+            BoltConnection_open_b(connection, BOLT_SOCKET, address);
+            THEN("the adjusted options should be applied")
+            {
+                REQUIRE(connection->status == BOLT_CONNECTED);
+                getsockopt(connection->socket, IPPROTO_TCP, TCP_NODELAY, &value, &value_size);
+                REQUIRE(value == 0);
+                getsockopt(connection->socket, IPPROTO_TCP, TCP_USER_TIMEOUT, &value, &value_size);
+                REQUIRE(value == 5000);
+            }
+        }
+        BoltConnection_close_b(connection);
+        BoltConnection_destroy(connection);
+        BoltAddress_destroy(address);
+    }
+}
+
 SCENARIO("Test secure connection to dead port", "[integration][ipv6][secure]")
 {
     GIVEN("a local server address")
@@ -339,6 +487,149 @@ SCENARIO("Test parameterised Cypher statements", "[integration][ipv6][secure]")
     }
 }
 
+SCENARIO("Test transmission of large parameter values", "[integration][ipv6][secure]")
+{
+    GIVEN("an open and initialised connection")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SECURE_SOCKET, BOLT_IPV6_HOST, BOLT_PORT, &profile);
+        WHEN("a statement with a large string parameter is executed")
+        {
+            const int size = 40000;
+            char * data = (char *)(malloc(size));
+            memset(data, 'x', size);
+            BoltConnection_cypher(connection, "RETURN size($x)", 1);
+            BoltValue * x = BoltConnection_cypher_parameter(connection, 0, "x");
+            BoltValue_to_String(x, data, size);
+            free(data);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            THEN("the server should receive the whole value")
+            {
+                struct BoltValue * last_received = BoltConnection_data(connection);
+                REQUIRE(BoltConnection_fetch_b(connection, pull) == 1);
+                REQUIRE(BoltInt64_get(BoltList_value(last_received, 0)) == size);
+                REQUIRE(BoltConnection_fetch_b(connection, pull) == 0);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
+SCENARIO("Test zero-copy transmission of large parameter values", "[integration][ipv4][insecure]")
+{
+    GIVEN("a connection that sends large writes without copying")
+    {
+        struct BoltAddress * address = bolt_get_address(BOLT_IPV4_HOST, BOLT_PORT);
+        struct BoltConnection * connection = BoltConnection_create();
+        connection->socket_options.zero_copy_threshold = 64 * 1024;
+        BoltConnection_open_b(connection, BOLT_SOCKET, address);
+        BoltConnection_init_b(connection, &BOLT_PROFILE);
+        WHEN("statements with large string parameters are executed one after another")
+        {
+            const int size = 4 * 1024 * 1024;
+            char * data = (char *)(malloc(size));
+            struct BoltValue * last_received = BoltConnection_data(connection);
+            for (int i = 0; i < 2; i++)
+            {
+                memset(data, 'a' + i, size);
+                BoltConnection_cypher(connection, "RETURN size($x)", 1);
+                BoltValue_to_String(BoltConnection_cypher_parameter(connection, 0, "x"), data, size - i);
+                BoltConnection_load_run_request(connection);
+                BoltConnection_load_pull_request(connection, -1);
+                bolt_request_t pull = BoltConnection_last_request(connection);
+                REQUIRE(BoltConnection_send_b(connection) == 0);
+                REQUIRE(BoltConnection_fetch_b(connection, pull) == 1);
+                REQUIRE(BoltInt64_get(BoltList_value(last_received, 0)) == size - i);
+                REQUIRE(BoltConnection_fetch_b(connection, pull) == 0);
+            }
+            free(data);
+            THEN("the values should be sent without copying and their memory released")
+            {
+                REQUIRE(connection->status == BOLT_READY);
+                REQUIRE(connection->metrics.bytes_sent_zero_copy > 0);
+                REQUIRE(BoltConnection_reclaim_b(connection) == 0);
+                REQUIRE(connection->zero_copy_releases == connection->zero_copy_sends);
+            }
+        }
+        BoltConnection_close_b(connection);
+        BoltConnection_destroy(connection);
+        BoltAddress_destroy(address);
+    }
+}
+
+SCENARIO("Test transmission of messages larger than a single chunk", "[integration][ipv6][secure]")
+{
+    GIVEN("an open and initialised connection")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SECURE_SOCKET, BOLT_IPV6_HOST, BOLT_PORT, &profile);
+        WHEN("a statement with a list parameter of over 64 KiB is executed")
+        {
+            const int size = 100000;
+            BoltConnection_cypher(connection, "RETURN size($x)", 1);
+            BoltValue * x = BoltConnection_cypher_parameter(connection, 0, "x");
+            BoltValue_to_List(x, size);
+            for (int i = 0; i < size; i++)
+            {
+                BoltValue_to_Int64(BoltList_value(x, i), 1000 + i);
+            }
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            THEN("the server should receive the whole list")
+            {
+                struct BoltValue * last_received = BoltConnection_data(connection);
+                REQUIRE(BoltConnection_fetch_b(connection, pull) == 1);
+                REQUIRE(BoltInt64_get(BoltList_value(last_received, 0)) == size);
+                REQUIRE(BoltConnection_fetch_b(connection, pull) == 0);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
+SCENARIO("Test reception of values spanning several chunks", "[integration][ipv6][secure]")
+{
+    GIVEN("an open and initialised connection")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SECURE_SOCKET, BOLT_IPV6_HOST, BOLT_PORT, &profile);
+        WHEN("a large string value is returned")
+        {
+            const int size = 30000;
+            char * data = (char *)(malloc(size));
+            for (int i = 0; i < size; i++)
+            {
+                data[i] = (char)('a' + i % 26);
+            }
+            BoltConnection_cypher(connection, "RETURN $x", 1);
+            BoltValue_to_String(BoltConnection_cypher_parameter(connection, 0, "x"), data, size);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            THEN("the value should be received intact")
+            {
+                struct BoltValue * last_received = BoltConnection_data(connection);
+                REQUIRE(BoltConnection_fetch_b(connection, pull) == 1);
+                struct BoltValue * value = BoltList_value(last_received, 0);
+                REQUIRE(BoltValue_type(value) == BOLT_STRING);
+                REQUIRE(value->size == size);
+                REQUIRE(memcmp(BoltString_get(value), data, (size_t)(size)) == 0);
+                REQUIRE(BoltConnection_fetch_b(connection, pull) == 0);
+            }
+            free(data);
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
 SCENARIO("Test execution of multiple Cypher statements transmitted together", "[integration][ipv6][secure]")
 {
     GIVEN("an open and initialised connection")
@@ -364,6 +655,85 @@ SCENARIO("Test execution of multiple Cypher statements transmitted together", "[
     }
 }
 
+SCENARIO("Test transmission of pipelined requests under a flush policy", "[integration][ipv6][secure]")
+{
+    GIVEN("an open and initialised connection that corks and flushes every 1000 bytes")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SECURE_SOCKET, BOLT_IPV6_HOST, BOLT_PORT, &profile);
+        connection->flush_policy.cork = 1;
+        connection->flush_policy.max_bytes = 1000;
+        WHEN("many requests are loaded")
+        {
+            unsigned long long bytes_sent = connection->metrics.bytes_sent;
+            BoltConnection_cypher(connection, "RETURN $x", 1);
+            BoltValue * x = BoltConnection_cypher_parameter(connection, 0, "x");
+            for (int i = 0; i < 100; i++)
+            {
+                BoltValue_to_Int32(x, i);
+                BoltConnection_load_run_request(connection);
+                BoltConnection_load_pull_request(connection, -1);
+            }
+            THEN("transmission should start before an explicit send")
+            {
+                REQUIRE(connection->metrics.bytes_sent > bytes_sent);
+                REQUIRE(connection->n_tx_bytes < 1000);
+            }
+            BoltConnection_send_b(connection);
+            THEN("all requests should complete once sent")
+            {
+                int records = BoltConnection_fetch_summary_b(connection, BoltConnection_last_request(connection));
+                REQUIRE(records == 1);
+                REQUIRE(connection->corked == 0);
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
+SCENARIO("Test transmission of a large batch of requests under a high-water mark", "[integration][ipv4][insecure]")
+{
+    GIVEN("an open and initialised connection with a high-water mark of 64 KiB")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        connection->flush_policy.high_water = 65536;
+        WHEN("more requests are loaded than fit below the mark")
+        {
+            // A small send buffer keeps the queue from ever emptying
+            int send_buffer_size = 4096;
+            setsockopt(connection->socket, SOL_SOCKET, SO_SNDBUF, &send_buffer_size, sizeof(send_buffer_size));
+            int max_queued = 0;
+            int max_buffer = 0;
+            BoltConnection_cypher(connection, "RETURN $x", 1);
+            BoltValue * x = BoltConnection_cypher_parameter(connection, 0, "x");
+            for (int i = 0; i < 20000; i++)
+            {
+                BoltValue_to_Int32(x, i);
+                BoltConnection_load_run_request(connection);
+                BoltConnection_load_pull_request(connection, -1);
+                max_queued = connection->n_tx_bytes > max_queued ? connection->n_tx_bytes : max_queued;
+                max_buffer = connection->tx_buffer->size > max_buffer ? connection->tx_buffer->size : max_buffer;
+                for (int j = 0; j < connection->n_tx_segments; j++)
+                {
+                    int size = connection->tx_segments[j].buffer->size;
+                    max_buffer = size > max_buffer ? size : max_buffer;
+                }
+            }
+            BoltConnection_send_b(connection);
+            int records = BoltConnection_fetch_summary_b(connection, BoltConnection_last_request(connection));
+            THEN("the queue and its buffers should stay bounded and all requests should complete")
+            {
+                REQUIRE(max_queued < 65536);
+                REQUIRE(max_buffer <= 4 * 65536);
+                REQUIRE(records == 1);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
 SCENARIO("Test transactions", "[integration][ipv6][secure]")
 {
     GIVEN("an open and initialised connection")
@@ -423,3 +793,971 @@ SCENARIO("Test transactions", "[integration][ipv6][secure]")
         BoltConnection_close_b(connection);
     }
 }
+
+SCENARIO("Test fetching records in batches", "[integration][ipv4][insecure]")
+{
+    GIVEN("an open and initialised connection")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        WHEN("a large result is fetched in batches of up to 64 records")
+        {
+            BoltConnection_cypher(connection, "UNWIND range(1, 10000) AS n RETURN n", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            struct BoltValue * values[64];
+            for (int i = 0; i < 64; i++)
+            {
+                values[i] = BoltValue_create();
+            }
+            int64_t expected = 1;
+            int out_of_order = 0;
+            int max_batch = 0;
+            int fetched;
+            while ((fetched = BoltConnection_fetch_batch_b(connection, pull, values, 64)) > 0)
+            {
+                max_batch = fetched > max_batch ? fetched : max_batch;
+                for (int i = 0; i < fetched; i++)
+                {
+                    if (BoltValue_type(values[i]) != BOLT_LIST || values[i]->size != 1 ||
+                        BoltInt64_get(BoltList_value(values[i], 0)) != expected)
+                    {
+                        out_of_order += 1;
+                    }
+                    expected += 1;
+                }
+            }
+            THEN("every record should be fetched in order, several at a time, followed by the summary")
+            {
+                REQUIRE(fetched == 0);
+                REQUIRE(expected == 10001);
+                REQUIRE(out_of_order == 0);
+                REQUIRE(max_batch > 1);
+                REQUIRE(max_batch <= 64);
+                REQUIRE(BoltMessage_code(BoltConnection_data(connection)) == 0x70);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+            for (int i = 0; i < 64; i++)
+            {
+                BoltValue_destroy(values[i]);
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
+struct StreamTrace
+{
+    std::string events;
+    int64_t sum;
+};
+
+static struct BoltValueHandlers tracing_handlers()
+{
+    struct BoltValueHandlers handlers;
+    memset(&handlers, 0, sizeof(handlers));
+    handlers.on_null = [](void * context) { ((StreamTrace *)(context))->events += "null "; };
+    handlers.on_integer = [](void * context, int64_t value)
+    {
+        ((StreamTrace *)(context))->events += std::to_string(value) + " ";
+        ((StreamTrace *)(context))->sum += value;
+    };
+    handlers.on_string = [](void * context, const char * data, int32_t size)
+    {
+        ((StreamTrace *)(context))->events += "'" + std::string(data, (size_t)(size)) + "' ";
+    };
+    handlers.begin_list = [](void * context, int32_t size)
+    {
+        ((StreamTrace *)(context))->events += "[" + std::to_string(size) + " ";
+    };
+    handlers.end_list = [](void * context) { ((StreamTrace *)(context))->events += "] "; };
+    handlers.begin_map = [](void * context, int32_t size)
+    {
+        ((StreamTrace *)(context))->events += "{" + std::to_string(size) + " ";
+    };
+    handlers.end_map = [](void * context) { ((StreamTrace *)(context))->events += "} "; };
+    handlers.begin_structure = [](void * context, int16_t code, int32_t size)
+    {
+        ((StreamTrace *)(context))->events += std::string(1, (char)(code)) + "(" + std::to_string(size) + " ";
+    };
+    handlers.end_structure = [](void * context) { ((StreamTrace *)(context))->events += ") "; };
+    return handlers;
+}
+
+SCENARIO("Test skipping unconsumed records", "[integration][ipv4][insecure]")
+{
+    GIVEN("an open and initialised connection")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        WHEN("the records of an earlier result are left unconsumed")
+        {
+            BoltConnection_cypher(connection, "UNWIND range(1, 5000) AS n RETURN n", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            BoltConnection_cypher(connection, "UNWIND range(7, 9) AS n RETURN n", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            REQUIRE(BoltConnection_fetch_b(connection, pull) == 1);
+            THEN("fetching the later result should pass over them")
+            {
+                REQUIRE(BoltInt64_get(BoltList_value(BoltConnection_data(connection), 0)) == 7);
+                REQUIRE(BoltConnection_fetch_summary_b(connection, pull) == 2);
+                REQUIRE(BoltMessage_code(BoltConnection_data(connection)) == 0x70);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
+struct SpillTrace
+{
+    int messages;
+    int bytes;
+};
+
+void trace_spill(void * context, bolt_request_t, const char *, int size)
+{
+    SpillTrace * trace = (SpillTrace *)(context);
+    trace->messages += 1;
+    trace->bytes += size;
+}
+
+SCENARIO("Test consuming pipelined results out of order", "[integration][ipv4][insecure]")
+{
+    GIVEN("an open and initialised connection that retains responses")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        connection->retention_policy.retain = 1;
+        const char * statements[] = {
+            "UNWIND range(1, 3) AS n RETURN n",
+            "UNWIND range(4, 6) AS n RETURN n",
+            "UNWIND range(7, 1000) AS n RETURN n",
+        };
+        bolt_request_t pulls[3];
+        for (int i = 0; i < 3; i++)
+        {
+            BoltConnection_cypher(connection, statements[i], 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            pulls[i] = BoltConnection_last_request(connection);
+        }
+        BoltConnection_send_b(connection);
+        WHEN("the results are fetched in reverse order")
+        {
+            int64_t sums[3] = { 0, 0, 0 };
+            int records[3] = { 0, 0, 0 };
+            for (int i = 2; i >= 0; i--)
+            {
+                while (BoltConnection_fetch_b(connection, pulls[i]) == 1)
+                {
+                    sums[i] += BoltInt64_get(BoltList_value(BoltConnection_data(connection), 0));
+                    records[i] += 1;
+                }
+                REQUIRE(BoltMessage_code(BoltConnection_data(connection)) == 0x70);
+            }
+            THEN("each result should be returned in full")
+            {
+                REQUIRE(records[0] == 3);
+                REQUIRE(sums[0] == 6);
+                REQUIRE(records[1] == 3);
+                REQUIRE(sums[1] == 15);
+                REQUIRE(records[2] == 994);
+                REQUIRE(sums[2] == 500479);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+        }
+        WHEN("the earlier results are fetched in batches after the last")
+        {
+            while (BoltConnection_fetch_b(connection, pulls[2]) == 1)
+            {
+            }
+            struct BoltValue * values[8];
+            for (int i = 0; i < 8; i++)
+            {
+                values[i] = BoltValue_create();
+            }
+            int64_t sums[2] = { 0, 0 };
+            int batches[2] = { 0, 0 };
+            for (int i = 0; i < 2; i++)
+            {
+                int fetched;
+                while ((fetched = BoltConnection_fetch_batch_b(connection, pulls[i], values, 8)) > 0)
+                {
+                    for (int j = 0; j < fetched; j++)
+                    {
+                        sums[i] += BoltInt64_get(BoltList_value(values[j], 0));
+                    }
+                    batches[i] += 1;
+                }
+                REQUIRE(fetched == 0);
+                REQUIRE(BoltMessage_code(BoltConnection_data(connection)) == 0x70);
+            }
+            THEN("each retained result should be fetched in a single batch")
+            {
+                REQUIRE(sums[0] == 6);
+                REQUIRE(batches[0] == 1);
+                REQUIRE(sums[1] == 15);
+                REQUIRE(batches[1] == 1);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+            for (int i = 0; i < 8; i++)
+            {
+                BoltValue_destroy(values[i]);
+            }
+        }
+        WHEN("later results are fetched out of order while an earlier result stays queued")
+        {
+            REQUIRE(BoltConnection_fetch_summary_b(connection, pulls[2]) == 994);
+            REQUIRE(BoltConnection_fetch_summary_b(connection, pulls[1]) == 3);
+            size_t allocation = 0;
+            int64_t sum = 0;
+            for (int i = 0; i < 200; i++)
+            {
+                bolt_request_t runs[2];
+                bolt_request_t later[2];
+                for (int j = 0; j < 2; j++)
+                {
+                    BoltConnection_cypher(connection, "UNWIND range(1, 100) AS n RETURN n", 0);
+                    BoltConnection_load_run_request(connection);
+                    runs[j] = BoltConnection_last_request(connection);
+                    BoltConnection_load_pull_request(connection, -1);
+                    later[j] = BoltConnection_last_request(connection);
+                }
+                BoltConnection_send_b(connection);
+                REQUIRE(BoltConnection_fetch_summary_b(connection, later[1]) == 100);
+                REQUIRE(BoltConnection_fetch_summary_b(connection, runs[1]) == 0);
+                REQUIRE(BoltConnection_fetch_summary_b(connection, runs[0]) == 0);
+                while (BoltConnection_fetch_b(connection, later[0]) == 1)
+                {
+                    sum += BoltInt64_get(BoltList_value(BoltConnection_data(connection), 0));
+                }
+                if (i == 20)
+                {
+                    allocation = BoltMem_current_allocation();
+                }
+            }
+            THEN("the space taken by fetched responses should be reused")
+            {
+                REQUIRE(sum == 200 * 5050);
+                REQUIRE(BoltMem_current_allocation() <= allocation + 4096);
+                int64_t earliest = 0;
+                while (BoltConnection_fetch_b(connection, pulls[0]) == 1)
+                {
+                    earliest += BoltInt64_get(BoltList_value(BoltConnection_data(connection), 0));
+                }
+                REQUIRE(earliest == 6);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+        }
+        WHEN("a later result is fetched with a spilling limit on retained responses")
+        {
+            SpillTrace trace { 0, 0 };
+            connection->retention_policy.max_bytes = 16;
+            connection->retention_policy.spill = trace_spill;
+            connection->retention_policy.context = &trace;
+            REQUIRE(BoltConnection_fetch_summary_b(connection, pulls[2]) == 994);
+            THEN("responses beyond the limit should be spilled and no longer be fetched")
+            {
+                REQUIRE(trace.messages > 0);
+                REQUIRE(trace.bytes > 0);
+                int records = 0;
+                while (BoltConnection_fetch_b(connection, pulls[0]) == 1)
+                {
+                    records += 1;
+                }
+                REQUIRE(records <= 3);
+            }
+        }
+        WHEN("a later result is fetched with a limit on retained responses and no spill callback")
+        {
+            connection->retention_policy.max_bytes = 16;
+            THEN("the fetch should fail")
+            {
+                REQUIRE(BoltConnection_fetch_b(connection, pulls[2]) == -1);
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
+struct CallbackTrace
+{
+    int64_t sum;
+    int records;
+    int successes;
+    int failures;
+    int ignored;
+    bolt_request_t last_request;
+};
+
+void trace_record(void * context, struct BoltConnection *, bolt_request_t request, struct BoltValue * fields)
+{
+    CallbackTrace * trace = (CallbackTrace *)(context);
+    trace->sum += BoltInt64_get(BoltList_value(fields, 0));
+    trace->records += 1;
+    trace->last_request = request;
+}
+
+void trace_success(void * context, struct BoltConnection *, bolt_request_t request, struct BoltValue *)
+{
+    CallbackTrace * trace = (CallbackTrace *)(context);
+    trace->successes += 1;
+    trace->last_request = request;
+}
+
+void trace_failure(void * context, struct BoltConnection *, bolt_request_t request, struct BoltValue *)
+{
+    CallbackTrace * trace = (CallbackTrace *)(context);
+    trace->failures += 1;
+    trace->last_request = request;
+}
+
+void trace_ignored(void * context, struct BoltConnection *, bolt_request_t request, struct BoltValue *)
+{
+    CallbackTrace * trace = (CallbackTrace *)(context);
+    trace->ignored += 1;
+    trace->last_request = request;
+}
+
+SCENARIO("Test dispatching pipelined responses to callbacks", "[integration][ipv4][insecure]")
+{
+    GIVEN("an open and initialised connection")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        CallbackTrace trace { 0, 0, 0, 0, 0, 0 };
+        struct BoltResponseCallbacks callbacks { &trace, trace_record, trace_success, trace_failure, trace_ignored };
+        WHEN("a deep pipeline of queries is loaded with callbacks")
+        {
+            for (int i = 1; i <= 200; i++)
+            {
+                BoltConnection_cypher(connection, "UNWIND range(1, 3) AS n RETURN n", 0);
+                BoltConnection_load_run_request(connection);
+                BoltConnection_load_pull_request(connection, -1);
+                REQUIRE(BoltConnection_set_callbacks(connection, BoltConnection_last_request(connection),
+                                                     &callbacks) == 0);
+            }
+            THEN("every response should be dispatched to its callbacks")
+            {
+                REQUIRE(BoltConnection_dispatch_b(connection) == 200);
+                REQUIRE(trace.records == 600);
+                REQUIRE(trace.sum == 1200);
+                REQUIRE(trace.successes == 200);
+                REQUIRE(trace.failures == 0);
+                REQUIRE(connection->n_pending_responses == 0);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+        }
+        WHEN("a failing query is loaded with callbacks, followed by the request to pull its result")
+        {
+            BoltConnection_cypher(connection, "FAIL", 0);
+            BoltConnection_load_run_request(connection);
+            bolt_request_t run = BoltConnection_last_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            REQUIRE(BoltConnection_set_callbacks(connection, run, &callbacks) == 0);
+            REQUIRE(BoltConnection_set_callbacks(connection, pull, &callbacks) == 0);
+            THEN("the failure and the request ignored after it should be told apart")
+            {
+                REQUIRE(BoltConnection_dispatch_b(connection) == 2);
+                REQUIRE(trace.failures == 1);
+                REQUIRE(trace.ignored == 1);
+                REQUIRE(trace.successes == 0);
+                REQUIRE(trace.last_request == pull);
+                REQUIRE(connection->status == BOLT_FAILED);
+            }
+        }
+        WHEN("callbacks are registered out of order")
+        {
+            BoltConnection_cypher(connection, "RETURN 1", 0);
+            BoltConnection_load_run_request(connection);
+            bolt_request_t run = BoltConnection_last_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            REQUIRE(BoltConnection_set_callbacks(connection, pull, &callbacks) == 0);
+            THEN("the registration should be refused")
+            {
+                REQUIRE(BoltConnection_set_callbacks(connection, run, &callbacks) == -1);
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
+SCENARIO("Test fetching results into columns", "[integration][ipv4][insecure]")
+{
+    GIVEN("an open and initialised connection")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        struct BoltValue * columns = BoltValue_create();
+        struct BoltValue * nulls = BoltValue_create();
+        WHEN("a large integer column is fetched")
+        {
+            BoltConnection_cypher(connection, "UNWIND range(1, 10000) AS n RETURN n", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            int rows = BoltConnection_fetch_columns_b(connection, pull, columns, nulls);
+            THEN("it should be returned as an array of integers without nulls")
+            {
+                REQUIRE(rows == 10000);
+                REQUIRE(columns->size == 1);
+                struct BoltValue * n = BoltList_value(columns, 0);
+                REQUIRE(BoltValue_type(n) == BOLT_INT64_ARRAY);
+                REQUIRE(n->size == 10000);
+                int64_t sum = 0;
+                for (int32_t i = 0; i < n->size; i++)
+                {
+                    sum += BoltInt64Array_get(n, i);
+                }
+                REQUIRE(sum == 50005000);
+                struct BoltValue * bitmap = BoltList_value(nulls, 0);
+                REQUIRE(BoltValue_type(bitmap) == BOLT_BYTE_ARRAY);
+                REQUIRE(bitmap->size == 1250);
+                REQUIRE(std::string(BoltByteArray_get_all(bitmap), 1250) == std::string(1250, '\0'));
+                REQUIRE(BoltMessage_code(BoltConnection_data(connection)) == 0x70);
+            }
+        }
+        WHEN("columns of each type are fetched")
+        {
+            BoltConnection_cypher(connection, "RETURN 1 AS a, 2.5 AS b, 'three' AS c, null AS d, [4] AS e", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            int rows = BoltConnection_fetch_columns_b(connection, pull, columns, nulls);
+            THEN("scalar columns should be typed and others should hold values")
+            {
+                REQUIRE(rows == 1);
+                REQUIRE(columns->size == 5);
+                REQUIRE(BoltValue_type(BoltList_value(columns, 0)) == BOLT_INT64_ARRAY);
+                REQUIRE(BoltInt64Array_get(BoltList_value(columns, 0), 0) == 1);
+                REQUIRE(BoltValue_type(BoltList_value(columns, 1)) == BOLT_FLOAT64_ARRAY);
+                REQUIRE(BoltFloat64Array_get(BoltList_value(columns, 1), 0) == 2.5);
+                REQUIRE(BoltValue_type(BoltList_value(columns, 2)) == BOLT_STRING_ARRAY);
+                REQUIRE(std::string(BoltStringArray_get(BoltList_value(columns, 2), 0), 5) == "three");
+                REQUIRE(BoltValue_type(BoltList_value(columns, 3)) == BOLT_LIST);
+                REQUIRE(BoltByteArray_get(BoltList_value(nulls, 3), 0) == 1);
+                struct BoltValue * e = BoltList_value(columns, 4);
+                REQUIRE(BoltValue_type(e) == BOLT_LIST);
+                REQUIRE(BoltValue_type(BoltList_value(e, 0)) == BOLT_LIST);
+                REQUIRE(BoltInt64_get(BoltList_value(BoltList_value(e, 0), 0)) == 4);
+            }
+        }
+        WHEN("a float column beginning with nulls is fetched")
+        {
+            BoltConnection_cypher(connection, "UNWIND [null, null, 1.5, null, 2.5] AS x RETURN x", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            int rows = BoltConnection_fetch_columns_b(connection, pull, columns, nulls);
+            THEN("it should be returned as an array of floats with nulls marked")
+            {
+                REQUIRE(rows == 5);
+                struct BoltValue * x = BoltList_value(columns, 0);
+                REQUIRE(BoltValue_type(x) == BOLT_FLOAT64_ARRAY);
+                REQUIRE(x->size == 5);
+                REQUIRE(BoltFloat64Array_get(x, 2) == 1.5);
+                REQUIRE(BoltFloat64Array_get(x, 4) == 2.5);
+                REQUIRE(BoltByteArray_get(BoltList_value(nulls, 0), 0) == 0x0B);
+            }
+        }
+        WHEN("a column with nulls and mixed types is fetched")
+        {
+            BoltConnection_cypher(connection, "UNWIND [null, 1, 2, null, 'x', 3] AS x RETURN x", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            int rows = BoltConnection_fetch_columns_b(connection, pull, columns, nulls);
+            THEN("it should fall back to a list of values with nulls marked")
+            {
+                REQUIRE(rows == 6);
+                struct BoltValue * x = BoltList_value(columns, 0);
+                REQUIRE(BoltValue_type(x) == BOLT_LIST);
+                REQUIRE(x->size == 6);
+                REQUIRE(BoltValue_type(BoltList_value(x, 0)) == BOLT_NULL);
+                REQUIRE(BoltInt64_get(BoltList_value(x, 1)) == 1);
+                REQUIRE(BoltInt64_get(BoltList_value(x, 2)) == 2);
+                REQUIRE(BoltValue_type(BoltList_value(x, 3)) == BOLT_NULL);
+                REQUIRE(BoltValue_type(BoltList_value(x, 4)) == BOLT_STRING);
+                REQUIRE(BoltInt64_get(BoltList_value(x, 5)) == 3);
+                REQUIRE(BoltByteArray_get(BoltList_value(nulls, 0), 0) == 0x09);
+            }
+        }
+        BoltValue_destroy(nulls);
+        BoltValue_destroy(columns);
+        BoltConnection_close_b(connection);
+    }
+}
+
+SCENARIO("Test streaming records through value handlers", "[integration][ipv4][insecure]")
+{
+    GIVEN("an open and initialised connection with record handlers")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        StreamTrace trace { "", 0 };
+        struct BoltValueHandlers handlers = tracing_handlers();
+        handlers.context = &trace;
+        connection->record_handlers = &handlers;
+        WHEN("integers are streamed")
+        {
+            BoltConnection_cypher(connection, "UNWIND range(1, 1000) AS n RETURN n", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            int records = BoltConnection_fetch_summary_b(connection, pull);
+            THEN("each record should be passed to the handlers and not stored")
+            {
+                REQUIRE(records == 1000);
+                REQUIRE(trace.sum == 500500);
+                REQUIRE(trace.events.compare(0, 15, "[1 1 ] [1 2 ] [") == 0);
+                REQUIRE(BoltMessage_code(BoltConnection_data(connection)) == 0x70);
+            }
+        }
+        WHEN("nodes are streamed")
+        {
+            BoltConnection_cypher(connection, "MATCH (n) RETURN n", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            REQUIRE(BoltConnection_fetch_b(connection, pull) == 1);
+            THEN("structures, lists and maps should be announced with their contents")
+            {
+                REQUIRE(trace.events == "[1 N(3 1 [1 'Person' ] {3 'name' 'Alice' 'age' 33 'tags' [2 'a' 'b' ] } ) ] ");
+                REQUIRE(BoltValue_type(BoltConnection_data(connection)) == BOLT_NULL);
+            }
+        }
+        WHEN("a string spanning several chunks is streamed")
+        {
+            std::string text(100000, 'x');
+            BoltConnection_cypher(connection, "RETURN $x", 1);
+            BoltValue_to_String(BoltConnection_cypher_parameter(connection, 0, "x"), text.c_str(), (int32_t)(text.size()));
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            REQUIRE(BoltConnection_fetch_summary_b(connection, pull) == 1);
+            THEN("the string should be gathered whole")
+            {
+                REQUIRE(trace.events == "[1 '" + text + "' ] ");
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
+SCENARIO("Test lazy record decoding", "[integration][ipv4][insecure]")
+{
+    GIVEN("an open and initialised connection with lazy records")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        connection->lazy_records = 1;
+        WHEN("a wide record is fetched")
+        {
+            BoltConnection_cypher(connection, "RETURN 1 AS a, 'two' AS b, [3, 4.5, true] AS c, null AS d", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            REQUIRE(BoltConnection_fetch_b(connection, pull) == 1);
+            THEN("fields should be decoded as accessed, and all together once the record is")
+            {
+                struct BoltValue * c = BoltConnection_record_field(connection, 2);
+                REQUIRE(BoltValue_type(c) == BOLT_LIST);
+                REQUIRE(c->size == 3);
+                REQUIRE(BoltInt64_get(BoltList_value(c, 0)) == 3);
+                REQUIRE(BoltFloat64_get(BoltList_value(c, 1)) == 4.5);
+                REQUIRE(BoltBit_get(BoltList_value(c, 2)) == 1);
+                REQUIRE(BoltInt64_get(BoltConnection_record_field(connection, 0)) == 1);
+                REQUIRE(BoltValue_type(BoltConnection_record_field(connection, 3)) == BOLT_NULL);
+                REQUIRE(BoltConnection_record_field(connection, 4) == nullptr);
+                REQUIRE(BoltConnection_record_field(connection, -1) == nullptr);
+                struct BoltValue * data = BoltConnection_data(connection);
+                REQUIRE(BoltValue_type(data) == BOLT_LIST);
+                REQUIRE(data->size == 4);
+                REQUIRE(BoltList_value(data, 2) == c);
+                struct BoltValue * b = BoltList_value(data, 1);
+                REQUIRE(BoltValue_type(b) == BOLT_STRING);
+                REQUIRE(std::string(BoltString_get(b), (size_t)(b->size)) == "two");
+                REQUIRE(BoltConnection_record_field(connection, 1) == b);
+            }
+            REQUIRE(BoltConnection_fetch_summary_b(connection, pull) == 0);
+            REQUIRE(BoltConnection_record_field(connection, 0) == nullptr);
+        }
+        WHEN("nodes are fetched")
+        {
+            BoltConnection_cypher(connection, "MATCH (n) RETURN n", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            int nodes = 0;
+            while (BoltConnection_fetch_b(connection, pull) == 1)
+            {
+                struct BoltValue * node = BoltConnection_record_field(connection, 0);
+                if (node != nullptr && BoltValue_type(node) == BOLT_STRUCTURE && BoltStructure_code(node) == 'N' &&
+                    node->size == 3)
+                {
+                    nodes += 1;
+                }
+            }
+            THEN("each node should be decoded from its own record")
+            {
+                REQUIRE(nodes == 3);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+        }
+        WHEN("a string spanning several chunks is fetched")
+        {
+            std::string text(100000, 'x');
+            BoltConnection_cypher(connection, "RETURN $x", 1);
+            BoltValue_to_String(BoltConnection_cypher_parameter(connection, 0, "x"), text.c_str(), (int32_t)(text.size()));
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            REQUIRE(BoltConnection_fetch_b(connection, pull) == 1);
+            THEN("the string should be decoded whole")
+            {
+                struct BoltValue * x = BoltConnection_record_field(connection, 0);
+                REQUIRE(BoltValue_type(x) == BOLT_STRING);
+                REQUIRE(std::string(BoltString_get(x), (size_t)(x->size)) == text);
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
+SCENARIO("Test running prepared statements", "[integration][ipv4][insecure]")
+{
+    GIVEN("two open and initialised connections and a statement")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connections[2];
+        connections[0] = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        connections[1] = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        const char * keys[] = { "x" };
+        const char * cypher = "RETURN $x AS x";
+        struct BoltStatement * statement = BoltStatement_create(cypher, strlen(cypher), keys, 1);
+        REQUIRE(statement != nullptr);
+        struct BoltValue * parameters = BoltValue_create();
+        BoltValue_to_List(parameters, 1);
+        WHEN("the statement is run repeatedly on both connections")
+        {
+            int64_t sum = 0;
+            for (int i = 0; i < 10; i++)
+            {
+                struct BoltConnection * connection = connections[i % 2];
+                BoltValue_to_Int64(BoltList_value(parameters, 0), i);
+                REQUIRE(BoltConnection_load_statement_run_request(connection, statement, parameters) == 0);
+                BoltConnection_load_pull_request(connection, -1);
+                bolt_request_t pull = BoltConnection_last_request(connection);
+                BoltConnection_send_b(connection);
+                REQUIRE(BoltConnection_fetch_b(connection, pull) == 1);
+                sum += BoltInt64_get(BoltList_value(BoltConnection_data(connection), 0));
+                REQUIRE(BoltConnection_fetch_summary_b(connection, pull) == 0);
+            }
+            THEN("each run should return its own parameter value")
+            {
+                REQUIRE(sum == 45);
+                REQUIRE(connections[0]->status == BOLT_READY);
+                REQUIRE(connections[1]->status == BOLT_READY);
+            }
+        }
+        WHEN("the parameters do not match the statement")
+        {
+            BoltValue_to_List(parameters, 2);
+            THEN("the request should not be loaded")
+            {
+                REQUIRE(BoltConnection_load_statement_run_request(connections[0], statement, parameters) == -1);
+                REQUIRE(BoltConnection_load_statement_run_request(connections[0], statement, nullptr) == -1);
+            }
+        }
+        BoltValue_destroy(parameters);
+        BoltStatement_destroy(statement);
+        BoltConnection_close_b(connections[1]);
+        BoltConnection_close_b(connections[0]);
+    }
+}
+
+SCENARIO("Test writing parameters directly", "[integration][ipv4][insecure]")
+{
+    GIVEN("an open and initialised connection")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        WHEN("a map parameter is written value by value")
+        {
+            const char * cypher = "RETURN $x AS x";
+            REQUIRE(BoltConnection_begin_run_request(connection, cypher, strlen(cypher), 1) == 0);
+            REQUIRE(BoltConnection_write_key(connection, "x", 1) == 0);
+            REQUIRE(BoltConnection_write_map(connection, 2) == 0);
+            REQUIRE(BoltConnection_write_key(connection, "name", 4) == 0);
+            REQUIRE(BoltConnection_write_string(connection, "Alice", 5) == 0);
+            REQUIRE(BoltConnection_write_key(connection, "scores", 6) == 0);
+            REQUIRE(BoltConnection_write_list(connection, 3) == 0);
+            REQUIRE(BoltConnection_write_integer(connection, 1) == 0);
+            REQUIRE(BoltConnection_write_float(connection, 2.5) == 0);
+            REQUIRE(BoltConnection_write_null(connection) == 0);
+            REQUIRE(BoltConnection_end_run_request(connection) == 0);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            THEN("the parameter should be returned as written")
+            {
+                REQUIRE(BoltConnection_fetch_b(connection, pull) == 1);
+                struct BoltValue * x = BoltList_value(BoltConnection_data(connection), 0);
+                REQUIRE(BoltValue_type(x) == BOLT_DICTIONARY);
+                REQUIRE(x->size == 2);
+                for (int32_t i = 0; i < 2; i++)
+                {
+                    if (strncmp(BoltDictionary_get_key(x, i), "name", 4) == 0)
+                    {
+                        REQUIRE(BoltDictionary_value(x, i)->size == 5);
+                    }
+                    else
+                    {
+                        struct BoltValue * scores = BoltDictionary_value(x, i);
+                        REQUIRE(BoltValue_type(scores) == BOLT_LIST);
+                        REQUIRE(BoltInt64_get(BoltList_value(scores, 0)) == 1);
+                        REQUIRE(BoltFloat64_get(BoltList_value(scores, 1)) == 2.5);
+                        REQUIRE(BoltValue_type(BoltList_value(scores, 2)) == BOLT_NULL);
+                    }
+                }
+                REQUIRE(BoltConnection_fetch_summary_b(connection, pull) == 0);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+        }
+        WHEN("a large list parameter is written")
+        {
+            const char * cypher = "RETURN size($x)";
+            REQUIRE(BoltConnection_begin_run_request(connection, cypher, strlen(cypher), 1) == 0);
+            REQUIRE(BoltConnection_write_key(connection, "x", 1) == 0);
+            REQUIRE(BoltConnection_write_list(connection, 100000) == 0);
+            for (int64_t i = 0; i < 100000; i++)
+            {
+                BoltConnection_write_integer(connection, i);
+            }
+            REQUIRE(BoltConnection_end_run_request(connection) == 0);
+            BoltConnection_load_pull_request(connection, -1);
+            bolt_request_t pull = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            THEN("every value should be received")
+            {
+                REQUIRE(BoltConnection_fetch_b(connection, pull) == 1);
+                REQUIRE(BoltInt64_get(BoltList_value(BoltConnection_data(connection), 0)) == 100000);
+                REQUIRE(BoltConnection_fetch_summary_b(connection, pull) == 0);
+            }
+        }
+        WHEN("a request is ended before all of its parameters are written")
+        {
+            const char * cypher = "RETURN $x AS x";
+            REQUIRE(BoltConnection_begin_run_request(connection, cypher, strlen(cypher), 1) == 0);
+            REQUIRE(BoltConnection_write_key(connection, "x", 1) == 0);
+            THEN("the request should not be loaded, nor any other request in the meantime")
+            {
+                REQUIRE(BoltConnection_end_run_request(connection) == -1);
+                REQUIRE(BoltConnection_load_pull_request(connection, -1) == -1);
+                REQUIRE(BoltConnection_write_integer(connection, 1) == 0);
+                REQUIRE(BoltConnection_write_integer(connection, 2) == -1);
+                REQUIRE(BoltConnection_end_run_request(connection) == 0);
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
+SCENARIO("Test transactions with metadata", "[integration][ipv4][insecure]")
+{
+    GIVEN("an open and initialised connection")
+    {
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnection * connection = bolt_open_init_b(BOLT_SOCKET, BOLT_IPV4_HOST, BOLT_PORT, &profile);
+        WHEN("a transaction is begun with a bookmark, a timeout and metadata")
+        {
+            bolt_request_t init = BoltConnection_last_request(connection);
+            BoltConnection_load_bookmark(connection, "neo4j:bookmark:v1:tx1");
+            int timeout_loaded = BoltConnection_load_tx_timeout(connection, 5000);
+            struct BoltValue * metadata = BoltConnection_load_tx_metadata(connection, 1);
+            if (metadata != NULL)
+            {
+                BoltDictionary_set_key(metadata, 0, "app", 3);
+                BoltValue_to_String(BoltDictionary_value(metadata, 0), "test", 4);
+            }
+            BoltConnection_load_begin_request(connection);
+            bolt_request_t begin = BoltConnection_last_request(connection);
+            BoltConnection_cypher(connection, "RETURN 1", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            BoltConnection_load_commit_request(connection);
+            bolt_request_t commit = BoltConnection_last_request(connection);
+            BoltConnection_send_b(connection);
+            THEN("v3 should begin natively and earlier versions should emulate BEGIN without metadata")
+            {
+                if (connection->protocol_version >= 3)
+                {
+                    REQUIRE(timeout_loaded == 0);
+                    REQUIRE(metadata != NULL);
+                    REQUIRE(begin == init + 1);
+                }
+                else
+                {
+                    REQUIRE(timeout_loaded == -1);
+                    REQUIRE(metadata == NULL);
+                    REQUIRE(begin == init + 2);
+                }
+                REQUIRE(BoltConnection_fetch_summary_b(connection, begin) == 0);
+                REQUIRE(BoltMessage_code(BoltConnection_data(connection)) == 0x70);
+                REQUIRE(BoltConnection_fetch_summary_b(connection, commit) == 0);
+                REQUIRE(BoltMessage_code(BoltConnection_data(connection)) == 0x70);
+                REQUIRE(connection->status == BOLT_READY);
+            }
+        }
+        BoltConnection_close_b(connection);
+    }
+}
+
+SCENARIO("Test handshake timeout against an unresponsive server", "[integration][ipv4][insecure]")
+{
+    GIVEN("a local server that accepts connections but never responds")
+    {
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in listen_address {};
+        listen_address.sin_family = AF_INET;
+        listen_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t listen_address_size = sizeof(listen_address);
+        REQUIRE(bind(listener, (struct sockaddr *)(&listen_address), listen_address_size) == 0);
+        REQUIRE(listen(listener, 1) == 0);
+        getsockname(listener, (struct sockaddr *)(&listen_address), &listen_address_size);
+        char port[8];
+        snprintf(port, sizeof(port), "%d", ntohs(listen_address.sin_port));
+        struct BoltAddress * address = bolt_get_address("127.0.0.1", port);
+        WHEN("a connection is opened with a handshake timeout")
+        {
+            struct BoltConnection * connection = BoltConnection_create();
+            connection->timeouts.handshake = 200;
+            struct timespec t0, t1;
+            timespec_get(&t0, TIME_UTC);
+            int opened = BoltConnection_open_b(connection, BOLT_SOCKET, address);
+            timespec_get(&t1, TIME_UTC);
+            THEN("the attempt should time out promptly")
+            {
+                REQUIRE(opened == -1);
+                REQUIRE(connection->status == BOLT_DEFUNCT);
+                REQUIRE(connection->error == BOLT_TIMED_OUT);
+                REQUIRE(t1.tv_sec - t0.tv_sec < 5);
+            }
+            BoltConnection_close_b(connection);
+            BoltConnection_destroy(connection);
+        }
+        BoltAddress_destroy(address);
+        close(listener);
+    }
+}
+
+SCENARIO("Test connection racing across resolved addresses", "[integration][ipv6][insecure]")
+{
+    GIVEN("an address resolving first to a stalled server and then to a live one")
+    {
+        // A listener whose backlog is full silently drops new connection attempts
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in stalled {};
+        stalled.sin_family = AF_INET;
+        stalled.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t stalled_size = sizeof(stalled);
+        REQUIRE(bind(listener, (struct sockaddr *)(&stalled), stalled_size) == 0);
+        REQUIRE(listen(listener, 0) == 0);
+        getsockname(listener, (struct sockaddr *)(&stalled), &stalled_size);
+        int backlog[3];
+        for (int i = 0; i < 3; i++)
+        {
+            backlog[i] = socket(AF_INET, SOCK_STREAM, 0);
+            fcntl(backlog[i], F_SETFL, O_NONBLOCK);
+            connect(backlog[i], (struct sockaddr *)(&stalled), stalled_size);
+        }
+        struct BoltAddress * live = bolt_get_address(BOLT_IPV6_HOST, BOLT_PORT);
+        struct sockaddr_storage resolved_hosts[2];
+        memcpy(&resolved_hosts[0], &stalled, sizeof(stalled));
+        memcpy(&resolved_hosts[1], &live->resolved_hosts[0], sizeof(struct sockaddr_storage));
+        struct BoltAddress address { "localhost", BOLT_PORT, 2, &resolved_hosts[0], live->resolved_port };
+        WHEN("a connection is opened")
+        {
+            struct BoltConnection * connection = BoltConnection_create();
+            struct timespec t0, t1;
+            timespec_get(&t0, TIME_UTC);
+            BoltConnection_open_b(connection, BOLT_SOCKET, &address);
+            timespec_get(&t1, TIME_UTC);
+            THEN("the live server should win the race without waiting for the stalled one")
+            {
+                REQUIRE(connection->status == BOLT_CONNECTED);
+                REQUIRE(connection->n_attempts == 0);
+                REQUIRE(t1.tv_sec - t0.tv_sec < 2);
+            }
+            BoltConnection_close_b(connection);
+            BoltConnection_destroy(connection);
+        }
+        BoltAddress_destroy(live);
+        for (int i = 0; i < 3; i++)
+        {
+            close(backlog[i]);
+        }
+        close(listener);
+    }
+}
+
+SCENARIO("Test connection racing past a refused address", "[integration][ipv6][insecure]")
+{
+    GIVEN("an address resolving first to a closed port and then to a live server")
+    {
+        // A port bound and released again refuses connections
+        int closed = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in refused {};
+        refused.sin_family = AF_INET;
+        refused.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t refused_size = sizeof(refused);
+        REQUIRE(bind(closed, (struct sockaddr *)(&refused), refused_size) == 0);
+        getsockname(closed, (struct sockaddr *)(&refused), &refused_size);
+        close(closed);
+        struct BoltAddress * live = bolt_get_address(BOLT_IPV6_HOST, BOLT_PORT);
+        struct sockaddr_storage resolved_hosts[2];
+        memcpy(&resolved_hosts[0], &refused, sizeof(refused));
+        memcpy(&resolved_hosts[1], &live->resolved_hosts[0], sizeof(struct sockaddr_storage));
+        struct BoltAddress address { "localhost", BOLT_PORT, 2, &resolved_hosts[0], live->resolved_port };
+        WHEN("a connection is opened without blocking")
+        {
+            struct BoltConnection * connection = BoltConnection_create();
+            int defunct = 0;
+            int opened = BoltConnection_open_nb(connection, BOLT_SOCKET, &address);
+            while (opened == BOLT_WAITING)
+            {
+                defunct = defunct || connection->status == BOLT_DEFUNCT;
+                opened = BoltConnection_progress(connection);
+            }
+            THEN("the connection should never appear defunct on its way to connecting")
+            {
+                REQUIRE(opened == 0);
+                REQUIRE(defunct == 0);
+                REQUIRE(connection->status == BOLT_CONNECTED);
+                REQUIRE(connection->error == BOLT_NO_ERROR);
+            }
+            BoltConnection_close_b(connection);
+            BoltConnection_destroy(connection);
+        }
+        BoltAddress_destroy(live);
+    }
+}
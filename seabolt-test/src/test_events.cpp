@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2002-2018 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "integration.hpp"
+#include "catch.hpp"
+
+extern "C" {
+    #include "bolt/events.h"
+    #include "bolt/mem.h"
+    #include "bolt/ring.h"
+}
+
+
+struct EventTestCase
+{
+    int stage;
+    int records;
+    int result;
+};
+
+void on_completed(struct BoltEventLoop * loop, struct BoltConnection * connection, int result, void * data)
+{
+    auto * test_case = (struct EventTestCase *)(data);
+    test_case->result = result;
+    if (result < 0)
+    {
+        return;
+    }
+    int next = BOLT_WAITING;
+    switch (test_case->stage)
+    {
+        case 0:
+            next = BoltConnection_init_nb(connection, &BOLT_PROFILE);
+            break;
+        case 1:
+            BoltConnection_cypher(connection, "UNWIND range(1, 1000) AS n RETURN n", 0);
+            BoltConnection_load_run_request(connection);
+            BoltConnection_load_pull_request(connection, -1);
+            next = BoltConnection_send_nb(connection);
+            break;
+        case 2:
+        case 3:
+            test_case->records += result;
+            if (test_case->stage == 3 && result == 0)
+            {
+                return;
+            }
+            next = BoltConnection_fetch_nb(connection, BoltConnection_last_request(connection));
+            test_case->stage = 2;
+            break;
+        default:
+            return;
+    }
+    test_case->stage += 1;
+    if (next == BOLT_WAITING)
+    {
+        BoltEventLoop_watch(loop, connection, on_completed, data);
+    }
+    else
+    {
+        on_completed(loop, connection, next, data);
+    }
+}
+
+SCENARIO("Test several connections driven by an event loop", "[integration][ipv6][insecure]")
+{
+    GIVEN("an event loop and a local server address")
+    {
+        struct BoltEventLoop * loop = BoltEventLoop_create();
+        REQUIRE(loop != nullptr);
+        struct BoltAddress * address = bolt_get_address(BOLT_IPV6_HOST, BOLT_PORT);
+        WHEN("several connections run a query concurrently")
+        {
+            const int n_connections = 4;
+            struct BoltConnection * connections[n_connections];
+            struct EventTestCase test_cases[n_connections];
+            for (int i = 0; i < n_connections; i++)
+            {
+                connections[i] = BoltConnection_create();
+                test_cases[i] = {0, 0, 0};
+                int opened = BoltConnection_open_nb(connections[i], BOLT_SOCKET, address);
+                if (opened == BOLT_WAITING)
+                {
+                    BoltEventLoop_watch(loop, connections[i], on_completed, &test_cases[i]);
+                }
+                else
+                {
+                    on_completed(loop, connections[i], opened, &test_cases[i]);
+                }
+            }
+            REQUIRE(BoltEventLoop_run(loop) == 0);
+            THEN("every connection should receive all records")
+            {
+                for (int i = 0; i < n_connections; i++)
+                {
+                    REQUIRE(test_cases[i].result == 0);
+                    REQUIRE(test_cases[i].records == 1000);
+                    REQUIRE(connections[i]->status == BOLT_READY);
+                }
+            }
+            for (int i = 0; i < n_connections; i++)
+            {
+                BoltConnection_close_b(connections[i]);
+                BoltConnection_destroy(connections[i]);
+            }
+        }
+        BoltAddress_destroy(address);
+        BoltEventLoop_destroy(loop);
+    }
+}
+
+SCENARIO("Test non-blocking connection to dead port", "[integration][ipv6][insecure]")
+{
+    GIVEN("a local server address")
+    {
+        struct BoltAddress * address = bolt_get_address(BOLT_IPV6_HOST, "9999");
+        WHEN("a non-blocking connection attempt is made")
+        {
+            struct BoltConnection * connection = BoltConnection_create();
+            int opened = BoltConnection_open_nb(connection, BOLT_SOCKET, address);
+            while (opened == BOLT_WAITING)
+            {
+                opened = BoltConnection_progress(connection);
+            }
+            THEN("the attempt should fail with a DEFUNCT connection")
+            {
+                REQUIRE(opened == -1);
+                REQUIRE(connection->status == BOLT_DEFUNCT);
+            }
+            BoltConnection_close_b(connection);
+            BoltConnection_destroy(connection);
+        }
+        BoltAddress_destroy(address);
+    }
+}
+
+void count_completed(struct BoltEventLoop *, struct BoltConnection *, int result, void * data)
+{
+    auto * test_case = (struct EventTestCase *)(data);
+    test_case->stage += 1;
+    test_case->result = result;
+}
+
+void destroy_completed(struct BoltEventLoop * loop, struct BoltConnection * connection, int result, void * data)
+{
+    count_completed(loop, connection, result, data);
+    BoltConnection_close_b(connection);
+    BoltConnection_destroy(connection);
+}
+
+SCENARIO("Test event loop with connections destroyed while watched", "[integration][ipv6][insecure]")
+{
+    GIVEN("an event loop and a local address with no server")
+    {
+        struct BoltEventLoop * loop = BoltEventLoop_create();
+        REQUIRE(loop != nullptr);
+        struct BoltAddress * address = bolt_get_address(BOLT_IPV6_HOST, "9999");
+        WHEN("handlers destroy their connections once the open fails")
+        {
+            const int n_connections = 2;
+            struct EventTestCase test_cases[n_connections];
+            for (int i = 0; i < n_connections; i++)
+            {
+                struct BoltConnection * connection = BoltConnection_create();
+                test_cases[i] = {0, 0, 0};
+                int opened = BoltConnection_open_nb(connection, BOLT_SOCKET, address);
+                if (opened == BOLT_WAITING)
+                {
+                    BoltEventLoop_watch(loop, connection, destroy_completed, &test_cases[i]);
+                }
+                else
+                {
+                    destroy_completed(loop, connection, opened, &test_cases[i]);
+                }
+            }
+            REQUIRE(BoltEventLoop_run(loop) == 0);
+            THEN("each handler should be called once and nothing should remain watched")
+            {
+                for (int i = 0; i < n_connections; i++)
+                {
+                    REQUIRE(test_cases[i].stage == 1);
+                    REQUIRE(test_cases[i].result == -1);
+                }
+                REQUIRE(loop->n_watched == 0);
+            }
+        }
+        WHEN("a connection is unwatched and destroyed while its open is pending")
+        {
+            struct BoltConnection * connection = BoltConnection_create();
+            struct EventTestCase test_case { 0, 0, 0 };
+            int opened = BoltConnection_open_nb(connection, BOLT_SOCKET, address);
+            int watched = opened == BOLT_WAITING ? BoltEventLoop_watch(loop, connection, count_completed, &test_case) : 0;
+            int unwatched = BoltEventLoop_unwatch(loop, connection);
+            int unwatched_again = BoltEventLoop_unwatch(loop, connection);
+            BoltConnection_close_b(connection);
+            BoltConnection_destroy(connection);
+            int completed = BoltEventLoop_run_once(loop, 100);
+            THEN("its handler should never be called")
+            {
+                REQUIRE(watched == 0);
+                REQUIRE(unwatched == (opened == BOLT_WAITING ? 0 : -1));
+                REQUIRE(unwatched_again == -1);
+                REQUIRE(completed == 0);
+                REQUIRE(test_case.stage == 0);
+                REQUIRE(loop->n_watched == 0);
+            }
+        }
+        BoltAddress_destroy(address);
+        BoltEventLoop_destroy(loop);
+    }
+}
+
+SCENARIO("Test event loop when every connection attempt fails at once", "[events]")
+{
+    GIVEN("a listener that cannot accept connections and an address resolved to it twice")
+    {
+        // Connection attempts stay in progress while the accept queue of the listener is full
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in local {};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t local_size = sizeof(local);
+        REQUIRE(bind(listener, (struct sockaddr *)(&local), local_size) == 0);
+        REQUIRE(listen(listener, 0) == 0);
+        REQUIRE(getsockname(listener, (struct sockaddr *)(&local), &local_size) == 0);
+        int filler = socket(AF_INET, SOCK_STREAM, 0);
+        REQUIRE(connect(filler, (struct sockaddr *)(&local), local_size) == 0);
+        struct BoltAddress * address = bolt_get_address("127.0.0.1", std::to_string(ntohs(local.sin_port)).c_str());
+        REQUIRE(address->n_resolved_hosts == 1);
+        address->resolved_hosts = (struct sockaddr_storage *)(BoltMem_reallocate(address->resolved_hosts,
+                                                                                  sizeof(struct sockaddr_storage),
+                                                                                  2 * sizeof(struct sockaddr_storage)));
+        address->resolved_hosts[1] = address->resolved_hosts[0];
+        address->n_resolved_hosts = 2;
+        struct BoltEventLoop * loop = BoltEventLoop_create();
+        REQUIRE(loop != nullptr);
+        WHEN("both attempts fail before the loop next wakes")
+        {
+            struct BoltConnection * connection = BoltConnection_create();
+            struct EventTestCase test_case { 0, 0, 0 };
+            REQUIRE(BoltConnection_open_nb(connection, BOLT_SOCKET, address) == BOLT_WAITING);
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            REQUIRE(BoltConnection_progress(connection) == BOLT_WAITING);
+            REQUIRE(connection->n_attempts == 2);
+            REQUIRE(BoltEventLoop_watch(loop, connection, count_completed, &test_case) == 0);
+            // Retransmitted connection requests are refused once the listener is gone
+            close(filler);
+            close(listener);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+            int completed = BoltEventLoop_run_once(loop, 0);
+            THEN("the connection should complete once and stop being watched")
+            {
+                REQUIRE(completed == 1);
+                REQUIRE(test_case.stage == 1);
+                REQUIRE(test_case.result == -1);
+                REQUIRE(loop->n_watched == 0);
+                REQUIRE(connection->status == BOLT_DEFUNCT);
+            }
+            BoltConnection_close_b(connection);
+            BoltConnection_destroy(connection);
+        }
+        BoltEventLoop_destroy(loop);
+        BoltAddress_destroy(address);
+    }
+}
+
+#if USE_IO_URING
+
+SCENARIO("Test blocking connections attached to a ring", "[integration][ipv4][insecure]")
+{
+    GIVEN("a ring and a local server address")
+    {
+        struct BoltRing * ring = BoltRing_create(BOLT_RING_ENTRIES);
+        REQUIRE(ring != nullptr);
+        struct BoltAddress * address = bolt_get_address(BOLT_IPV4_HOST, BOLT_PORT);
+        WHEN("queries are run on two connections attached to the ring")
+        {
+            struct BoltConnection * connections[2];
+            bolt_request_t pulls[2];
+            for (int i = 0; i < 2; i++)
+            {
+                connections[i] = BoltConnection_create();
+                REQUIRE(BoltRing_attach(ring, connections[i]) == 0);
+                BoltConnection_open_b(connections[i], BOLT_SOCKET, address);
+                BoltConnection_init_b(connections[i], &BOLT_PROFILE);
+                BoltConnection_cypher(connections[i], "UNWIND range(1, 1000) AS n RETURN n", 0);
+                BoltConnection_load_run_request(connections[i]);
+                BoltConnection_load_pull_request(connections[i], -1);
+                pulls[i] = BoltConnection_last_request(connections[i]);
+                BoltConnection_send_b(connections[i]);
+            }
+            THEN("each connection should receive all records through the ring")
+            {
+                for (int i = 0; i < 2; i++)
+                {
+                    REQUIRE(connections[i]->status == BOLT_READY);
+                    REQUIRE(BoltConnection_fetch_summary_b(connections[i], pulls[i]) == 1000);
+                    REQUIRE(connections[i]->ring == ring);
+                }
+            }
+            BoltConnection_close_b(connections[0]);
+            BoltConnection_destroy(connections[0]);
+            BoltConnection_close_b(connections[1]);
+            BoltRing_destroy(ring);
+            REQUIRE(connections[1]->ring == nullptr);
+            BoltConnection_destroy(connections[1]);
+        }
+        BoltAddress_destroy(address);
+    }
+}
+
+#endif // USE_IO_URING
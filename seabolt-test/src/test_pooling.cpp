@@ -122,3 +122,28 @@ SCENARIO("Test running out of connections", "[integration][ipv6][secure][pooling
         BoltConnectionPool_destroy(pool);
     }
 }
+
+SCENARIO("Test TLS session resumption for pooled connections", "[integration][ipv6][secure][pooling]")
+{
+    GIVEN("a new connection pool with one entry")
+    {
+        struct BoltAddress address { BOLT_IPV6_HOST, BOLT_PORT };
+        struct BoltUserProfile profile { BOLT_AUTH_BASIC, BOLT_USER, BOLT_PASSWORD, BOLT_USER_AGENT };
+        struct BoltConnectionPool * pool = BoltConnectionPool_create(BOLT_SECURE_SOCKET, &address, &profile, 1);
+        WHEN("a pooled connection is closed and then reopened")
+        {
+            struct BoltConnection * connection1 = BoltConnectionPool_acquire(pool, "test");
+            REQUIRE(connection1->metrics.tls_session_resumed == 0);
+            BoltConnection_close_b(connection1);
+            BoltConnectionPool_release(pool, connection1);
+            struct BoltConnection * connection2 = BoltConnectionPool_acquire(pool, "test");
+            THEN("the reopened connection should resume the earlier TLS session")
+            {
+                REQUIRE(connection2->status == BOLT_READY);
+                REQUIRE(connection2->metrics.tls_session_resumed != 0);
+            }
+            BoltConnectionPool_release(pool, connection2);
+        }
+        BoltConnectionPool_destroy(pool);
+    }
+}
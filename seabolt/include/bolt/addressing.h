@@ -28,6 +28,10 @@
  * The address of a Bolt server. This can carry both the original host
  * and port details, as supplied by the application, as well as one or
  * more resolved IP addresses and port number.
+ *
+ * A host beginning with "/" is taken to be the path of a Unix domain
+ * socket, for use with the `BOLT_UNIX_SOCKET` transport, in which case
+ * the port is ignored.
  */
 struct BoltAddress
 {
@@ -38,7 +42,7 @@ struct BoltAddress
 
     /// Number of resolved IP addresses
     int n_resolved_hosts;
-    /// Resolved IP address data
+    /// Resolved IP address data (or a Unix domain socket address)
     struct sockaddr_storage * resolved_hosts;
     /// Resolved port number
     in_port_t resolved_port;
@@ -69,15 +73,16 @@ PUBLIC int BoltAddress_resolve_b(struct BoltAddress * address);
 /**
  * Copy the textual representation of a resolved host IP address into a buffer.
  *
- * If successful, AF_INET or AF_INET6 is returned depending on the address
- * family. If unsuccessful, -1 is returned. Failure may be a result of a
+ * If successful, AF_INET, AF_INET6 or AF_UNIX is returned depending on the
+ * address family, with a Unix domain socket address represented by its
+ * path. If unsuccessful, -1 is returned. Failure may be a result of a
  * system problem or because the supplied buffer is too small for the address.
  *
  * @param address pointer to a resolved BoltAddress structure
  * @param index index of the resolved IP address
  * @param buffer buffer in which to write the address representation
  * @param buffer_size size of the buffer
- * @return address family (AF_INET or AF_INET6) or -1 on error
+ * @return address family (AF_INET, AF_INET6 or AF_UNIX) or -1 on error
  */
 PUBLIC int BoltAddress_copy_resolved_host(struct BoltAddress * address, size_t index, char * buffer, socklen_t buffer_size);
 
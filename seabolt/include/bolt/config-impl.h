@@ -22,9 +22,28 @@
 
 #if USE_POSIXSOCK
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#endif
 #endif // USE_POSIXSOCK
 
+#if USE_EPOLL
+#include <sys/epoll.h>
+#endif // USE_EPOLL
+
+#if USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif // USE_IO_URING
+
 #if USE_WINSOCK
 #include <winsock2.h>
 #include <Ws2tcpip.h>
@@ -33,6 +33,15 @@
 
 typedef unsigned long long bolt_request_t;
 
+struct BoltValue;
+struct BoltConnection;
+
+/// Returned by a non-blocking call that cannot complete without waiting on the network
+#define BOLT_WAITING (-2)
+
+/// Maximum number of connection attempts raced concurrently by a single open
+#define BOLT_MAX_CONNECT_ATTEMPTS 8
+
 
 /**
  *
@@ -41,6 +50,7 @@ enum BoltTransport
 {
     BOLT_SOCKET,
     BOLT_SECURE_SOCKET,
+    BOLT_UNIX_SOCKET,
 };
 
 /**
@@ -77,12 +87,269 @@ enum BoltConnectionError
     BOLT_END_OF_TRANSMISSION,
 };
 
+/**
+ * Progress of a non-blocking operation on a connection.
+ */
+enum BoltConnectionStage
+{
+    BOLT_IDLE,                  // no operation in progress
+    BOLT_CONNECTING,            // waiting for the socket to connect
+    BOLT_SECURING,              // performing the TLS handshake
+    BOLT_HANDSHAKING,           // performing the Bolt handshake
+    BOLT_INITIALISING,          // exchanging INIT and its response
+    BOLT_RESETTING,             // exchanging RESET and its response
+    BOLT_SENDING,               // transmitting queued requests
+    BOLT_FETCHING,              // waiting for a response
+};
+
+/**
+ * Socket events on which a non-blocking operation can be waiting.
+ */
+enum BoltSocketEvent
+{
+    BOLT_READABLE = 1,
+    BOLT_WRITABLE = 2,
+};
+
+/**
+ * Directions in which TLS record processing has been offloaded to the
+ * kernel, allowing data to be sent and received without passing through
+ * the TLS library.
+ */
+enum BoltKernelTls
+{
+    BOLT_KTLS_SEND = 1,
+    BOLT_KTLS_RECEIVE = 2,
+};
+
+/**
+ * Time limits for the operations carried out on a connection, each in
+ * milliseconds. A value of zero places no limit on the operation. An
+ * operation that exceeds its limit fails, leaving the connection
+ * DEFUNCT with a BOLT_TIMED_OUT error.
+ */
+struct BoltTimeouts
+{
+    /// Time allowed to establish a socket connection
+    int connect;
+    /// Time allowed for the TLS and Bolt handshakes and for initialisation
+    int handshake;
+    /// Time allowed to transmit all queued requests
+    int send;
+    /// Time allowed to receive each fetched value, or the summary of a reset
+    int fetch;
+};
+
+/**
+ * Options applied to the socket of a connection when it is opened.
+ * Options marked as Linux only are ignored on platforms that do not
+ * support them, and all options besides keepalive and buffer sizes are
+ * ignored for Unix domain sockets.
+ */
+struct BoltSocketOptions
+{
+    /// Non-zero to send keepalive probes on an idle connection (SO_KEEPALIVE)
+    int keep_alive;
+    /// Non-zero to send data without waiting to coalesce it (TCP_NODELAY)
+    int no_delay;
+    /// Non-zero to acknowledge received data without delay (TCP_QUICKACK, Linux only)
+    int quick_ack;
+    /// Size of the kernel send buffer in bytes (SO_SNDBUF), or zero for the system default
+    int send_buffer_size;
+    /// Size of the kernel receive buffer in bytes (SO_RCVBUF), or zero for the system default
+    int receive_buffer_size;
+    /// Time in milliseconds for which sent data may remain unacknowledged
+    /// before the connection is dropped (TCP_USER_TIMEOUT, Linux only), or zero for the system default
+    int user_timeout;
+    /// Time in microseconds to busy poll for data before blocking
+    /// (SO_BUSY_POLL, Linux only), or zero to disable busy polling
+    int busy_poll;
+    /// Minimum size in bytes of a write during an explicit send for the kernel to
+    /// send it without copying (MSG_ZEROCOPY, Linux only, plain TCP only), or zero to always copy
+    int zero_copy_threshold;
+};
+
+/**
+ * Policy for transmitting queued requests as they are loaded, without
+ * waiting for an explicit send. Loading a request checks the byte and
+ * latency thresholds and, once either is crossed, transmits as much
+ * queued data as possible without blocking. An explicit send always
+ * transmits everything that remains. With both thresholds at zero,
+ * requests are only transmitted by an explicit send.
+ *
+ * The high-water mark instead bounds the memory held by queued
+ * requests. Once crossed, loading a request transmits as much as the
+ * socket accepts and blocks only while the queue remains at or above the
+ * mark, receiving any responses that arrive in the meantime so that they
+ * can later be fetched as usual. Transmitted data is then moved out of
+ * the transmit buffers, so that they stay bounded even if the queue never
+ * empties.
+ */
+struct BoltFlushPolicy
+{
+    /// Non-zero to have the kernel hold back partial packets transmitted
+    /// ahead of an explicit send (MSG_MORE or TCP_CORK), releasing them on send
+    int cork;
+    /// Number of queued bytes at which loading a request starts transmission, or zero for no threshold
+    int max_bytes;
+    /// Time in milliseconds after which a queued request is transmitted by
+    /// the next request loaded, or zero for no threshold
+    int max_delay;
+    /// Number of queued bytes at which loading a request blocks until
+    /// the queue falls back below this mark, or zero for no limit
+    int high_water;
+};
+
+/**
+ * Policy for responses that arrive ahead of the response being fetched.
+ *
+ * Responses arrive in the order in which their requests were sent, so
+ * fetching the response to one request first passes over the responses
+ * to any earlier requests that have not been fetched. By default these
+ * are discarded. With `retain` set, each message passed over is instead
+ * queued for its request, and later fetches for that request are served
+ * from the queue, so that pipelined results can be consumed in any order.
+ *
+ * Queued messages are held as raw bytes and only decoded once fetched.
+ * A message that would take the queued bytes beyond `max_bytes` is
+ * instead passed to the `spill` callback and dropped, or fails the fetch
+ * if there is no callback.
+ */
+struct BoltRetentionPolicy
+{
+    /// Non-zero to queue responses that arrive ahead of the one being fetched
+    int retain;
+    /// Number of queued bytes beyond which messages are spilled, or zero for no limit
+    int max_bytes;
+    /// Called with the request and raw PackStream bytes of each message
+    /// spilled, which are only valid for the duration of the call
+    void (*spill)(void * context, bolt_request_t request, const char * data, int size);
+    /// Passed to the spill callback
+    void * context;
+};
+
+/**
+ * Callbacks through which records are passed to the application value by
+ * value as they are decoded, in place of building a `BoltValue` for each.
+ *
+ * Each record arrives as a list of its fields. Containers are announced
+ * by a begin callback giving their size, followed by their contents and
+ * an end callback; map keys are passed to `on_string` ahead of their
+ * values. String and byte data are passed as pointers into the receive
+ * buffer where possible, are not null-terminated, and remain valid only
+ * for the duration of the callback. Any callback may be left NULL to
+ * ignore values of that kind.
+ */
+struct BoltValueHandlers
+{
+    /// Application state passed to every callback
+    void * context;
+    void (*on_null)(void * context);
+    void (*on_boolean)(void * context, int value);
+    void (*on_integer)(void * context, int64_t value);
+    void (*on_float)(void * context, double value);
+    void (*on_string)(void * context, const char * data, int32_t size);
+    void (*on_bytes)(void * context, const char * data, int32_t size);
+    void (*begin_list)(void * context, int32_t size);
+    void (*end_list)(void * context);
+    void (*begin_map)(void * context, int32_t size);
+    void (*end_map)(void * context);
+    void (*begin_structure)(void * context, int16_t code, int32_t size);
+    void (*end_structure)(void * context);
+};
+
+/**
+ * Callbacks through which the response to a request is delivered by
+ * `BoltConnection_dispatch_b`, in place of fetching it explicitly.
+ *
+ * Each record is passed to `on_record` as a `BOLT_LIST` of its fields,
+ * followed by the summary, which is passed to `on_success`, to
+ * `on_failure` if the request failed, or to `on_ignored` if the server
+ * ignored the request following an earlier failure. Values passed to the
+ * callbacks are only valid for the duration of the call. Callbacks may
+ * load further requests and register callbacks for them, which are then
+ * dispatched in the same pass. Any callback may be left NULL, in which
+ * case records are passed over without being decoded.
+ */
+struct BoltResponseCallbacks
+{
+    /// Application state passed to every callback
+    void * context;
+    void (*on_record)(void * context, struct BoltConnection * connection, bolt_request_t request,
+                      struct BoltValue * fields);
+    void (*on_success)(void * context, struct BoltConnection * connection, bolt_request_t request,
+                       struct BoltValue * metadata);
+    void (*on_failure)(void * context, struct BoltConnection * connection, bolt_request_t request,
+                       struct BoltValue * metadata);
+    void (*on_ignored)(void * context, struct BoltConnection * connection, bolt_request_t request,
+                       struct BoltValue * metadata);
+};
+
+/**
+ * Preset combinations of socket options.
+ */
+enum BoltSocketPreset
+{
+    BOLT_SOCKET_DEFAULT,            // keepalive and no delay only
+    BOLT_SOCKET_LOW_LATENCY,        // quick acknowledgement and busy polling, for short lookups
+    BOLT_SOCKET_BULK_THROUGHPUT,    // large kernel buffers and zero-copy sends, for bulk import and export
+};
+
+/**
+ * A contiguous region of buffered data queued for transmission.
+ */
+struct BoltTransmitSegment
+{
+    /// Buffer holding the data
+    struct BoltBuffer * buffer;
+    /// Offset of the first untransmitted byte within the buffer
+    int offset;
+    /// Number of bytes remaining to be transmitted
+    int size;
+};
+
+/**
+ * A request awaiting dispatch of its response to callbacks.
+ */
+struct BoltPendingResponse
+{
+    /// Request to which the response belongs
+    bolt_request_t request;
+    /// Callbacks to which the response is delivered
+    const struct BoltResponseCallbacks * callbacks;
+};
+
 struct BoltConnectionMetrics
 {
     struct timespec time_opened;
     struct timespec time_closed;
     unsigned long long bytes_sent;
     unsigned long long bytes_received;
+    /// Non-zero if the TLS handshake resumed an earlier session
+    int tls_session_resumed;
+    /// TLS version negotiated for the connection (BOLT_TLS_1_2 or BOLT_TLS_1_3)
+    int tls_version;
+    /// Non-zero if the Bolt handshake was accepted as TLS early data
+    int tls_early_data_accepted;
+    /// Bytes handed to the kernel to send without copying
+    unsigned long long bytes_sent_zero_copy;
+};
+
+/**
+ * A Cypher statement and its parameter keys, encoded once so that only
+ * parameter values need encoding each time the statement is run.
+ * Statements are not modified once created, so a single statement can
+ * be run on any number of connections, including pooled connections in
+ * different threads.
+ */
+struct BoltStatement
+{
+    /// Encoded statement string, parameter map header and parameter keys
+    struct BoltBuffer * data;
+    /// Offsets of the encoded parameter keys within the data, followed by their end
+    int32_t * key_offsets;
+    /// Number of parameters
+    int32_t n_parameters;
 };
 
 /**
@@ -97,26 +364,45 @@ struct BoltConnection
     /// Transport type for this connection
     enum BoltTransport transport;
 
-    /// The security context (secure connections only)
-    struct ssl_ctx_st* ssl_context;
+    /// The security context shared with other connections, or NULL to use
+    /// the process-wide context (secure connections only)
+    struct BoltSecurityContext* security_context;
     /// A secure socket wrapper (secure connections only)
     struct ssl_st* ssl;
+    /// Directions (`BoltKernelTls` flags) in which the kernel carries out TLS record processing
+    int kernel_tls;
     /// The raw socket that backs this connection
     int socket;
+    /// The io_uring instance through which socket I/O is carried out, or NULL for system calls
+    struct BoltRing * ring;
+    /// State of this connection on its ring (attached connections only)
+    struct BoltRingSlot * ring_slot;
 
     /// The protocol version used for this connection
     int32_t protocol_version;
+    /// Operations of the protocol version used for this connection
+    const struct BoltProtocol * protocol;
     /// State required by the protocol
     void* protocol_state;
 
-    // These buffers contain data exactly as it is transmitted or
-    // received. Therefore for Bolt v1, chunk headers are included
-    // in these buffers
+    // The receive buffer contains data exactly as it is received.
+    // Therefore for Bolt v1, chunk headers are included in this
+    // buffer. Outgoing data is instead queued as a list of segments
+    // that may refer to any buffer, so that protocol framing can be
+    // transmitted alongside encoded payload without copying it.
 
-    /// Transmit buffer
+    /// Transmit buffer, holding handshake and framing data
     struct BoltBuffer* tx_buffer;
     /// Receive buffer
     struct BoltBuffer* rx_buffer;
+    /// Segments queued for transmission
+    struct BoltTransmitSegment * tx_segments;
+    /// Number of segments queued for transmission
+    int n_tx_segments;
+    /// Capacity of the segment queue
+    int tx_segments_size;
+    /// Staging buffer for coalescing small segments into TLS records
+    struct BoltBuffer* tx_record;
 
     /// Connection metrics
     struct BoltConnectionMetrics metrics;
@@ -124,6 +410,60 @@ struct BoltConnection
     enum BoltConnectionStatus status;
     /// Current connection error code
     enum BoltConnectionError error;
+
+    /// Progress of the current non-blocking operation
+    enum BoltConnectionStage stage;
+    /// Socket events (`BoltSocketEvent` flags) awaited by the current operation
+    int awaiting;
+    /// Address being connected to by a non-blocking open
+    struct BoltAddress * address;
+    /// Number of resolved hosts to which connection attempts have been started, less one
+    int address_index;
+    /// Sockets of connection attempts in progress during an open
+    int attempts[BOLT_MAX_CONNECT_ATTEMPTS];
+    /// Number of connection attempts in progress
+    int n_attempts;
+    /// Error of the last connection attempt to fail, reported only once every attempt has failed
+    enum BoltConnectionError attempt_error;
+    /// Time at which the next connection attempt is due to start, on the monotonic clock
+    struct timespec next_attempt;
+    /// Request for which the current operation is fetching a response
+    bolt_request_t fetch_request;
+    /// Callbacks through which fetched records are streamed, or NULL to
+    /// store each record in the value returned by `BoltConnection_data`
+    const struct BoltValueHandlers * record_handlers;
+    /// Non-zero to keep each fetched record undecoded until its fields
+    /// are accessed through `BoltConnection_record_field`, or the whole
+    /// record through `BoltConnection_data`
+    int lazy_records;
+    /// Time limits applied to operations on this connection
+    struct BoltTimeouts timeouts;
+    /// Options applied to the socket when the connection is opened
+    struct BoltSocketOptions socket_options;
+    /// Policy for transmitting requests as they are loaded
+    struct BoltFlushPolicy flush_policy;
+    /// Policy for responses that arrive ahead of the response being fetched
+    struct BoltRetentionPolicy retention_policy;
+    /// Requests with callbacks awaiting dispatch, in the order in which they were loaded
+    struct BoltPendingResponse * pending_responses;
+    /// Number of requests awaiting dispatch
+    int n_pending_responses;
+    /// Capacity of the pending request queue
+    int pending_responses_size;
+    /// Number of bytes queued for transmission
+    int n_tx_bytes;
+    /// Time by which queued requests are due to be transmitted under the flush policy, on the monotonic clock (zero if none)
+    struct timespec flush_deadline;
+    /// Non-zero if the kernel may be holding back transmitted data until the connection is uncorked
+    int corked;
+    /// Non-zero if the socket accepts zero-copy sends
+    int zero_copy;
+    /// Number of zero-copy sends made on the socket
+    unsigned zero_copy_sends;
+    /// Number of zero-copy sends for which the kernel has released the memory sent from
+    unsigned zero_copy_releases;
+    /// Time by which the current operation must complete, on the monotonic clock (zero if unlimited)
+    struct timespec deadline;
 };
 
 enum BoltAuthScheme
@@ -143,6 +483,15 @@ struct BoltUserProfile
 };
 
 
+/**
+ * Initialise a set of socket options from a preset. Options can be
+ * adjusted individually afterwards.
+ *
+ * @param options
+ * @param preset
+ */
+PUBLIC void BoltSocketOptions_preset(struct BoltSocketOptions * options, enum BoltSocketPreset preset);
+
 /**
  *
  *
@@ -162,6 +511,12 @@ PUBLIC void BoltConnection_destroy(struct BoltConnection* connection);
  * _transport_. The `address` should be a pointer to a `BoltAddress` struct
  * that has been successfully resolved.
  *
+ * Where several addresses have been resolved, connection attempts are
+ * raced across them as described in RFC 8305 ("Happy Eyeballs"): IPv4
+ * and IPv6 addresses are interleaved, a new attempt is started every
+ * 250 ms or as soon as all attempts in progress have failed, and the
+ * first attempt to connect is used while the others are cancelled.
+ *
  * This function blocks until the connection attempt succeeds or fails.
  * On returning, the connection status will be set to either `BOLT_CONNECTED`
  * (if successful) or `BOLT_DEFUNCT` (if not). If defunct, the error code for
@@ -193,6 +548,23 @@ PUBLIC void BoltConnection_destroy(struct BoltConnection* connection);
  */
 PUBLIC int BoltConnection_open_b(struct BoltConnection * connection, enum BoltTransport transport, struct BoltAddress * address);
 
+/**
+ * Start opening a connection to a Bolt server without blocking.
+ *
+ * This carries out the same sequence of steps as `BoltConnection_open_b`
+ * (connect, TLS handshake where applicable, and Bolt handshake) but
+ * returns `BOLT_WAITING` as soon as any step would block. The remaining
+ * steps are carried out by `BoltConnection_progress`, typically driven by
+ * a `BoltEventLoop`. The `address` must remain valid until the operation
+ * completes.
+ *
+ * @param connection the connection to open
+ * @param transport the type of transport over which to connect
+ * @param address descriptor of the remote Bolt server address
+ * @return 0 if opened immediately, -1 on failure, BOLT_WAITING otherwise
+ */
+PUBLIC int BoltConnection_open_nb(struct BoltConnection * connection, enum BoltTransport transport, struct BoltAddress * address);
+
 /**
  * Close a connection.
  *
@@ -210,6 +582,19 @@ PUBLIC void BoltConnection_close_b(struct BoltConnection* connection);
  */
 PUBLIC int BoltConnection_init_b(struct BoltConnection * connection, const struct BoltUserProfile * profile);
 
+/**
+ * Start initialising the connection without blocking.
+ *
+ * The INIT request is queued and transmitted along with any other
+ * requests already queued, and the operation completes on receipt of
+ * its summary.
+ *
+ * @param connection the connection to initialise
+ * @param profile credentials for a database user
+ * @return 0 or -1 if completed immediately, BOLT_WAITING otherwise
+ */
+PUBLIC int BoltConnection_init_nb(struct BoltConnection * connection, const struct BoltUserProfile * profile);
+
 /**
  * Reset the connection to discard any outstanding results,
  * rollback the current transaction and clear any unacknowledged
@@ -220,6 +605,60 @@ PUBLIC int BoltConnection_init_b(struct BoltConnection * connection, const struc
  */
 PUBLIC int BoltConnection_reset_b(struct BoltConnection * connection);
 
+/**
+ * Start resetting the connection without blocking.
+ *
+ * @param connection
+ * @return 0 or -1 if completed immediately, BOLT_WAITING otherwise
+ */
+PUBLIC int BoltConnection_reset_nb(struct BoltConnection * connection);
+
+/**
+ * Determine the time remaining before the deadline of the operation in
+ * progress passes.
+ *
+ * @param connection
+ * @return remaining time in milliseconds, or -1 if the operation has no deadline
+ */
+PUBLIC int BoltConnection_time_remaining(struct BoltConnection * connection);
+
+/**
+ * Queue a region of buffered data for transmission on the next send.
+ *
+ * The data is not copied, so the region must remain unchanged until it
+ * has been transmitted, although the buffer itself may grow. Regions
+ * must be queued in order of their position within each buffer. Once
+ * transmitted, the region is unloaded from the buffer.
+ *
+ * @param connection
+ * @param buffer the buffer holding the data
+ * @param offset the offset of the region within the buffer
+ * @param size the size of the region
+ */
+PUBLIC void BoltConnection_queue(struct BoltConnection * connection, struct BoltBuffer * buffer, int offset, int size);
+
+/**
+ * Apply the flush policy once a complete request has been queued,
+ * transmitting queued data without blocking if a threshold has been
+ * crossed. This is called by the protocol implementation after each
+ * request is loaded.
+ *
+ * @param connection
+ * @return 0 on success, -1 if transmission failed
+ */
+PUBLIC int BoltConnection_loaded(struct BoltConnection * connection);
+
+/**
+ * Block until the kernel has released the transmit buffer memory of all
+ * zero-copy sends, so that it can be overwritten. This is called by the
+ * protocol implementation before each request is loaded, and returns
+ * immediately unless a zero-copy send is still awaiting acknowledgement.
+ *
+ * @param connection
+ * @return 0 on success, -1 on error or timeout
+ */
+PUBLIC int BoltConnection_reclaim_b(struct BoltConnection * connection);
+
 /**
  * Send all queued requests.
  *
@@ -228,6 +667,15 @@ PUBLIC int BoltConnection_reset_b(struct BoltConnection * connection);
  */
 PUBLIC int BoltConnection_send_b(struct BoltConnection * connection);
 
+/**
+ * Start sending all queued requests without blocking.
+ *
+ * @param connection
+ * @return 0 if all requests were sent immediately, -1 on failure,
+ *         BOLT_WAITING otherwise
+ */
+PUBLIC int BoltConnection_send_nb(struct BoltConnection * connection);
+
 /**
  * Take an exact amount of data from the receive buffer, deferring to
  * the socket if not enough data is available.
@@ -262,6 +710,90 @@ PUBLIC int BoltConnection_receive_b(struct BoltConnection * connection, char * b
  */
 PUBLIC int BoltConnection_fetch_b(struct BoltConnection * connection, bolt_request_t request);
 
+/**
+ * Fetch a batch of records from the result stream for a given request.
+ *
+ * This blocks like `BoltConnection_fetch_b` until the next value has been
+ * fetched. If that value is a record, it is moved into the first of the
+ * given values, after which as many further records as are already
+ * retained or buffered, up to `max` in total, are fetched into the
+ * following values without waiting for more data. Each record is decoded
+ * as by `BoltConnection_fetch_b`, except that lazy records are decoded
+ * in full. The values are reused from batch to batch, and each should
+ * have been created by `BoltValue_create`.
+ *
+ * Once the summary is reached, it is available from `BoltConnection_data`
+ * as for `BoltConnection_fetch_b`.
+ *
+ * @param connection the connection to fetch from
+ * @param request the request for which to fetch a response
+ * @param values array of values to receive record data (each in a `BOLT_LIST`)
+ * @param max number of values in the array
+ * @return >0 the number of records fetched into the array,
+ *         0 if summary metadata is received,
+ *         -1 if an error occurs
+ */
+PUBLIC int BoltConnection_fetch_batch_b(struct BoltConnection * connection, bolt_request_t request,
+                                        struct BoltValue ** values, int max);
+
+/**
+ * Fetch the remainder of the result stream for a given request into
+ * columns, one per record field, stopping once the summary is reached.
+ *
+ * Each column takes the type of its non-null values: a `BOLT_INT64_ARRAY`
+ * for integers, a `BOLT_FLOAT64_ARRAY` for floats and a
+ * `BOLT_STRING_ARRAY` for strings, with a zero or empty string in place
+ * of each null. Columns holding values of any other type, or values of
+ * more than one type, are instead returned as a `BOLT_LIST` of values.
+ * Alongside these, each field gets a `BOLT_BYTE_ARRAY` bitmap in which
+ * bit `i % 8` of byte `i / 8` is set if the field is null in row `i`.
+ *
+ * Once the summary is reached, it is available from `BoltConnection_data`
+ * as for `BoltConnection_fetch_b`.
+ *
+ * @param connection the connection to fetch from
+ * @param request the request for which to fetch a response
+ * @param columns value to receive a `BOLT_LIST` of columns
+ * @param nulls value to receive a `BOLT_LIST` of null bitmaps
+ * @return >=0 the number of rows fetched,
+ *         -1 if an error occurs
+ */
+PUBLIC int BoltConnection_fetch_columns_b(struct BoltConnection * connection, bolt_request_t request,
+                                          struct BoltValue * columns, struct BoltValue * nulls);
+
+/**
+ * Fetch the next value from the result stream for a given request
+ * without blocking.
+ *
+ * If a complete response message is already buffered, this completes
+ * immediately with the same outcome as `BoltConnection_fetch_b`.
+ * Otherwise, `BOLT_WAITING` is returned and the fetch is completed
+ * later by `BoltConnection_progress`.
+ *
+ * @param connection the connection to fetch from
+ * @param request the request for which to fetch a response
+ * @return 1 if record data is received,
+ *         0 if summary metadata is received,
+ *         -1 if an error occurs,
+ *         BOLT_WAITING if the response has not yet arrived
+ */
+PUBLIC int BoltConnection_fetch_nb(struct BoltConnection * connection, bolt_request_t request);
+
+/**
+ * Advance the non-blocking operation currently in progress on a
+ * connection as far as is possible without blocking.
+ *
+ * When this returns `BOLT_WAITING`, the `awaiting` field of the
+ * connection holds the socket events for which the caller should wait
+ * before calling this function again. Any other value is the outcome of
+ * the completed operation, as would be returned by the equivalent
+ * blocking function, and the connection stage reverts to `BOLT_IDLE`.
+ *
+ * @param connection
+ * @return outcome of the operation, or BOLT_WAITING
+ */
+PUBLIC int BoltConnection_progress(struct BoltConnection * connection);
+
 /**
  * Fetch values from the result stream for a given request, up to and
  * including the next summary. This will discard any unconsumed result
@@ -282,6 +814,44 @@ PUBLIC int BoltConnection_fetch_b(struct BoltConnection * connection, bolt_reque
  */
 PUBLIC int BoltConnection_fetch_summary_b(struct BoltConnection * connection, bolt_request_t request);
 
+/**
+ * Register callbacks to which the response to a loaded request will be
+ * delivered by `BoltConnection_dispatch_b`.
+ *
+ * Requests must be registered in the order in which they were loaded.
+ * Responses to requests loaded without callbacks are discarded during
+ * dispatch, as they would be by `BoltConnection_fetch_b`. The callbacks
+ * must remain valid until the response has been dispatched.
+ *
+ * @param connection the connection on which the request was loaded
+ * @param request the request, as returned by `BoltConnection_last_request`
+ * @param callbacks callbacks to receive the response
+ * @return 0 on success,
+ *         -1 if the request precedes one already registered
+ */
+PUBLIC int BoltConnection_set_callbacks(struct BoltConnection * connection, bolt_request_t request,
+                                        const struct BoltResponseCallbacks * callbacks);
+
+/**
+ * Transmit all queued requests then fetch the responses to every request
+ * registered through `BoltConnection_set_callbacks`, delivering each to
+ * its callbacks as it is received.
+ *
+ * Since all queued requests are transmitted together, any number of
+ * independent queries can be pipelined through a single round trip
+ * without matching each request to its response by hand. Requests
+ * loaded from within a callback are transmitted and dispatched before
+ * this function returns.
+ *
+ * This function will block until every response has been dispatched.
+ *
+ * @param connection the connection to dispatch responses from
+ * @return >=0 the number of responses dispatched,
+ *         -1 if an error occurs, in which case responses not yet
+ *         dispatched remain registered
+ */
+PUBLIC int BoltConnection_dispatch_b(struct BoltConnection * connection);
+
 /**
  * Obtain a pointer to the last fetched data values or summary metadata.
  *
@@ -295,11 +865,39 @@ PUBLIC int BoltConnection_fetch_summary_b(struct BoltConnection * connection, bo
  * Since the storage slot is recycled for each value received, pointers
  * will become invalid after subsequent receive function calls.
  *
+ * If the connection has `lazy_records` set, any fields of the last
+ * fetched record not yet accessed through `BoltConnection_record_field`
+ * are decoded first, so the record is always returned in full.
+ *
  * @param connection
- * @return pointer to a `BoltValue` data structure
+ * @return pointer to a `BoltValue` data structure, or NULL if a lazily
+ *         fetched record cannot be decoded
  */
 PUBLIC struct BoltValue * BoltConnection_data(struct BoltConnection * connection);
 
+/**
+ * Obtain a pointer to a field of the last fetched record.
+ *
+ * If the connection has `lazy_records` set, records are fetched as raw
+ * bytes together with an index of where each field begins. A record
+ * received in a single chunk is indexed in place and held in the
+ * receive buffer until the next fetch, while a record spanning several
+ * chunks is first copied out of it. Each field is then decoded the first
+ * time it is accessed through this function, so that fields never
+ * accessed are never decoded, unless the whole record is obtained from
+ * `BoltConnection_data`. Otherwise, this simply returns the field from
+ * the record.
+ *
+ * The pointer becomes invalid after subsequent receive function calls.
+ *
+ * @param connection
+ * @param index index of the field within the record
+ * @return pointer to the field value, or NULL if the last fetched value
+ *         is not a record, the index is out of range or the field
+ *         cannot be decoded
+ */
+PUBLIC struct BoltValue * BoltConnection_record_field(struct BoltConnection * connection, int32_t index);
+
 /**
  * Set the next Cypher statement template to be run on this connection
  * from a null-terminated string.
@@ -329,6 +927,28 @@ PUBLIC struct BoltValue * BoltConnection_cypher_parameter_x(struct BoltConnectio
 
 PUBLIC int BoltConnection_load_bookmark(struct BoltConnection * connection, const char * bookmark);
 
+/**
+ * Set the timeout for the next transaction, which is either begun
+ * explicitly or run as an auto-commit statement. The server terminates
+ * the transaction should it run for longer. Requires Bolt v3.
+ *
+ * @param connection
+ * @param timeout timeout in milliseconds
+ * @return 0 on success, -1 if unsupported by the protocol version
+ */
+PUBLIC int BoltConnection_load_tx_timeout(struct BoltConnection * connection, int64_t timeout);
+
+/**
+ * Set metadata for the next transaction, which the server attaches to
+ * the transaction for monitoring. The returned dictionary is populated
+ * by the caller before the transaction is loaded. Requires Bolt v3.
+ *
+ * @param connection
+ * @param size number of metadata entries
+ * @return dictionary of metadata entries, or NULL if unsupported by the protocol version
+ */
+PUBLIC struct BoltValue * BoltConnection_load_tx_metadata(struct BoltConnection * connection, int32_t size);
+
 PUBLIC int BoltConnection_load_begin_request(struct BoltConnection * connection);
 
 PUBLIC int BoltConnection_load_commit_request(struct BoltConnection * connection);
@@ -337,6 +957,126 @@ PUBLIC int BoltConnection_load_rollback_request(struct BoltConnection * connecti
 
 PUBLIC int BoltConnection_load_run_request(struct BoltConnection * connection);
 
+/**
+ * Create a statement for running repeatedly through
+ * `BoltConnection_load_statement_run_request`, encoding the statement
+ * and its parameter keys up front.
+ *
+ * @param cypher the Cypher statement
+ * @param cypher_size size of the statement in bytes
+ * @param keys null-terminated parameter keys
+ * @param n_parameters number of parameter keys
+ * @return the statement, or NULL if it cannot be encoded
+ */
+PUBLIC struct BoltStatement * BoltStatement_create(const char * cypher, size_t cypher_size, const char ** keys,
+                                                   int32_t n_parameters);
+
+/**
+ * Destroy a statement. The statement must no longer be in use by any
+ * connection.
+ *
+ * @param statement
+ */
+PUBLIC void BoltStatement_destroy(struct BoltStatement * statement);
+
+/**
+ * Load a request to run a statement created by `BoltStatement_create`,
+ * in place of the statement and parameters set on the connection. The
+ * encoded statement and keys are copied into the request, and only the
+ * parameter values are encoded. Bookmarks, a timeout and metadata loaded
+ * for the next transaction apply as for `BoltConnection_load_run_request`.
+ *
+ * @param connection
+ * @param statement
+ * @param parameters a `BOLT_LIST` of values, one per parameter key in
+ *                   order, or NULL for a statement without parameters
+ * @return 0 on success, -1 if the parameters do not match the statement
+ *         or cannot be encoded
+ */
+PUBLIC int BoltConnection_load_statement_run_request(struct BoltConnection * connection,
+                                                     const struct BoltStatement * statement,
+                                                     const struct BoltValue * parameters);
+
+/**
+ * Begin loading a request to run a statement whose parameters are then
+ * written one value at a time, straight into the transmit buffer, in
+ * place of the statement and parameters set on the connection. No
+ * `BoltValue` is built for the parameters, so large numbers of values
+ * can be sent without allocating or copying each one.
+ *
+ * The statement is followed by a map of `n_parameters` entries, each of
+ * which is written as a key through `BoltConnection_write_key` then a
+ * value. A list or map value is written as a header giving its size,
+ * followed by that many values or key-value pairs. Once every value has
+ * been written, the request is loaded by `BoltConnection_end_run_request`.
+ * No other request may be loaded in between. If any value cannot be
+ * written, the request is abandoned and later writes fail.
+ *
+ * Bookmarks, a timeout and metadata loaded for the next transaction
+ * apply as for `BoltConnection_load_run_request`.
+ *
+ * @param connection
+ * @param cypher the statement
+ * @param cypher_size size of the statement in bytes
+ * @param n_parameters number of parameters that will be written
+ * @return 0 on success, -1 if a request is already being written or the
+ *         statement cannot be encoded
+ */
+PUBLIC int BoltConnection_begin_run_request(struct BoltConnection * connection, const char * cypher,
+                                            size_t cypher_size, int32_t n_parameters);
+
+/**
+ * Load the request begun by `BoltConnection_begin_run_request` once all
+ * of its parameters have been written.
+ *
+ * @param connection
+ * @return 0 on success, -1 if no request is being written or parameters
+ *         remain to be written
+ */
+PUBLIC int BoltConnection_end_run_request(struct BoltConnection * connection);
+
+/**
+ * Write a parameter key to the request being written.
+ *
+ * @param connection
+ * @param key
+ * @param key_size
+ * @return 0 on success, -1 on error
+ */
+PUBLIC int BoltConnection_write_key(struct BoltConnection * connection, const char * key, int32_t key_size);
+
+PUBLIC int BoltConnection_write_null(struct BoltConnection * connection);
+
+PUBLIC int BoltConnection_write_boolean(struct BoltConnection * connection, int value);
+
+PUBLIC int BoltConnection_write_integer(struct BoltConnection * connection, int64_t value);
+
+PUBLIC int BoltConnection_write_float(struct BoltConnection * connection, double value);
+
+PUBLIC int BoltConnection_write_string(struct BoltConnection * connection, const char * data, int32_t size);
+
+PUBLIC int BoltConnection_write_bytes(struct BoltConnection * connection, const char * data, int32_t size);
+
+/**
+ * Write the header of a list parameter value, to be followed by `size`
+ * values, to the request being written.
+ *
+ * @param connection
+ * @param size number of values in the list
+ * @return 0 on success, -1 on error
+ */
+PUBLIC int BoltConnection_write_list(struct BoltConnection * connection, int32_t size);
+
+/**
+ * Write the header of a map parameter value, to be followed by `size`
+ * keys each with a value, to the request being written.
+ *
+ * @param connection
+ * @param size number of entries in the map
+ * @return 0 on success, -1 on error
+ */
+PUBLIC int BoltConnection_write_map(struct BoltConnection * connection, int32_t size);
+
 PUBLIC int BoltConnection_load_discard_request(struct BoltConnection * connection, int32_t n);
 
 PUBLIC int BoltConnection_load_pull_request(struct BoltConnection * connection, int32_t n);
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2002-2018 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_EVENTS_H
+#define SEABOLT_EVENTS_H
+
+
+#include "direct.h"
+
+
+struct BoltEventLoop;
+
+/**
+ * Callback invoked once a non-blocking operation started on a watched
+ * connection has completed.
+ *
+ * The connection is no longer watched by the time the handler is called,
+ * and the loop does not touch it afterwards. The handler may therefore
+ * close and destroy the connection, or start another non-blocking
+ * operation and watch the connection again if that returns BOLT_WAITING.
+ *
+ * @param loop the event loop on which the connection was watched
+ * @param connection the connection on which the operation completed
+ * @param result the outcome of the operation, as would have been
+ *               returned by the equivalent blocking call
+ * @param data the user data passed to BoltEventLoop_watch
+ */
+typedef void (*bolt_event_handler_t)(struct BoltEventLoop * loop, struct BoltConnection * connection,
+                                     int result, void * data);
+
+struct BoltEventWatch
+{
+    struct BoltConnection * connection;
+    /// Socket registered for this watch, or -1 if not registered
+    int socket;
+    /// Events currently registered for this watch
+    int events;
+    bolt_event_handler_t handler;
+    void * data;
+    struct BoltEventWatch * next;
+};
+
+struct BoltEventLoop
+{
+    /// Underlying event notification descriptor, or -1 if events arrive through a ring
+    int descriptor;
+    /// The ring through which watched connections carry out socket I/O (io_uring builds only)
+    struct BoltRing * ring;
+    /// Number of connections currently watched
+    int n_watched;
+    struct BoltEventWatch * watches;
+    /// Watches being progressed in the current round, each cleared once released
+    struct BoltEventWatch ** ready;
+    /// Number of entries in ready
+    int n_ready;
+};
+
+
+/**
+ * Create an event loop for driving many non-blocking connections from
+ * a single thread.
+ *
+ * @return a new event loop, or NULL if event notification is unavailable
+ */
+PUBLIC struct BoltEventLoop * BoltEventLoop_create();
+
+/**
+ * Destroy an event loop. Watched connections are not closed.
+ *
+ * @param loop
+ */
+PUBLIC void BoltEventLoop_destroy(struct BoltEventLoop * loop);
+
+/**
+ * Watch a connection on which a non-blocking operation has returned
+ * BOLT_WAITING. The handler is called once that operation completes,
+ * after the connection has stopped being watched. To continue, the
+ * handler starts another operation and watches the connection again.
+ *
+ * @param loop
+ * @param connection
+ * @param handler
+ * @param data user data passed through to the handler
+ * @return 0 on success, -1 on error
+ */
+PUBLIC int BoltEventLoop_watch(struct BoltEventLoop * loop, struct BoltConnection * connection,
+                               bolt_event_handler_t handler, void * data);
+
+/**
+ * Stop watching a connection without waiting for its operation to
+ * complete, so that its handler is never called. A connection must be
+ * unwatched before it is closed or destroyed while an operation on it
+ * is still pending.
+ *
+ * @param loop
+ * @param connection
+ * @return 0 on success, -1 if the connection is not watched
+ */
+PUBLIC int BoltEventLoop_unwatch(struct BoltEventLoop * loop, struct BoltConnection * connection);
+
+/**
+ * Wait for socket events and progress all ready connections, calling
+ * handlers for those operations that complete.
+ *
+ * @param loop
+ * @param timeout maximum time to wait in milliseconds, or -1 to wait indefinitely
+ * @return the number of operations completed, or -1 on error
+ */
+PUBLIC int BoltEventLoop_run_once(struct BoltEventLoop * loop, int timeout);
+
+/**
+ * Run the event loop until no connections remain watched.
+ *
+ * @param loop
+ * @return 0 on success, -1 on error
+ */
+PUBLIC int BoltEventLoop_run(struct BoltEventLoop * loop);
+
+
+#endif // SEABOLT_EVENTS_H
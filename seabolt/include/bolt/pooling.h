@@ -28,6 +28,7 @@
 #include <pthread.h>
 
 #include "direct.h"
+#include "security.h"
 
 
 struct BoltConnectionPool
@@ -38,6 +39,16 @@ struct BoltConnectionPool
     const struct BoltUserProfile * profile;
     size_t size;
     struct BoltConnection * connections;
+    /// Time limits applied to each pooled connection
+    struct BoltTimeouts timeouts;
+    /// Options applied to the socket of each pooled connection
+    struct BoltSocketOptions socket_options;
+    /// Policy for transmitting requests as they are loaded on each pooled connection
+    struct BoltFlushPolicy flush_policy;
+    /// Policy for responses arriving ahead of the one fetched on each pooled connection
+    struct BoltRetentionPolicy retention_policy;
+    /// TLS state shared by all pooled connections (secure pools only)
+    struct BoltSecurityContext * security_context;
 };
 
 
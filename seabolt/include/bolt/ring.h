@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2002-2018 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_RING_H
+#define SEABOLT_RING_H
+
+
+#include "direct.h"
+
+
+/// Default number of submission queue entries for a ring
+#define BOLT_RING_ENTRIES 256
+
+
+/**
+ * Socket operations that a connection may have in flight on a ring.
+ */
+enum BoltRingOperation
+{
+    BOLT_RING_SEND = 1,
+    BOLT_RING_RECEIVE = 2,
+    BOLT_RING_POLL = 4,
+};
+
+struct BoltRing;
+
+/**
+ * State of a connection attached to a ring.
+ */
+struct BoltRingSlot
+{
+    struct BoltConnection * connection;
+    /// Operations requested and not yet submitted (BoltRingOperation flags)
+    int requested;
+    /// Operations submitted and not yet completed (BoltRingOperation flags)
+    int pending;
+    /// Operations completed and not yet consumed by the connection (BoltRingOperation flags)
+    int completed;
+    /// Socket events to await before retrying an operation that would have blocked
+    int blocked;
+    /// Number of polls submitted and not yet completed
+    int n_polls;
+    /// Socket events covered by the polls in flight
+    int poll_events;
+    /// Flags for the requested send
+    int send_flags;
+    /// Outcome of the last send: bytes sent or a negated error code
+    int send_result;
+    /// Offset in the receive buffer at which the submitted receive places data
+    int receive_offset;
+    /// Outcome of the last receive: bytes received or a negated error code
+    int receive_result;
+    /// Index of the registered buffer reserved for the receive buffer, or -1 if none
+    int buffer_index;
+    /// Memory currently registered at that index
+    char * registered_data;
+    int registered_size;
+    struct BoltRingSlot * next;
+};
+
+
+/**
+ * Create an io_uring instance through which the socket I/O of attached
+ * connections is submitted and completed in batches.
+ *
+ * @param entries number of submission queue entries, e.g. BOLT_RING_ENTRIES
+ * @return a new ring, or NULL if io_uring is unavailable
+ */
+PUBLIC struct BoltRing * BoltRing_create(int entries);
+
+/**
+ * Destroy a ring, detaching all connections still attached to it.
+ *
+ * @param ring
+ */
+PUBLIC void BoltRing_destroy(struct BoltRing * ring);
+
+/**
+ * Attach a connection to a ring, so that its socket I/O is carried out
+ * through the ring rather than by individual system calls. A connection
+ * is attached to at most one ring and remains attached across opens.
+ *
+ * @param ring
+ * @param connection
+ * @return 0 on success, -1 on error
+ */
+PUBLIC int BoltRing_attach(struct BoltRing * ring, struct BoltConnection * connection);
+
+/**
+ * Detach a connection from its ring, cancelling any operations in flight.
+ *
+ * @param connection
+ */
+PUBLIC void BoltRing_detach(struct BoltConnection * connection);
+
+/**
+ * Submit all requested operations and wait for completions.
+ *
+ * @param ring
+ * @param timeout maximum time to wait for a completion in milliseconds,
+ *                or -1 to wait indefinitely
+ * @return the number of completions, or -1 on error
+ */
+PUBLIC int BoltRing_enter(struct BoltRing * ring, int timeout);
+
+/**
+ * Request a send of the segments queued on a connection. The message is
+ * gathered from the segments as they stand when the ring next submits.
+ *
+ * @param connection
+ * @param flags send flags
+ */
+void BoltRing_send(struct BoltConnection * connection, int flags);
+
+/**
+ * Submit a receive into a region of the receive buffer of a connection.
+ * The buffer must not be reallocated until the receive completes.
+ *
+ * @param connection
+ * @param offset position in the receive buffer at which to place data
+ * @param size maximum number of bytes to receive
+ * @return 0 on success, -1 on error
+ */
+int BoltRing_receive(struct BoltConnection * connection, int offset, int size);
+
+/**
+ * Poll the sockets of a connection for the events awaited by its current
+ * operation, unless operations already in flight will wake it.
+ *
+ * @param connection
+ * @return 0 on success, -1 on error
+ */
+int BoltRing_arm(struct BoltConnection * connection);
+
+/**
+ * Determine whether a connection has completions relevant to the
+ * events awaited by its current operation.
+ *
+ * @param connection
+ * @return non-zero if the connection should be progressed
+ */
+int BoltRing_ready(struct BoltConnection * connection);
+
+/**
+ * Cancel all operations in flight on a socket of a connection, waiting
+ * until the kernel has released the socket and any buffers in use.
+ *
+ * @param connection
+ * @param socket
+ */
+void BoltRing_cancel(struct BoltConnection * connection, int socket);
+
+
+#endif // SEABOLT_RING_H
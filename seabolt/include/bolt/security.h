@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2002-2018 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_SECURITY_H
+#define SEABOLT_SECURITY_H
+
+
+#include <pthread.h>
+
+#include "config.h"
+
+
+#define BOLT_MAX_CACHED_SESSIONS 16
+
+#define BOLT_TLS_1_2 0x0303
+#define BOLT_TLS_1_3 0x0304
+
+
+struct BoltCachedSession
+{
+    /// Host and port of the server with which the session was established
+    char * server;
+    /// Session available for resumption, or NULL if none has been received
+    struct ssl_session_st * session;
+};
+
+/**
+ * TLS state shared between secure connections, comprising a TLS
+ * context with the system trust store loaded, and a cache of client
+ * sessions from which reconnections to the same server can resume
+ * instead of carrying out a full handshake.
+ */
+struct BoltSecurityContext
+{
+    pthread_mutex_t mutex;
+    /// The TLS context from which secure sockets are created
+    struct ssl_ctx_st * ssl_context;
+    /// Non-zero to send the Bolt handshake as TLS 1.3 early data when resuming a session
+    int early_data;
+    /// Number of servers for which sessions have been cached
+    int n_sessions;
+    /// Position in the cache at which the next new server will be stored
+    int next_session;
+    struct BoltCachedSession sessions[BOLT_MAX_CACHED_SESSIONS];
+};
+
+
+/**
+ * Create a new security context, loading the system trust store.
+ *
+ * @return a new security context, or NULL if one could not be created
+ */
+PUBLIC struct BoltSecurityContext * BoltSecurityContext_create();
+
+/**
+ * Destroy a security context. Connections using the context must
+ * already have been closed.
+ *
+ * @param context
+ */
+PUBLIC void BoltSecurityContext_destroy(struct BoltSecurityContext * context);
+
+/**
+ * Restrict the TLS versions that may be negotiated by connections
+ * using a security context. By default, TLS 1.2 and TLS 1.3 are both
+ * permitted, with TLS 1.3 preferred wherever the server supports it.
+ *
+ * @param context
+ * @param min_version lowest version permitted (BOLT_TLS_1_2 or BOLT_TLS_1_3)
+ * @param max_version highest version permitted (BOLT_TLS_1_2 or BOLT_TLS_1_3)
+ * @return 0 on success, -1 if the version range is not valid
+ */
+PUBLIC int BoltSecurityContext_set_tls_versions(struct BoltSecurityContext * context, int min_version,
+                                                int max_version);
+
+/**
+ * Enable or disable 0-RTT mode, in which a connection resuming a
+ * TLS 1.3 session that permits early data sends the Bolt handshake
+ * along with the ClientHello instead of waiting for the TLS handshake
+ * to complete. If the server rejects the early data, the Bolt
+ * handshake is sent again once the TLS handshake has completed.
+ *
+ * Early data can be replayed by an attacker, which is harmless for
+ * the Bolt handshake as it carries no request.
+ *
+ * @param context
+ * @param enabled non-zero to enable 0-RTT mode
+ */
+PUBLIC void BoltSecurityContext_set_early_data(struct BoltSecurityContext * context, int enabled);
+
+/**
+ * Enable or disable kernel TLS offload. Once the TLS handshake has
+ * completed, record encryption and decryption are handed over to the
+ * kernel where it supports this for the negotiated cipher, after which
+ * data is sent and received using plain socket calls. Connections fall
+ * back to user space TLS wherever offload is unavailable.
+ *
+ * @param context
+ * @param enabled non-zero to enable kernel TLS offload
+ * @return 0 on success, -1 if the TLS library does not support offload
+ */
+PUBLIC int BoltSecurityContext_set_kernel_tls(struct BoltSecurityContext * context, int enabled);
+
+/**
+ * Retrieve the process-wide security context, created by
+ * `Bolt_startup` and used by any connection that has not been given a
+ * context of its own.
+ *
+ * @return the shared security context, or NULL if one could not be created
+ */
+PUBLIC struct BoltSecurityContext * BoltSecurityContext_default();
+
+/**
+ * Destroy the process-wide security context, if one has been created.
+ * This is called by `Bolt_shutdown`.
+ */
+PUBLIC void BoltSecurityContext_destroy_default();
+
+/**
+ * Create a secure socket wrapper for a new connection to a server,
+ * primed to resume any session cached for that server.
+ *
+ * @param context
+ * @param server host and port of the server, used as the session cache key
+ * @return a new secure socket wrapper, or NULL on error
+ */
+PUBLIC struct ssl_st * BoltSecurityContext_create_ssl(struct BoltSecurityContext * context, const char * server);
+
+
+#endif // SEABOLT_SECURITY_H
@@ -178,6 +178,15 @@ void _format(struct BoltValue* value, enum BoltType type, int16_t subtype, int32
  */
 void _resize(struct BoltValue* value, int32_t size, int multiplier);
 
+/**
+ * Exchange the contents of two values, transferring ownership of any
+ * storage that they hold.
+ *
+ * @param value
+ * @param other
+ */
+void _exchange(struct BoltValue* value, struct BoltValue* other);
+
 
 /**
  * Create a new BoltValue instance.
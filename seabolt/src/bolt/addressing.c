@@ -39,8 +39,51 @@ struct BoltAddress* BoltAddress_create(const char * host, const char * port)
     return address;
 }
 
+#if USE_POSIXSOCK
+/**
+ * Resolve an address whose host is the path of a Unix domain socket.
+ *
+ * @param address
+ * @return 0 on success, or EAI_NONAME if the path is too long
+ */
+int resolve_unix(struct BoltAddress * address)
+{
+    BoltLog_info("bolt: Resolving Unix domain socket %s", address->host);
+    struct sockaddr_un unix_address;
+    if (strlen(address->host) >= sizeof(unix_address.sun_path))
+    {
+        BoltLog_info("bolt: Unix domain socket path is too long");
+        return EAI_NONAME;
+    }
+    memset(&unix_address, 0, sizeof(unix_address));
+    unix_address.sun_family = AF_UNIX;
+    strcpy(unix_address.sun_path, address->host);
+    if (address->resolved_hosts == NULL)
+    {
+        address->resolved_hosts = BoltMem_allocate(SOCKADDR_STORAGE_SIZE);
+    }
+    else
+    {
+        address->resolved_hosts = BoltMem_reallocate(address->resolved_hosts,
+                                                     address->n_resolved_hosts * SOCKADDR_STORAGE_SIZE,
+                                                     SOCKADDR_STORAGE_SIZE);
+    }
+    address->n_resolved_hosts = 1;
+    memset(&address->resolved_hosts[0], 0, SOCKADDR_STORAGE_SIZE);
+    memcpy(&address->resolved_hosts[0], &unix_address, sizeof(unix_address));
+    address->resolved_port = 0;
+    return 0;
+}
+#endif // USE_POSIXSOCK
+
 int BoltAddress_resolve_b(struct BoltAddress * address)
 {
+#if USE_POSIXSOCK
+    if (address->host[0] == '/')
+    {
+        return resolve_unix(address);
+    }
+#endif
     if (strchr(address->host, ':') == NULL)
     {
         BoltLog_info("bolt: Resolving address %s:%s", address->host, address->port);
@@ -133,6 +176,18 @@ int BoltAddress_copy_resolved_host(struct BoltAddress * address, size_t index, c
                                    socklen_t buffer_size)
 {
     struct sockaddr_storage * resolved_host = &address->resolved_hosts[index];
+#if USE_POSIXSOCK
+    if (resolved_host->ss_family == AF_UNIX)
+    {
+        const char * path = ((struct sockaddr_un *)(resolved_host))->sun_path;
+        if (strlen(path) >= buffer_size)
+        {
+            return -1;
+        }
+        strcpy(buffer, path);
+        return AF_UNIX;
+    }
+#endif
     int status = getnameinfo((const struct sockaddr *)(resolved_host), SOCKADDR_STORAGE_SIZE, buffer, buffer_size, NULL, 0, NI_NUMERICHOST);
     switch (status)
     {
@@ -50,7 +50,7 @@ void BoltBuffer_compact(struct BoltBuffer* buffer)
         int available = buffer->extent - buffer->cursor;
         if (available > 0)
         {
-            memcpy(&buffer->data[0], &buffer->data[buffer->cursor], (size_t)(available));
+            memmove(&buffer->data[0], &buffer->data[buffer->cursor], (size_t)(available));
         }
         buffer->cursor = 0;
         buffer->extent = available;
@@ -68,7 +68,13 @@ char* BoltBuffer_load_target(struct BoltBuffer* buffer, int size)
     int available = BoltBuffer_loadable(buffer);
     if (size > available)
     {
+        // Grow geometrically so that many small loads into a large
+        // buffer do not each require a reallocation
         int new_size = buffer->size + (size - available);
+        if (new_size < 2 * buffer->size)
+        {
+            new_size = 2 * buffer->size;
+        }
         buffer->data = BoltMem_reallocate(buffer->data, (size_t)(buffer->size), (size_t)(new_size));
         buffer->size = new_size;
     }
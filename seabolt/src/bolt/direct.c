@@ -17,7 +17,7 @@
  * limitations under the License.
  */
 
-
+#include <limits.h>
 #include <netinet/tcp.h>
 
 #include "bolt/buffering.h"
@@ -25,21 +25,57 @@
 #include "bolt/direct.h"
 #include "bolt/logging.h"
 #include "bolt/mem.h"
+#include "bolt/ring.h"
+#include "bolt/security.h"
 
+#include "protocol/protocol.h"
 #include "protocol/v1.h"
 
 
 #define INITIAL_TX_BUFFER_SIZE 8192
 #define INITIAL_RX_BUFFER_SIZE 8192
+#define INITIAL_TX_SEGMENTS_SIZE 16
+#define INITIAL_PENDING_RESPONSES_SIZE 16
+
+// Maximum number of segments gathered into a single vectored write
+#define MAX_TX_VECTOR_SIZE 64
+// Segments of at least this size are written to a secure socket directly,
+// smaller segments are coalesced into a single record
+#define MIN_TX_DIRECT_SIZE 1024
+#define MAX_TX_RECORD_SIZE 16384
+
+// Flag used to hold back a partial packet when more data is to follow
+#ifdef MSG_MORE
+#define TX_MORE MSG_MORE
+#else
+#define TX_MORE 0
+#endif
+
+// Flag used to send data without copying it, where supported
+#if defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define ZERO_COPY 1
+#define TX_ZERO_COPY MSG_ZEROCOPY
+#else
+#define ZERO_COPY 0
+#define TX_ZERO_COPY 0
+#endif
+
+// Delay between starting successive connection attempts (RFC 8305)
+#define CONNECT_ATTEMPT_DELAY 250
 
 #define SOCKET(domain, type, protocol) socket(domain, type, protocol)
 #define CONNECT(socket, address, address_size) connect(socket, address, address_size)
 #define SHUTDOWN(socket, how) shutdown(socket, how)
+#define CLOSE(socket) close(socket)
+#define POLL(fds, n_fds, timeout) poll(fds, n_fds, timeout)
+#define SETSOCKOPT(socket, level, name, value) setsockopt(socket, level, name, (const char *)(value), sizeof(*(value)))
 #define TRANSMIT(socket, data, size, flags) (int)(send(socket, data, (size_t)(size), flags))
+#define TRANSMIT_M(socket, message, flags) (int)(sendmsg(socket, message, flags))
 #define TRANSMIT_S(socket, data, size, flags) SSL_write(socket, data, size)
 #define RECEIVE(socket, buffer, size, flags) (int)(recv(socket, buffer, (size_t)(size), flags))
 #define RECEIVE_S(socket, buffer, size, flags) SSL_read(socket, buffer, size)
-#define ADDR_SIZE(address) address->ss_family == AF_INET ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6)
+#define ADDR_SIZE(address) (address->ss_family == AF_INET ? sizeof(struct sockaddr_in) : \
+                            address->ss_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_un))
 
 
 #define TRY(code) { int status = (code); if (status == -1) { set_status(connection, BOLT_DEFUNCT, last_error()); return status; } }
@@ -106,6 +142,21 @@ enum BoltConnectionError last_error()
 #endif
 }
 
+/**
+ * Determine whether the last socket operation failed only because it
+ * would otherwise have blocked.
+ *
+ * @return 1 if the operation would have blocked, 0 otherwise
+ */
+int would_block()
+{
+#if USE_WINSOCK
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
 void set_status(struct BoltConnection * connection, enum BoltConnectionStatus status, enum BoltConnectionError error)
 {
     enum BoltConnectionStatus old_status = connection->status;
@@ -134,492 +185,2399 @@ void set_status(struct BoltConnection * connection, enum BoltConnectionStatus st
     }
 }
 
-int open_b(struct BoltConnection * connection, enum BoltTransport transport, const struct sockaddr_storage * address)
+/**
+ * Obtain the current time from a clock that is unaffected by changes
+ * to the system time, against which deadlines are measured.
+ *
+ * @param t
+ */
+void monotonic_time(struct timespec * t)
 {
-    memset(&connection->metrics, 0, sizeof(connection->metrics));
-    connection->transport = transport;
-    switch (address->ss_family)
-    {
-        case AF_INET:
-        case AF_INET6:
-        {
-            char host_string[NI_MAXHOST];
-			char port_string[NI_MAXSERV];
-			getnameinfo((const struct sockaddr *)(address), ADDR_SIZE(address),
-				host_string, NI_MAXHOST, port_string, NI_MAXSERV, NI_NUMERICHOST | NI_NUMERICSERV);
-			BoltLog_info("bolt: Opening %s connection to %s at port %s", 
-				address->ss_family == AF_INET ? "IPv4" : "IPv6", &host_string, &port_string);
-            break;
-        }
-        default:
-            BoltLog_error("bolt: Unsupported address family %d", address->ss_family);
-            set_status(connection, BOLT_DEFUNCT, BOLT_UNSUPPORTED);
-            return -1;
-    }
-    connection->socket = SOCKET(address->ss_family, SOCK_STREAM, IPPROTO_TCP);
-    if (connection->socket == -1)
-    {
-        set_status(connection, BOLT_DEFUNCT, last_error());
-		return -1;
-    }
-    const int TRUE = 1;
-    // TODO: socket options in Windows
-    TRY(setsockopt(connection->socket, SOL_SOCKET, SO_KEEPALIVE, &TRUE, sizeof(TRUE)));
-    TRY(setsockopt(connection->socket, IPPROTO_TCP, TCP_NODELAY, &TRUE, sizeof(TRUE)));
-    TRY(CONNECT(connection->socket, (struct sockaddr *)(address), ADDR_SIZE(address)));
-    timespec_get(&connection->metrics.time_opened, TIME_UTC);
-    connection->tx_buffer = BoltBuffer_create(INITIAL_TX_BUFFER_SIZE);
-    connection->rx_buffer = BoltBuffer_create(INITIAL_RX_BUFFER_SIZE);
-    return 0;
+#if USE_WINSOCK
+    ULONGLONG ms = GetTickCount64();
+    t->tv_sec = (time_t)(ms / 1000);
+    t->tv_nsec = (long)(ms % 1000) * 1000000;
+#else
+    clock_gettime(CLOCK_MONOTONIC, t);
+#endif
 }
 
-int secure_b(struct BoltConnection * connection)
+/**
+ * Set a time a given number of milliseconds from now, on the monotonic clock.
+ *
+ * @param t
+ * @param delay
+ */
+void set_time(struct timespec * t, int delay)
 {
-    // TODO: investigate ways to provide a greater resolution of TLS errors
-    BoltLog_info("bolt: Securing socket");
-    SSL_library_init();
-    SSL_load_error_strings();
-    OpenSSL_add_all_algorithms();
-    connection->ssl_context = SSL_CTX_new(TLSv1_2_client_method());
-    if (connection->ssl_context == NULL)
-    {
-        set_status(connection, BOLT_DEFUNCT, BOLT_TLS_ERROR);
-        return -1;
-    }
-    if (SSL_CTX_set_default_verify_paths(connection->ssl_context) != 1)
+    monotonic_time(t);
+    t->tv_sec += delay / 1000;
+    t->tv_nsec += (long)(delay % 1000) * 1000000;
+    if (t->tv_nsec >= 1000000000)
     {
-        set_status(connection, BOLT_DEFUNCT, BOLT_TLS_ERROR);
-        return -1;
+        t->tv_sec += 1;
+        t->tv_nsec -= 1000000000;
     }
-    connection->ssl = SSL_new(connection->ssl_context);
-    int linked_socket = SSL_set_fd(connection->ssl, connection->socket);
-    if (linked_socket != 1)
+}
+
+/**
+ * Determine the time remaining until a given time.
+ *
+ * @param t the time on the monotonic clock, or zero for no time
+ * @return remaining time in milliseconds, or -1 for no time
+ */
+int remaining(const struct timespec * t)
+{
+    if (t->tv_sec == 0 && t->tv_nsec == 0)
     {
-        set_status(connection, BOLT_DEFUNCT, BOLT_TLS_ERROR);
         return -1;
     }
-    int connected = SSL_connect(connection->ssl);
-    if (connected != 1)
+    struct timespec now;
+    monotonic_time(&now);
+    long long ms = (long long)(t->tv_sec - now.tv_sec) * 1000 + (t->tv_nsec - now.tv_nsec) / 1000000;
+    if (ms < 0)
     {
-        set_status(connection, BOLT_DEFUNCT, BOLT_TLS_ERROR);
-        return -1;
+        return 0;
     }
-    return 0;
+    return ms > INT_MAX ? INT_MAX : (int)(ms);
 }
 
-void close_b(struct BoltConnection * connection)
+/**
+ * Start a new stage of a non-blocking operation, setting a deadline
+ * for its completion if a timeout applies.
+ *
+ * @param connection
+ * @param stage
+ * @param timeout timeout in milliseconds, or 0 for no deadline
+ */
+void begin(struct BoltConnection * connection, enum BoltConnectionStage stage, int timeout)
 {
-    BoltLog_info("bolt: Closing connection");
-    switch(connection->protocol_version)
+    connection->stage = stage;
+    if (timeout > 0)
     {
-        case 1:
-            BoltProtocolV1_destroy_state(connection->protocol_state);
-            connection->protocol_state = NULL;
-            break;
-        default:
-            break;
+        set_time(&connection->deadline, timeout);
     }
-    connection->protocol_version = 0;
-    switch(connection->transport)
+    else
     {
-        case BOLT_SOCKET:
-        {
-            SHUTDOWN(connection->socket, SHUT_RDWR);
-            break;
-        }
-        case BOLT_SECURE_SOCKET:
-        {
-            if (connection->ssl != NULL)   {
-                SSL_shutdown(connection->ssl);
-                SSL_free(connection->ssl);
-                connection->ssl = NULL;
-            }
-            if (connection->ssl_context != NULL)   {
-                SSL_CTX_free(connection->ssl_context);
-                connection->ssl_context = NULL;
-            }
-            SHUTDOWN(connection->socket, SHUT_RDWR);
-            break;
-        }
+        connection->deadline.tv_sec = 0;
+        connection->deadline.tv_nsec = 0;
     }
-    timespec_get(&connection->metrics.time_closed, TIME_UTC);
-    connection->socket = 0;
-    set_status(connection, BOLT_DISCONNECTED, BOLT_NO_ERROR);
 }
 
-int send_b(struct BoltConnection * connection, const char * data, int size)
+int can_attempt(struct BoltConnection * connection);
+
+void transmitted(struct BoltConnection * connection, int size);
+
+int BoltConnection_time_remaining(struct BoltConnection * connection)
 {
-    if (size == 0)
-    {
-        return 0;
-    }
-//    printf("bolt: (Sending");
-//    for (int i = 0; i < size; i++) { printf(" %c%c", hex1(data, i), hex0(data, i)); }
-//    printf(")\n");
-    int remaining = size;
-    int total_sent = 0;
-    while (total_sent < size)
+    int time_remaining = remaining(&connection->deadline);
+    if (connection->stage == BOLT_CONNECTING && connection->n_attempts > 0 && can_attempt(connection))
     {
-        int sent = 0;
-        switch(connection->transport)
-        {
-            case BOLT_SOCKET:
-            {
-                sent = TRANSMIT(connection->socket, data, size, 0);
-                break;
-            }
-            case BOLT_SECURE_SOCKET:
-            {
-                sent = TRANSMIT_S(connection->ssl, data, size, 0);
-                break;
-            }
-        }
-        if (sent >= 0)
-        {
-            connection->metrics.bytes_sent += sent;
-            total_sent += sent;
-            remaining -= sent;
-        }
-        else
+        int attempt_remaining = remaining(&connection->next_attempt);
+        if (time_remaining == -1 || attempt_remaining < time_remaining)
         {
-            switch (connection->transport)
-            {
-                case BOLT_SOCKET:
-                    set_status(connection, BOLT_DEFUNCT, last_error());
-                    BoltLog_error("bolt: Socket error %d on transmit", connection->error);
-                    break;
-                case BOLT_SECURE_SOCKET:
-                    set_status(connection, BOLT_DEFUNCT, SSL_get_error(connection->ssl, sent));
-                    BoltLog_error("bolt: SSL error %d on transmit", connection->error);
-                    break;
-            }
-            return -1;
+            time_remaining = attempt_remaining;
         }
     }
-    BoltLog_info("bolt: (Sent %d of %d bytes)", total_sent, size);
-    return total_sent;
+    return time_remaining;
 }
 
 /**
- * Attempt to receive between min_size and max_size bytes.
+ * Abandon the operation in progress because its deadline has passed.
  *
  * @param connection
- * @param buffer
- * @param min_size
- * @param max_size
- * @return
+ * @return -1
  */
-int receive_b(struct BoltConnection * connection, char * buffer, int min_size, int max_size)
+int timed_out(struct BoltConnection * connection)
 {
-    if (min_size == 0)
-    {
-        return 0;
-    }
-    int max_remaining = max_size;
-    int total_received = 0;
-    while (total_received < min_size)
+    BoltLog_error("bolt: Timed out");
+    set_status(connection, BOLT_DEFUNCT, BOLT_TIMED_OUT);
+    return -1;
+}
+
+/**
+ * Record the outcome of an unsuccessful TLS operation, returning
+ * BOLT_WAITING if the operation can be retried once the socket
+ * becomes ready.
+ *
+ * @param connection
+ * @param rv return value of the failed TLS call
+ * @param action description of the TLS operation, for logging
+ * @return BOLT_WAITING or -1
+ */
+int ssl_failure(struct BoltConnection * connection, int rv, const char * action)
+{
+    int error = SSL_get_error(connection->ssl, rv);
+    switch (error)
     {
-        int received = 0;
-        switch (connection->transport)
-        {
-            case BOLT_SOCKET:
-                received = RECEIVE(connection->socket, buffer, max_remaining, 0);
-                break;
-            case BOLT_SECURE_SOCKET:
-                received = RECEIVE_S(connection->ssl, buffer, max_remaining, 0);
-                break;
-        }
-        if (received > 0)
-        {
-            connection->metrics.bytes_received += received;
-            total_received += received;
-            max_remaining -= received;
-        }
-        else if (received == 0)
-        {
+        case SSL_ERROR_WANT_READ:
+            connection->awaiting = BOLT_READABLE;
+            return BOLT_WAITING;
+        case SSL_ERROR_WANT_WRITE:
+            connection->awaiting = BOLT_WRITABLE;
+            return BOLT_WAITING;
+        case SSL_ERROR_ZERO_RETURN:
             BoltLog_info("bolt: Detected end of transmission");
             set_status(connection, BOLT_DISCONNECTED, BOLT_END_OF_TRANSMISSION);
-            break;
-        }
-        else
-        {
-            switch (connection->transport)
-            {
-                case BOLT_SOCKET:
-                    set_status(connection, BOLT_DEFUNCT, last_error());
-                    BoltLog_error("bolt: Socket error %d on receive", connection->error);
-                    break;
-                case BOLT_SECURE_SOCKET:
-                    set_status(connection, BOLT_DEFUNCT, SSL_get_error(connection->ssl, received));
-                    BoltLog_error("bolt: SSL error %d on receive", connection->error);
-                    break;
-            }
             return -1;
-        }
-    }
-    if (min_size == max_size)
-    {
-        BoltLog_info("bolt: (Received %d of %d bytes)", total_received, max_size);
-    }
-    else
-    {
-        BoltLog_info("bolt: (Received %d of %d..%d bytes)", total_received, min_size, max_size);
+        case SSL_ERROR_SYSCALL:
+            set_status(connection, BOLT_DEFUNCT, rv == 0 ? BOLT_END_OF_TRANSMISSION : last_error());
+            BoltLog_error("bolt: Socket error %d on %s", connection->error, action);
+            return -1;
+        default:
+            set_status(connection, BOLT_DEFUNCT, BOLT_TLS_ERROR);
+            BoltLog_error("bolt: SSL error %d on %s", error, action);
+            return -1;
     }
-//    printf("bolt: (Received");
-//    for (int i = 0; i < total_received; i++) { printf(" %c%c", hex1(buffer, i), hex0(buffer, i)); }
-//    printf(")\n");
-    return total_received;
 }
 
-int handshake_b(struct BoltConnection * connection, int32_t _1, int32_t _2, int32_t _3, int32_t _4)
+int set_non_blocking(int socket)
 {
-    BoltLog_info("bolt: Performing handshake");
-    char handshake[20];
-    memcpy(&handshake[0x00], "\x60\x60\xB0\x17", 4);
-    memcpy_be(&handshake[0x04], &_1, 4);
-    memcpy_be(&handshake[0x08], &_2, 4);
-    memcpy_be(&handshake[0x0C], &_3, 4);
-    memcpy_be(&handshake[0x10], &_4, 4);
-    TRY(send_b(connection, &handshake[0], 20));
-    TRY(receive_b(connection, &handshake[0], 4, 4));
-    memcpy_be(&connection->protocol_version, &handshake[0], 4);
-    BoltLog_info("bolt: <SET protocol_version=%d>", connection->protocol_version);
-    switch(connection->protocol_version)
+#if USE_WINSOCK
+    u_long mode = 1;
+    return ioctlsocket(socket, FIONBIO, &mode) == 0 ? 0 : -1;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags == -1)
     {
-        case 1:
-            connection->protocol_state = BoltProtocolV1_create_state();
-            return 0;
-        default:close_b(connection);
-            set_status(connection, BOLT_DEFUNCT, BOLT_UNSUPPORTED);
-            return -1;
+        return -1;
     }
+    return fcntl(socket, F_SETFL, flags | O_NONBLOCK) == -1 ? -1 : 0;
+#endif
 }
 
-struct BoltConnection * BoltConnection_create()
+/**
+ * Close a socket of a connection, first cancelling any operations that
+ * its ring has in flight on it, as these keep the socket open.
+ *
+ * @param connection
+ * @param socket
+ */
+void release(struct BoltConnection * connection, int socket)
 {
-    const size_t size = sizeof(struct BoltConnection);
-    struct BoltConnection* connection = BoltMem_allocate(size);
-    memset(connection, 0, size);
-    return connection;
+    if (connection->ring != NULL)
+    {
+        BoltRing_cancel(connection, socket);
+    }
+    CLOSE(socket);
 }
 
-void BoltConnection_destroy(struct BoltConnection* connection)
+void close_socket(struct BoltConnection * connection)
 {
-    BoltMem_deallocate(connection, sizeof(struct BoltConnection));
+    if (connection->socket > 0)
+    {
+        release(connection, connection->socket);
+    }
+    connection->socket = 0;
 }
 
-int BoltConnection_open_b(struct BoltConnection * connection, enum BoltTransport transport, struct BoltAddress * address)
+/**
+ * Set an optional socket option, logging rather than failing if the
+ * platform or the privileges of the process do not allow it.
+ *
+ * @return 0 if the option was set, -1 otherwise
+ */
+int tune(int socket, int level, int name, int value, const char * description)
 {
-    if (connection->status != BOLT_DISCONNECTED)
-    {
-        BoltConnection_close_b(connection);
-    }
-    for (size_t i = 0; i < address->n_resolved_hosts; i++) {
-        int opened = open_b(connection, transport, &address->resolved_hosts[i]);
-        if (opened == 0)
-        {
-            if (connection->transport == BOLT_SECURE_SOCKET)
-            {
-                int secured = secure_b(connection);
-                if (secured == 0)
-                {
-                    handshake_b(connection, 1, 0, 0, 0);
-                }
-            }
-            else
-            {
-                handshake_b(connection, 1, 0, 0, 0);
-            }
-            set_status(connection, BOLT_CONNECTED, BOLT_NO_ERROR);
-            break;
-        }
-    }
-    if (connection->status == BOLT_DISCONNECTED)
+    if (SETSOCKOPT(socket, level, name, &value) == -1)
     {
-        set_status(connection, BOLT_DEFUNCT, BOLT_NO_VALID_ADDRESS);
+        BoltLog_info("bolt: Unable to set %s (error %d)", description, errno);
         return -1;
     }
     return 0;
 }
 
-void BoltConnection_close_b(struct BoltConnection* connection)
+/**
+ * Apply the socket options configured for a connection to a newly
+ * created socket.
+ *
+ * @param connection
+ * @param socket
+ * @param local non-zero for a Unix domain socket
+ * @return 0 on success, -1 if an essential option could not be set
+ */
+int apply_socket_options(struct BoltConnection * connection, int socket, int local)
 {
-    if (connection->rx_buffer != NULL)
+    const struct BoltSocketOptions * options = &connection->socket_options;
+    if (options->send_buffer_size > 0)
     {
-        BoltBuffer_destroy(connection->rx_buffer);
-        connection->rx_buffer = NULL;
+        tune(socket, SOL_SOCKET, SO_SNDBUF, options->send_buffer_size, "send buffer size");
     }
-    if (connection->tx_buffer != NULL)
+    if (options->receive_buffer_size > 0)
     {
-        BoltBuffer_destroy(connection->tx_buffer);
-        connection->tx_buffer = NULL;
+        tune(socket, SOL_SOCKET, SO_RCVBUF, options->receive_buffer_size, "receive buffer size");
     }
-    if (connection->status != BOLT_DISCONNECTED)
+    if (local)
     {
-        close_b(connection);
+        return 0;
     }
-}
-
-int BoltConnection_send_b(struct BoltConnection * connection)
-{
-    int size = BoltBuffer_unloadable(connection->tx_buffer);
-    TRY(send_b(connection, BoltBuffer_unload_target(connection->tx_buffer, size), size));
-    BoltBuffer_compact(connection->tx_buffer);
-    return 0;
-}
-
-int BoltConnection_receive_b(struct BoltConnection * connection, char * buffer, int size)
-{
-    if (size == 0) return 0;
-    int available = BoltBuffer_unloadable(connection->rx_buffer);
-    if (size > available)
+    const int TRUE = 1;
+    if (options->keep_alive)
     {
-        int delta = size - available;
-        while (delta > 0)
+        if (SETSOCKOPT(socket, SOL_SOCKET, SO_KEEPALIVE, &TRUE) == -1)
         {
-            int max_size = BoltBuffer_loadable(connection->rx_buffer);
-            if (max_size == 0)
-            {
-                BoltBuffer_compact(connection->rx_buffer);
-                max_size = BoltBuffer_loadable(connection->rx_buffer);
-            }
-            max_size = delta > max_size ? delta : max_size;
-            int received = receive_b(connection, BoltBuffer_load_target(connection->rx_buffer, max_size), delta,
-                                     max_size);
-            if (received == -1)
-            {
-                return -1;
-            }
-            // adjust the buffer extent based on the actual amount of data received
-            connection->rx_buffer->extent = connection->rx_buffer->extent - max_size + received;
-            delta -= received;
+            return -1;
         }
     }
-    BoltBuffer_unload(connection->rx_buffer, buffer, size);
-    return size;
-}
-
-int BoltConnection_fetch_b(struct BoltConnection * connection, bolt_request_t request)
-{
-    switch (connection->protocol_version)
+    if (options->no_delay)
     {
-        case 1:
-        {
-            int fetched = BoltProtocolV1_fetch_b(connection, request);
-            if (fetched == 0)
-            {
-                // Summary received
-                struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-                int16_t code = BoltMessage_code(state->data);
-                switch (code)
-                {
-                    case BOLT_V1_SUCCESS:
-                        set_status(connection, BOLT_READY, BOLT_NO_ERROR);
-                        return 0;
-                    case BOLT_V1_IGNORED:
-                        // Leave status as-is
-                        return 0;
-                    case BOLT_V1_FAILURE:
-                        set_status(connection, BOLT_FAILED, BOLT_UNKNOWN_ERROR);   // TODO more specific error
-                        return 0;
-                    default:
-                        BoltLog_error("bolt: Protocol violation (received summary code %d)", code);
-                        set_status(connection, BOLT_DEFUNCT, BOLT_PROTOCOL_VIOLATION);
-                        return -1;
-                }
-            }
-            return 1;
-        }
-        default:
+        if (SETSOCKOPT(socket, IPPROTO_TCP, TCP_NODELAY, &TRUE) == -1)
         {
-            // TODO
             return -1;
         }
     }
-}
-
-int BoltConnection_fetch_summary_b(struct BoltConnection * connection, bolt_request_t request)
-{
-    int records = 0;
-    int data;
-    do
+#ifdef TCP_QUICKACK
+    if (options->quick_ack)
     {
-        data = BoltConnection_fetch_b(connection, request);
-        if (data < 0)
-        {
-            return data;
-        }
+        tune(socket, IPPROTO_TCP, TCP_QUICKACK, 1, "quick acknowledgement");
+    }
+#endif
+#ifdef TCP_USER_TIMEOUT
+    if (options->user_timeout > 0)
+    {
+        tune(socket, IPPROTO_TCP, TCP_USER_TIMEOUT, options->user_timeout, "user timeout");
+    }
+#endif
+#ifdef SO_BUSY_POLL
+    if (options->busy_poll > 0)
+    {
+        tune(socket, SOL_SOCKET, SO_BUSY_POLL, options->busy_poll, "busy polling");
+    }
+#endif
+#if ZERO_COPY
+    if (options->zero_copy_threshold > 0 && connection->transport == BOLT_SOCKET)
+    {
+        connection->zero_copy = tune(socket, SOL_SOCKET, SO_ZEROCOPY, 1, "zero-copy sends") == 0;
+    }
+#endif
+    return 0;
+}
+
+/**
+ * Start a non-blocking connection attempt to a single resolved address.
+ *
+ * @param connection
+ * @param address
+ * @param socket_ptr receives the socket used for the attempt
+ * @return 0 if connected, BOLT_WAITING if the attempt is in progress, -1 on failure, with the
+ *         error recorded as the attempt error of the connection
+ */
+int open_nb(struct BoltConnection * connection, const struct sockaddr_storage * address, int * socket_ptr)
+{
+    int local = connection->transport == BOLT_UNIX_SOCKET;
+    if (local != (address->ss_family == AF_UNIX))
+    {
+        BoltLog_error("bolt: Address family %d does not match transport", address->ss_family);
+        connection->attempt_error = BOLT_UNSUPPORTED;
+        return -1;
+    }
+    switch (address->ss_family)
+    {
+        case AF_UNIX:
+            BoltLog_info("bolt: Opening Unix domain connection to %s",
+                         ((const struct sockaddr_un *)(address))->sun_path);
+            break;
+        case AF_INET:
+        case AF_INET6:
+        {
+            char host_string[NI_MAXHOST];
+            char port_string[NI_MAXSERV];
+            getnameinfo((const struct sockaddr *)(address), ADDR_SIZE(address),
+                        host_string, NI_MAXHOST, port_string, NI_MAXSERV, NI_NUMERICHOST | NI_NUMERICSERV);
+            BoltLog_info("bolt: Opening %s connection to %s at port %s",
+                         address->ss_family == AF_INET ? "IPv4" : "IPv6", host_string, port_string);
+            break;
+        }
+        default:
+            BoltLog_error("bolt: Unsupported address family %d", address->ss_family);
+            connection->attempt_error = BOLT_UNSUPPORTED;
+            return -1;
+    }
+    int attempt = SOCKET(address->ss_family, SOCK_STREAM, local ? 0 : IPPROTO_TCP);
+    if (attempt == -1)
+    {
+        connection->attempt_error = last_error();
+        return -1;
+    }
+    *socket_ptr = attempt;
+    if (apply_socket_options(connection, attempt, local) == -1 || set_non_blocking(attempt) == -1)
+    {
+        connection->attempt_error = last_error();
+        return -1;
+    }
+    if (CONNECT(attempt, (struct sockaddr *)(address), ADDR_SIZE(address)) == -1)
+    {
+        // A Unix domain socket that would block has a full backlog rather than a connection in progress
+        if (errno == EINPROGRESS || (!local && would_block()))
+        {
+            return BOLT_WAITING;
+        }
+        connection->attempt_error = last_error();
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Select the nth resolved address to attempt. Following RFC 8305,
+ * address families are interleaved, starting with the family of the
+ * first resolved address.
+ *
+ * @param address
+ * @param n
+ * @return the resolved address
+ */
+const struct sockaddr_storage * nth_address(struct BoltAddress * address, int n)
+{
+    sa_family_t preferred = address->resolved_hosts[0].ss_family;
+    int n_preferred = 0;
+    for (int i = 0; i < address->n_resolved_hosts; i++)
+    {
+        n_preferred += address->resolved_hosts[i].ss_family == preferred;
+    }
+    int n_other = address->n_resolved_hosts - n_preferred;
+    int interleaved = 2 * (n_preferred < n_other ? n_preferred : n_other);
+    int want_preferred;
+    int rank;
+    if (n < interleaved)
+    {
+        want_preferred = n % 2 == 0;
+        rank = n / 2;
+    }
+    else
+    {
+        want_preferred = n_preferred > n_other;
+        rank = interleaved / 2 + (n - interleaved);
+    }
+    for (int i = 0; i < address->n_resolved_hosts; i++)
+    {
+        if ((address->resolved_hosts[i].ss_family == preferred) == want_preferred)
+        {
+            if (rank == 0)
+            {
+                return &address->resolved_hosts[i];
+            }
+            rank -= 1;
+        }
+    }
+    return NULL;
+}
+
+void close_attempt(struct BoltConnection * connection, int index)
+{
+    release(connection, connection->attempts[index]);
+    connection->n_attempts -= 1;
+    connection->attempts[index] = connection->attempts[connection->n_attempts];
+}
+
+void close_attempts(struct BoltConnection * connection)
+{
+    while (connection->n_attempts > 0)
+    {
+        close_attempt(connection, connection->n_attempts - 1);
+    }
+}
+
+/**
+ * Adopt a connected socket as the socket for this connection,
+ * cancelling all other connection attempts.
+ *
+ * @param connection
+ * @param winner
+ */
+void won(struct BoltConnection * connection, int winner)
+{
+    for (int i = connection->n_attempts - 1; i >= 0; i--)
+    {
+        if (connection->attempts[i] == winner)
+        {
+            connection->n_attempts -= 1;
+            connection->attempts[i] = connection->attempts[connection->n_attempts];
+        }
+    }
+    close_attempts(connection);
+    connection->socket = winner;
+}
+
+/**
+ * Determine whether another connection attempt can be started.
+ *
+ * @param connection
+ * @return 1 if another attempt can be started, 0 otherwise
+ */
+int can_attempt(struct BoltConnection * connection)
+{
+    return connection->address_index + 1 < connection->address->n_resolved_hosts &&
+           connection->n_attempts < BOLT_MAX_CONNECT_ATTEMPTS;
+}
+
+/**
+ * Race connection attempts across the resolved addresses, starting a
+ * new attempt whenever the attempt delay elapses or all attempts in
+ * progress have failed. The first attempt to connect wins.
+ *
+ * @param connection
+ * @return 0 if connected, BOLT_WAITING if attempts are in progress, -1 if all attempts failed
+ */
+int race_nb(struct BoltConnection * connection)
+{
+    if (connection->n_attempts > 0)
+    {
+        struct pollfd poll_fds[BOLT_MAX_CONNECT_ATTEMPTS];
+        for (int i = 0; i < connection->n_attempts; i++)
+        {
+            poll_fds[i].fd = connection->attempts[i];
+            poll_fds[i].events = POLLOUT;
+            poll_fds[i].revents = 0;
+        }
+        int n_attempts = connection->n_attempts;
+        if (POLL(&poll_fds[0], (nfds_t)(n_attempts), 0) > 0)
+        {
+            for (int i = 0; i < n_attempts; i++)
+            {
+                if (poll_fds[i].revents == 0)
+                {
+                    continue;
+                }
+                int error = 0;
+                socklen_t error_size = sizeof(error);
+                if (getsockopt(poll_fds[i].fd, SOL_SOCKET, SO_ERROR, (char *)(&error), &error_size) == -1)
+                {
+                    error = errno;
+                }
+                if (error == 0)
+                {
+                    won(connection, poll_fds[i].fd);
+                    return 0;
+                }
+                errno = error;
+                connection->attempt_error = last_error();
+                for (int j = 0; j < connection->n_attempts; j++)
+                {
+                    if (connection->attempts[j] == poll_fds[i].fd)
+                    {
+                        close_attempt(connection, j);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    while (can_attempt(connection) && (connection->n_attempts == 0 || remaining(&connection->next_attempt) == 0))
+    {
+        connection->address_index += 1;
+        int attempt = -1;
+        int opened = open_nb(connection, nth_address(connection->address, connection->address_index), &attempt);
+        if (opened == 0)
+        {
+            won(connection, attempt);
+            return 0;
+        }
+        if (opened == BOLT_WAITING)
+        {
+            connection->attempts[connection->n_attempts] = attempt;
+            connection->n_attempts += 1;
+            set_time(&connection->next_attempt, CONNECT_ATTEMPT_DELAY);
+        }
+        else if (attempt != -1)
+        {
+            CLOSE(attempt);
+        }
+    }
+    if (connection->n_attempts == 0)
+    {
+        // Only once no attempt remains in progress or can start has the open failed
+        set_status(connection, BOLT_DEFUNCT,
+                   connection->attempt_error != BOLT_NO_ERROR ? connection->attempt_error : BOLT_NO_VALID_ADDRESS);
+        return -1;
+    }
+    connection->awaiting = BOLT_WRITABLE;
+    return BOLT_WAITING;
+}
+
+/**
+ * Queue the Bolt handshake, proposing the protocol versions supported.
+ *
+ * @param connection
+ */
+void load_handshake(struct BoltConnection * connection)
+{
+    int32_t versions[4] = {3, 2, 1, 0};
+    int offset = connection->tx_buffer->extent;
+    char * handshake = BoltBuffer_load_target(connection->tx_buffer, 20);
+    BoltConnection_queue(connection, connection->tx_buffer, offset, 20);
+    memcpy(&handshake[0x00], "\x60\x60\xB0\x17", 4);
+    memcpy_be(&handshake[0x04], &versions[0], 4);
+    memcpy_be(&handshake[0x08], &versions[1], 4);
+    memcpy_be(&handshake[0x0C], &versions[2], 4);
+    memcpy_be(&handshake[0x10], &versions[3], 4);
+}
+
+/**
+ * Complete the connection once the socket has connected and move on
+ * to the next stage.
+ *
+ * @param connection
+ */
+void opened(struct BoltConnection * connection)
+{
+    timespec_get(&connection->metrics.time_opened, TIME_UTC);
+    connection->tx_buffer = BoltBuffer_create(INITIAL_TX_BUFFER_SIZE);
+    connection->rx_buffer = BoltBuffer_create(INITIAL_RX_BUFFER_SIZE);
+    connection->tx_record = BoltBuffer_create(MAX_TX_RECORD_SIZE);
+    if (connection->transport == BOLT_SECURE_SOCKET)
+    {
+        begin(connection, BOLT_SECURING, connection->timeouts.handshake);
+    }
+    else
+    {
+        BoltLog_info("bolt: Performing handshake");
+        load_handshake(connection);
+        begin(connection, BOLT_HANDSHAKING, connection->timeouts.handshake);
+    }
+}
+
+/**
+ * Write any queued data as TLS early data, ahead of the completion of
+ * the TLS handshake.
+ *
+ * @param connection
+ * @return 0 if all queued data has been written, BOLT_WAITING if the
+ *         socket cannot currently accept more data, -1 on error
+ */
+int transmit_early_data_nb(struct BoltConnection * connection)
+{
+    while (connection->n_tx_segments > 0)
+    {
+        struct BoltTransmitSegment * segment = &connection->tx_segments[0];
+        size_t sent = 0;
+        int written = SSL_write_early_data(connection->ssl, &segment->buffer->data[segment->offset],
+                                           (size_t)(segment->size), &sent);
+        if (written != 1)
+        {
+            return ssl_failure(connection, written, "early data");
+        }
+        connection->metrics.bytes_sent += sent;
+        transmitted(connection, (int)(sent));
+        BoltLog_info("bolt: (Sent %d bytes as early data)", (int)(sent));
+    }
+    return 0;
+}
+
+int secure_nb(struct BoltConnection * connection)
+{
+    // TODO: investigate ways to provide a greater resolution of TLS errors
+    if (connection->ssl == NULL)
+    {
+        BoltLog_info("bolt: Securing socket");
+        struct BoltSecurityContext * context = connection->security_context != NULL ?
+                                               connection->security_context : BoltSecurityContext_default();
+        if (context == NULL)
+        {
+            set_status(connection, BOLT_DEFUNCT, BOLT_TLS_ERROR);
+            return -1;
+        }
+        char server[NI_MAXHOST + NI_MAXSERV + 2];
+        snprintf(server, sizeof(server), "%s:%s", connection->address->host, connection->address->port);
+        connection->ssl = BoltSecurityContext_create_ssl(context, server);
+        if (connection->ssl == NULL)
+        {
+            set_status(connection, BOLT_DEFUNCT, BOLT_TLS_ERROR);
+            return -1;
+        }
+        // The transmit buffer can be reallocated between retries of a
+        // write that could not complete without blocking.
+        SSL_set_mode(connection->ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+        int linked_socket = SSL_set_fd(connection->ssl, connection->socket);
+        if (linked_socket != 1)
+        {
+            set_status(connection, BOLT_DEFUNCT, BOLT_TLS_ERROR);
+            return -1;
+        }
+        // A handshake queued before the TLS handshake completes is sent as early data
+        SSL_SESSION * session = SSL_get_session(connection->ssl);
+        if (context->early_data && session != NULL && SSL_SESSION_get_max_early_data(session) > 0)
+        {
+            BoltLog_info("bolt: Performing handshake as early data");
+            load_handshake(connection);
+        }
+    }
+    int transmitted = transmit_early_data_nb(connection);
+    if (transmitted != 0)
+    {
+        return transmitted;
+    }
+    int connected = SSL_connect(connection->ssl);
+    if (connected != 1)
+    {
+        return ssl_failure(connection, connected, "connect");
+    }
+    connection->metrics.tls_version = SSL_version(connection->ssl);
+    connection->metrics.tls_session_resumed = SSL_session_reused(connection->ssl);
+    if (connection->metrics.tls_session_resumed)
+    {
+        BoltLog_info("bolt: Resumed %s session", SSL_get_version(connection->ssl));
+    }
+    connection->kernel_tls = 0;
+    if (BIO_get_ktls_send(SSL_get_wbio(connection->ssl)))
+    {
+        connection->kernel_tls |= BOLT_KTLS_SEND;
+    }
+    if (BIO_get_ktls_recv(SSL_get_rbio(connection->ssl)))
+    {
+        connection->kernel_tls |= BOLT_KTLS_RECEIVE;
+    }
+    if (connection->kernel_tls != 0)
+    {
+        BoltLog_info("bolt: Offloaded TLS to kernel (send=%d, receive=%d)",
+                     (connection->kernel_tls & BOLT_KTLS_SEND) != 0, (connection->kernel_tls & BOLT_KTLS_RECEIVE) != 0);
+    }
+    connection->metrics.tls_early_data_accepted =
+            SSL_get_early_data_status(connection->ssl) == SSL_EARLY_DATA_ACCEPTED;
+    if (!connection->metrics.tls_early_data_accepted)
+    {
+        // Either early data was not sent or the server rejected it
+        load_handshake(connection);
+    }
+    return 0;
+}
+
+void close_b(struct BoltConnection * connection)
+{
+    BoltLog_info("bolt: Closing connection");
+    if (connection->protocol != NULL)
+    {
+        connection->protocol->detach(connection);
+        connection->protocol = NULL;
+    }
+    connection->protocol_version = 0;
+    switch(connection->transport)
+    {
+        case BOLT_SOCKET:
+        case BOLT_UNIX_SOCKET:
+        {
+            break;
+        }
+        case BOLT_SECURE_SOCKET:
+        {
+            if (connection->ssl != NULL)   {
+                SSL_shutdown(connection->ssl);
+                SSL_free(connection->ssl);
+                connection->ssl = NULL;
+            }
+            connection->kernel_tls = 0;
+            break;
+        }
+    }
+    if (connection->socket > 0)
+    {
+        SHUTDOWN(connection->socket, SHUT_RDWR);
+    }
+    close_socket(connection);
+    close_attempts(connection);
+    timespec_get(&connection->metrics.time_closed, TIME_UTC);
+    connection->stage = BOLT_IDLE;
+    set_status(connection, BOLT_DISCONNECTED, BOLT_NO_ERROR);
+}
+
+/**
+ * Remove a number of bytes from the head of the segment queue,
+ * unloading them from their buffers.
+ *
+ * @param connection
+ * @param size number of bytes transmitted
+ */
+void transmitted(struct BoltConnection * connection, int size)
+{
+    connection->n_tx_bytes -= size;
+    int done = 0;
+    while (size > 0 && done < connection->n_tx_segments)
+    {
+        struct BoltTransmitSegment * segment = &connection->tx_segments[done];
+        int n = size < segment->size ? size : segment->size;
+        BoltBuffer_unload_target(segment->buffer, n);
+        segment->offset += n;
+        segment->size -= n;
+        size -= n;
+        if (segment->size == 0)
+        {
+            done += 1;
+        }
+    }
+    if (done > 0)
+    {
+        connection->n_tx_segments -= done;
+        memmove(&connection->tx_segments[0], &connection->tx_segments[done],
+                (size_t)(connection->n_tx_segments) * sizeof(struct BoltTransmitSegment));
+    }
+}
+
+/**
+ * Move the untransmitted data of each buffer in the segment queue to the
+ * start of that buffer, once the transmitted data ahead of it outweighs
+ * it, and rebase the segments accordingly. Buffers are otherwise only
+ * rewound once the queue empties, which may never happen while loads
+ * keep pace with a slow reader. Nothing is moved while the kernel may
+ * still be reading from the buffers.
+ *
+ * @param connection
+ */
+void compact_tx(struct BoltConnection * connection)
+{
+    if (connection->zero_copy_releases != connection->zero_copy_sends)
+    {
+        return;
+    }
+#if USE_IO_URING
+    if (connection->ring_slot != NULL &&
+        ((connection->ring_slot->requested | connection->ring_slot->pending) & BOLT_RING_SEND))
+    {
+        return;
+    }
+#endif
+    for (int i = 0; i < connection->n_tx_segments; i++)
+    {
+        struct BoltBuffer * buffer = connection->tx_segments[i].buffer;
+        int shift = buffer->cursor;
+        if (shift == 0 || shift < BoltBuffer_unloadable(buffer))
+        {
+            continue;
+        }
+        BoltBuffer_compact(buffer);
+        for (int j = i; j < connection->n_tx_segments; j++)
+        {
+            if (connection->tx_segments[j].buffer == buffer)
+            {
+                connection->tx_segments[j].offset -= shift;
+            }
+        }
+    }
+}
+
+void BoltConnection_queue(struct BoltConnection * connection, struct BoltBuffer * buffer, int offset, int size)
+{
+    if (size <= 0)
+    {
+        return;
+    }
+    if (connection->n_tx_bytes == 0 && connection->flush_policy.max_delay > 0)
+    {
+        set_time(&connection->flush_deadline, connection->flush_policy.max_delay);
+    }
+    connection->n_tx_bytes += size;
+    if (connection->n_tx_segments > 0)
+    {
+        struct BoltTransmitSegment * last = &connection->tx_segments[connection->n_tx_segments - 1];
+        if (last->buffer == buffer && last->offset + last->size == offset)
+        {
+            last->size += size;
+            return;
+        }
+    }
+    if (connection->n_tx_segments == connection->tx_segments_size)
+    {
+        int new_size = connection->tx_segments_size == 0 ? INITIAL_TX_SEGMENTS_SIZE : 2 * connection->tx_segments_size;
+        connection->tx_segments = BoltMem_reallocate(connection->tx_segments,
+                                                     (size_t)(connection->tx_segments_size) * sizeof(struct BoltTransmitSegment),
+                                                     (size_t)(new_size) * sizeof(struct BoltTransmitSegment));
+        connection->tx_segments_size = new_size;
+    }
+    struct BoltTransmitSegment * segment = &connection->tx_segments[connection->n_tx_segments];
+    segment->buffer = buffer;
+    segment->offset = offset;
+    segment->size = size;
+    connection->n_tx_segments += 1;
+}
+
+#if USE_IO_URING
+
+/**
+ * Transmit queued segments through the ring to which the connection is
+ * attached, consuming the outcome of any earlier send first. The send
+ * itself gathers the segments queued by the time the ring next submits.
+ *
+ * @param connection
+ * @param more non-zero to let the kernel hold back a partial packet
+ *             in anticipation of more data
+ * @return 0 if all segments have been transmitted, BOLT_WAITING if
+ *         the send is in flight, -1 on error
+ */
+int transmit_ring_nb(struct BoltConnection * connection, int more)
+{
+    struct BoltRingSlot * slot = connection->ring_slot;
+    if (slot->completed & BOLT_RING_SEND)
+    {
+        slot->completed &= ~BOLT_RING_SEND;
+        int sent = slot->send_result;
+        if (sent > 0)
+        {
+            connection->corked = more;
+            connection->metrics.bytes_sent += sent;
+            transmitted(connection, sent);
+            BoltLog_info("bolt: (Sent %d bytes)", sent);
+        }
+        else if (sent == -EAGAIN)
+        {
+            slot->blocked |= BOLT_WRITABLE;
+        }
+        else if (sent != -EINTR)
+        {
+            errno = -sent;
+            set_status(connection, BOLT_DEFUNCT, last_error());
+            BoltLog_error("bolt: Socket error %d on transmit", connection->error);
+            return -1;
+        }
+    }
+    if (connection->n_tx_segments == 0)
+    {
+        return 0;
+    }
+    if (((slot->requested | slot->pending) & BOLT_RING_SEND) == 0 && (slot->blocked & BOLT_WRITABLE) == 0)
+    {
+        BoltRing_send(connection, more ? TX_MORE : 0);
+    }
+    connection->awaiting = BOLT_WRITABLE;
+    return BOLT_WAITING;
+}
+
+#endif // USE_IO_URING
+
+/**
+ * Transmit queued segments over a plain socket, gathering as many as
+ * possible into each call. During an explicit send, writes that reach
+ * the zero-copy threshold are sent without copying, leaving the kernel
+ * to notify the connection once it no longer needs the memory.
+ *
+ * @param connection
+ * @param more non-zero to let the kernel hold back a partial packet
+ *             in anticipation of more data
+ * @return 0 if all segments have been transmitted, BOLT_WAITING if
+ *         the socket cannot currently accept more data, -1 on error
+ */
+int transmit_socket_nb(struct BoltConnection * connection, int more)
+{
+#if USE_IO_URING
+    if (connection->ring != NULL)
+    {
+        return transmit_ring_nb(connection, more);
+    }
+#endif
+    int zero_copy = connection->zero_copy && connection->stage == BOLT_SENDING;
+    while (connection->n_tx_segments > 0)
+    {
+#if USE_WINSOCK
+        struct BoltTransmitSegment * segment = &connection->tx_segments[0];
+        int size = segment->size;
+        int sent = TRANSMIT(connection->socket, &segment->buffer->data[segment->offset], size, 0);
+#else
+        struct iovec vector[MAX_TX_VECTOR_SIZE];
+        int n_vector = connection->n_tx_segments < MAX_TX_VECTOR_SIZE ? connection->n_tx_segments : MAX_TX_VECTOR_SIZE;
+        int size = 0;
+        for (int i = 0; i < n_vector; i++)
+        {
+            struct BoltTransmitSegment * segment = &connection->tx_segments[i];
+            vector[i].iov_base = &segment->buffer->data[segment->offset];
+            vector[i].iov_len = (size_t)(segment->size);
+            size += segment->size;
+        }
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &vector[0];
+        message.msg_iovlen = (size_t)(n_vector);
+        int flags = more ? TX_MORE : 0;
+        if (zero_copy && size >= connection->socket_options.zero_copy_threshold)
+        {
+            flags |= TX_ZERO_COPY;
+        }
+        int sent = TRANSMIT_M(connection->socket, &message, flags);
+        if (sent == -1 && errno == ENOBUFS && (flags & TX_ZERO_COPY))
+        {
+            // The kernel limits the memory pinned by a socket, so copy instead
+            zero_copy = 0;
+            continue;
+        }
+        if (sent > 0 && (flags & TX_ZERO_COPY))
+        {
+            connection->zero_copy_sends += 1;
+            connection->metrics.bytes_sent_zero_copy += sent;
+        }
+#endif
+        if (sent > 0)
+        {
+            connection->corked = more;
+            connection->metrics.bytes_sent += sent;
+            transmitted(connection, sent);
+            BoltLog_info("bolt: (Sent %d of %d bytes)", sent, size);
+            continue;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (would_block())
+        {
+            connection->awaiting = BOLT_WRITABLE;
+            return BOLT_WAITING;
+        }
+        set_status(connection, BOLT_DEFUNCT, last_error());
+        BoltLog_error("bolt: Socket error %d on transmit", connection->error);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Transmit queued segments over a secure socket. Small segments, such
+ * as chunk headers, are coalesced into a single record before being
+ * written whereas larger segments are written directly from their
+ * buffers.
+ *
+ * @param connection
+ * @return 0 if all segments have been transmitted, BOLT_WAITING if
+ *         the socket cannot currently accept more data, -1 on error
+ */
+int transmit_secure_nb(struct BoltConnection * connection)
+{
+    struct BoltBuffer * record = connection->tx_record;
+    while (BoltBuffer_unloadable(record) > 0 || connection->n_tx_segments > 0)
+    {
+        if (BoltBuffer_unloadable(record) == 0 && connection->tx_segments[0].size >= MIN_TX_DIRECT_SIZE)
+        {
+            struct BoltTransmitSegment * segment = &connection->tx_segments[0];
+            int size = segment->size;
+            int sent = TRANSMIT_S(connection->ssl, &segment->buffer->data[segment->offset], size, 0);
+            if (sent <= 0)
+            {
+                return ssl_failure(connection, sent, "transmit");
+            }
+            connection->metrics.bytes_sent += sent;
+            transmitted(connection, sent);
+            BoltLog_info("bolt: (Sent %d of %d bytes)", sent, size);
+            continue;
+        }
+        if (BoltBuffer_unloadable(record) == 0)
+        {
+            int n = 0;
+            int size = 0;
+            while (n < connection->n_tx_segments && connection->tx_segments[n].size < MIN_TX_DIRECT_SIZE &&
+                   size + connection->tx_segments[n].size <= MAX_TX_RECORD_SIZE)
+            {
+                struct BoltTransmitSegment * segment = &connection->tx_segments[n];
+                BoltBuffer_load(record, &segment->buffer->data[segment->offset], segment->size);
+                size += segment->size;
+                n += 1;
+            }
+            transmitted(connection, size);
+        }
+        int size = BoltBuffer_unloadable(record);
+        int sent = TRANSMIT_S(connection->ssl, &record->data[record->cursor], size, 0);
+        if (sent <= 0)
+        {
+            return ssl_failure(connection, sent, "transmit");
+        }
+        connection->metrics.bytes_sent += sent;
+        BoltBuffer_unload_target(record, sent);
+        BoltLog_info("bolt: (Sent %d of %d bytes)", sent, size);
+    }
+    return 0;
+}
+
+/**
+ * Let the kernel send any data held back by an earlier partial transmission.
+ *
+ * @param connection
+ */
+void uncork(struct BoltConnection * connection)
+{
+#ifdef TCP_CORK
+    const int FALSE = 0;
+    SETSOCKOPT(connection->socket, IPPROTO_TCP, TCP_CORK, &FALSE);
+#endif
+    connection->corked = 0;
+}
+
+/**
+ * Transmit as many queued segments as possible without blocking,
+ * releasing any data held back by the kernel once all have been
+ * transmitted.
+ *
+ * @param connection
+ * @return 0 if all segments have been transmitted, BOLT_WAITING if
+ *         the socket cannot currently accept more data, -1 on error
+ */
+int transmit_nb(struct BoltConnection * connection)
+{
+    int transmitted;
+    switch (connection->transport)
+    {
+        case BOLT_SOCKET:
+        case BOLT_UNIX_SOCKET:
+            transmitted = transmit_socket_nb(connection, 0);
+            break;
+        case BOLT_SECURE_SOCKET:
+            if (connection->kernel_tls & BOLT_KTLS_SEND)
+            {
+                transmitted = transmit_socket_nb(connection, 0);
+            }
+            else
+            {
+                transmitted = transmit_secure_nb(connection);
+            }
+            break;
+        default:
+            set_status(connection, BOLT_DEFUNCT, BOLT_UNSUPPORTED);
+            return -1;
+    }
+    if (transmitted == 0 && connection->corked)
+    {
+        uncork(connection);
+    }
+    return transmitted;
+}
+
+/**
+ * Transmit as many queued segments as possible without blocking, ahead
+ * of an explicit send. If the flush policy corks the connection, the
+ * kernel holds back partial packets until the send, using MSG_MORE on
+ * plain sockets and TCP_CORK where TLS records are written for us.
+ *
+ * @param connection
+ * @return 0 if all segments have been transmitted, BOLT_WAITING if
+ *         the socket cannot currently accept more data, -1 on error
+ */
+int flush_nb(struct BoltConnection * connection)
+{
+    int cork = connection->flush_policy.cork && connection->transport != BOLT_UNIX_SOCKET;
+    if (connection->transport == BOLT_SOCKET)
+    {
+        return transmit_socket_nb(connection, cork);
+    }
+#ifdef TCP_CORK
+    if (cork && !connection->corked)
+    {
+        const int TRUE = 1;
+        SETSOCKOPT(connection->socket, IPPROTO_TCP, TCP_CORK, &TRUE);
+        connection->corked = 1;
+    }
+#endif
+    switch (connection->transport)
+    {
+        case BOLT_UNIX_SOCKET:
+            return transmit_socket_nb(connection, 0);
+        case BOLT_SECURE_SOCKET:
+            if (connection->kernel_tls & BOLT_KTLS_SEND)
+            {
+                // Records may only be held back below the TLS layer
+                int transmitted = transmit_socket_nb(connection, 0);
+                connection->corked = cork;
+                return transmitted;
+            }
+            return transmit_secure_nb(connection);
+        default:
+            set_status(connection, BOLT_DEFUNCT, BOLT_UNSUPPORTED);
+            return -1;
+    }
+}
+
+int receive_nb(struct BoltConnection * connection);
+
+int wait_b(struct BoltConnection * connection);
+
+/**
+ * Transmit queued data until less than a given number of bytes remains
+ * queued, blocking only while the socket accepts no more data and the
+ * queue is still at or above that size. Responses arriving in the
+ * meantime are received into the receive buffer, as the server may stop
+ * reading requests until it can write its responses.
+ *
+ * @param connection
+ * @param limit number of queued bytes below which to stop blocking
+ * @return 0 on success, -1 on error
+ */
+int drain_b(struct BoltConnection * connection, int limit)
+{
+    struct timespec deadline = connection->deadline;
+    begin(connection, connection->stage, connection->timeouts.send);
+    int drained;
+    while ((drained = flush_nb(connection)) == BOLT_WAITING)
+    {
+        if (connection->n_tx_bytes < limit)
+        {
+            // The rest is transmitted by later loads or the next send
+            drained = 0;
+            break;
+        }
+        connection->awaiting = BOLT_READABLE | BOLT_WRITABLE;
+        if (wait_b(connection) == -1 || receive_nb(connection) == -1)
+        {
+            drained = -1;
+            break;
+        }
+    }
+    connection->deadline = deadline;
+    return drained;
+}
+
+int BoltConnection_loaded(struct BoltConnection * connection)
+{
+    const struct BoltFlushPolicy * policy = &connection->flush_policy;
+    if (connection->n_tx_bytes == 0 || connection->socket <= 0)
+    {
+        return 0;
+    }
+    if ((policy->max_bytes > 0 && connection->n_tx_bytes >= policy->max_bytes) ||
+        (policy->max_delay > 0 && remaining(&connection->flush_deadline) == 0))
+    {
+        int flushed = flush_nb(connection);
+        if (flushed == -1)
+        {
+            return -1;
+        }
+        if (connection->n_tx_bytes > 0 && policy->max_delay > 0)
+        {
+            set_time(&connection->flush_deadline, policy->max_delay);
+        }
+    }
+    if (policy->high_water > 0 && connection->n_tx_bytes >= policy->high_water)
+    {
+        BoltLog_info("bolt: Draining %d queued bytes below the high-water mark", connection->n_tx_bytes);
+        if (drain_b(connection, policy->high_water) == -1)
+        {
+            return -1;
+        }
+        compact_tx(connection);
+    }
+    return 0;
+}
+
+#if USE_IO_URING
+
+/**
+ * Receive data through the ring to which the connection is attached,
+ * consuming the outcome of any earlier receive first. The receive
+ * buffer is not compacted or grown while a receive is in flight, but
+ * consumers may reset its extent once they have unloaded everything.
+ *
+ * @param connection
+ * @return the number of bytes received, BOLT_WAITING if the receive is
+ *         in flight, -1 on error or end of transmission
+ */
+int receive_ring_nb(struct BoltConnection * connection)
+{
+    struct BoltRingSlot * slot = connection->ring_slot;
+    struct BoltBuffer * buffer = connection->rx_buffer;
+    if (slot->completed & BOLT_RING_RECEIVE)
+    {
+        slot->completed &= ~BOLT_RING_RECEIVE;
+        int received = slot->receive_result;
+        if (received > 0)
+        {
+            if (slot->receive_offset != buffer->extent)
+            {
+                memmove(&buffer->data[buffer->extent], &buffer->data[slot->receive_offset], (size_t)(received));
+            }
+            buffer->extent += received;
+            connection->metrics.bytes_received += received;
+            BoltLog_info("bolt: (Received %d bytes)", received);
+            return received;
+        }
+        if (received == 0)
+        {
+            BoltLog_info("bolt: Detected end of transmission");
+            set_status(connection, BOLT_DISCONNECTED, BOLT_END_OF_TRANSMISSION);
+            return -1;
+        }
+        if (received == -EAGAIN)
+        {
+            slot->blocked |= BOLT_READABLE;
+        }
+        else if (received != -EINTR)
+        {
+            errno = -received;
+            set_status(connection, BOLT_DEFUNCT, last_error());
+            BoltLog_error("bolt: Socket error %d on receive", connection->error);
+            return -1;
+        }
+    }
+    if ((slot->pending & BOLT_RING_RECEIVE) == 0 && (slot->blocked & BOLT_READABLE) == 0)
+    {
+        BoltBuffer_compact(buffer);
+        if (BoltBuffer_loadable(buffer) == 0)
+        {
+            BoltBuffer_load_target(buffer, buffer->size);
+            buffer->extent -= buffer->size / 2;
+        }
+        if (BoltRing_receive(connection, buffer->extent, BoltBuffer_loadable(buffer)) == -1)
+        {
+            set_status(connection, BOLT_DEFUNCT, BOLT_UNKNOWN_ERROR);
+            return -1;
+        }
+    }
+    connection->awaiting = BOLT_READABLE;
+    return BOLT_WAITING;
+}
+
+#endif // USE_IO_URING
+
+/**
+ * Collect the notifications queued on the socket for zero-copy sends
+ * whose memory the kernel has released, without blocking.
+ *
+ * @param connection
+ * @return 0 on success, -1 on error
+ */
+int released(struct BoltConnection * connection)
+{
+#if ZERO_COPY
+    while (connection->zero_copy_releases != connection->zero_copy_sends)
+    {
+        char control[128];
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        if (recvmsg(connection->socket, &message, MSG_ERRQUEUE) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return would_block() ? 0 : -1;
+        }
+        for (struct cmsghdr * header = CMSG_FIRSTHDR(&message); header != NULL; header = CMSG_NXTHDR(&message, header))
+        {
+            if ((header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR) ||
+                (header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR))
+            {
+                struct sock_extended_err * error = (struct sock_extended_err *)(CMSG_DATA(header));
+                if (error->ee_errno == 0 && error->ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+                {
+                    // Each notification covers an inclusive range of sends
+                    connection->zero_copy_releases += error->ee_data - error->ee_info + 1;
+                }
+            }
+        }
+    }
+#endif
+    return 0;
+}
+
+int BoltConnection_reclaim_b(struct BoltConnection * connection)
+{
+    if (connection->zero_copy_releases == connection->zero_copy_sends)
+    {
+        return 0;
+    }
+    struct timespec deadline = connection->deadline;
+    begin(connection, connection->stage, connection->timeouts.send);
+    int reclaimed = 0;
+    while (connection->zero_copy_releases != connection->zero_copy_sends)
+    {
+        if (released(connection) == -1)
+        {
+            set_status(connection, BOLT_DEFUNCT, last_error());
+            reclaimed = -1;
+            break;
+        }
+        if (connection->zero_copy_releases == connection->zero_copy_sends)
+        {
+            break;
+        }
+        // Notifications are signalled as an error condition on the socket
+        connection->awaiting = 0;
+        if (wait_b(connection) == -1)
+        {
+            reclaimed = -1;
+            break;
+        }
+    }
+    connection->deadline = deadline;
+    return reclaimed;
+}
+
+/**
+ * Receive as much data as is available into the receive buffer without
+ * blocking, growing the buffer if it is already full.
+ *
+ * @param connection
+ * @return the number of bytes received, BOLT_WAITING if no data is
+ *         available, -1 on error or end of transmission
+ */
+int receive_nb(struct BoltConnection * connection)
+{
+#if USE_IO_URING
+    if (connection->ring != NULL && connection->transport != BOLT_SECURE_SOCKET)
+    {
+        return receive_ring_nb(connection);
+    }
+#endif
+    struct BoltBuffer * buffer = connection->rx_buffer;
+    BoltBuffer_compact(buffer);
+    if (BoltBuffer_loadable(buffer) == 0)
+    {
+        BoltBuffer_load_target(buffer, buffer->size);
+        buffer->extent -= buffer->size / 2;
+    }
+    int total_received = 0;
+    while (BoltBuffer_loadable(buffer) > 0)
+    {
+        int max_size = BoltBuffer_loadable(buffer);
+        char * target = BoltBuffer_load_target(buffer, max_size);
+        int received = 0;
+        // Data is read directly from the socket unless the TLS library needs to decrypt it
+        int direct = connection->transport != BOLT_SECURE_SOCKET ||
+                     ((connection->kernel_tls & BOLT_KTLS_RECEIVE) && SSL_pending(connection->ssl) == 0);
+        if (direct)
+        {
+            received = RECEIVE(connection->socket, target, max_size, 0);
+            if (received == -1 && errno == EIO && connection->transport == BOLT_SECURE_SOCKET)
+            {
+                // The kernel has received a record other than application data,
+                // such as a session ticket or an alert, for the TLS library to process
+                direct = 0;
+            }
+        }
+        if (!direct)
+        {
+            received = RECEIVE_S(connection->ssl, target, max_size, 0);
+        }
+        // adjust the buffer extent based on the actual amount of data received
+        buffer->extent = buffer->extent - max_size + (received > 0 ? received : 0);
+        if (received > 0)
+        {
+            connection->metrics.bytes_received += received;
+            total_received += received;
+            if (direct && received < max_size)
+            {
+                // The socket has been drained
+                break;
+            }
+            continue;
+        }
+        int status = -1;
+        if (!direct)
+        {
+            status = ssl_failure(connection, received, "receive");
+        }
+        else if (received == 0)
+        {
+            BoltLog_info("bolt: Detected end of transmission");
+            set_status(connection, BOLT_DISCONNECTED, BOLT_END_OF_TRANSMISSION);
+        }
+        else if (errno == EINTR)
+        {
+            continue;
+        }
+        else if (would_block())
+        {
+            connection->awaiting = BOLT_READABLE;
+            status = BOLT_WAITING;
+        }
+        else
+        {
+            set_status(connection, BOLT_DEFUNCT, last_error());
+            BoltLog_error("bolt: Socket error %d on receive", connection->error);
+        }
+        if (total_received > 0)
+        {
+            break;
+        }
+        return status;
+    }
+    BoltLog_info("bolt: (Received %d bytes)", total_received);
+    return total_received;
+}
+
+int handshake_nb(struct BoltConnection * connection)
+{
+    int transmitted = transmit_nb(connection);
+    if (transmitted != 0)
+    {
+        return transmitted;
+    }
+    while (BoltBuffer_unloadable(connection->rx_buffer) < 4)
+    {
+        int received = receive_nb(connection);
+        if (received < 0)
+        {
+            return received;
+        }
+    }
+    char handshake[4];
+    BoltBuffer_unload(connection->rx_buffer, &handshake[0], 4);
+    memcpy_be(&connection->protocol_version, &handshake[0], 4);
+    BoltLog_info("bolt: <SET protocol_version=%d>", connection->protocol_version);
+    connection->protocol = BoltProtocol_find(connection->protocol_version);
+    if (connection->protocol == NULL)
+    {
+        close_b(connection);
+        set_status(connection, BOLT_DEFUNCT, BOLT_UNSUPPORTED);
+        return -1;
+    }
+    connection->protocol->attach(connection);
+    set_status(connection, BOLT_CONNECTED, BOLT_NO_ERROR);
+    return 0;
+}
+
+/**
+ * Fetch the next value for the current fetch request from buffered data,
+ * receiving more data whenever a complete message is not yet available.
+ *
+ * @param connection
+ * @return 1 for record data, 0 for summary metadata, -1 on error or
+ *         BOLT_WAITING if more data is required
+ */
+int fetch_nb(struct BoltConnection * connection)
+{
+    while (1)
+    {
+        if (connection->protocol == NULL)
+        {
+            set_status(connection, BOLT_DEFUNCT, BOLT_UNSUPPORTED);
+            return -1;
+        }
+        int fetched = connection->protocol->fetch(connection, connection->fetch_request);
+        if (fetched != BOLT_WAITING)
+        {
+            return fetched;
+        }
+        int received = receive_nb(connection);
+        if (received < 0)
+        {
+            return received;
+        }
+    }
+}
+
+/**
+ * Transmit all queued requests then fetch until the summary for the
+ * current fetch request has been received.
+ *
+ * @param connection
+ * @return the summary code, -1 on error or BOLT_WAITING
+ */
+int exchange_nb(struct BoltConnection * connection)
+{
+    int transmitted = transmit_nb(connection);
+    if (transmitted != 0)
+    {
+        return transmitted;
+    }
+    int fetched;
+    do
+    {
+        fetched = fetch_nb(connection);
+        if (fetched < 0)
+        {
+            return fetched;
+        }
+    } while (fetched);
+    return BoltMessage_code(BoltConnection_data(connection));
+}
+
+int initialised(struct BoltConnection * connection, int code)
+{
+    switch (code)
+    {
+        case BOLT_V1_SUCCESS:
+            set_status(connection, BOLT_READY, BOLT_NO_ERROR);
+            return 0;
+        case BOLT_V1_FAILURE:
+            set_status(connection, BOLT_DEFUNCT, BOLT_PERMISSION_DENIED);
+            return -1;
+        default:
+            BoltLog_error("bolt: Protocol violation (received summary code %d)", code);
+            set_status(connection, BOLT_DEFUNCT, BOLT_PROTOCOL_VIOLATION);
+            return -1;
+    }
+}
+
+int reset(struct BoltConnection * connection, int code)
+{
+    switch (code)
+    {
+        case BOLT_V1_SUCCESS:
+            set_status(connection, BOLT_READY, BOLT_NO_ERROR);
+            return 0;
+        default:
+            BoltLog_error("bolt: Connection failed to reset");
+            set_status(connection, BOLT_DEFUNCT, BOLT_UNKNOWN_ERROR);
+            return -1;
+    }
+}
+
+int fetched(struct BoltConnection * connection, int fetched)
+{
+    if (fetched == 0)
+    {
+        // Summary received
+        int16_t code = BoltMessage_code(BoltConnection_data(connection));
+        switch (code)
+        {
+            case BOLT_V1_SUCCESS:
+                set_status(connection, BOLT_READY, BOLT_NO_ERROR);
+                return 0;
+            case BOLT_V1_IGNORED:
+                // Leave status as-is
+                return 0;
+            case BOLT_V1_FAILURE:
+                set_status(connection, BOLT_FAILED, BOLT_UNKNOWN_ERROR);   // TODO more specific error
+                return 0;
+            default:
+                BoltLog_error("bolt: Protocol violation (received summary code %d)", code);
+                set_status(connection, BOLT_DEFUNCT, BOLT_PROTOCOL_VIOLATION);
+                return -1;
+        }
+    }
+    return fetched;
+}
+
+int BoltConnection_progress(struct BoltConnection * connection)
+{
+    int result = 0;
+    int in_progress = 1;
+    if (connection->zero_copy_releases != connection->zero_copy_sends)
+    {
+        // Queued notifications would otherwise keep the socket signalling an error condition
+        released(connection);
+    }
+    while (in_progress)
+    {
+        in_progress = 0;
+        switch (connection->stage)
+        {
+            case BOLT_IDLE:
+                return 0;
+            case BOLT_CONNECTING:
+                result = race_nb(connection);
+                if (result == 0)
+                {
+                    opened(connection);
+                    in_progress = 1;
+                }
+                break;
+            case BOLT_SECURING:
+                result = secure_nb(connection);
+                if (result == 0)
+                {
+                    BoltLog_info("bolt: Performing handshake");
+                    connection->stage = BOLT_HANDSHAKING;
+                    in_progress = 1;
+                }
+                break;
+            case BOLT_HANDSHAKING:
+                result = handshake_nb(connection);
+                break;
+            case BOLT_INITIALISING:
+                result = exchange_nb(connection);
+                if (result >= 0)
+                {
+                    result = initialised(connection, result);
+                }
+                break;
+            case BOLT_RESETTING:
+                result = exchange_nb(connection);
+                if (result >= 0)
+                {
+                    result = reset(connection, result);
+                }
+                break;
+            case BOLT_SENDING:
+                result = transmit_nb(connection);
+                break;
+            case BOLT_FETCHING:
+                result = fetch_nb(connection);
+                if (result >= 0)
+                {
+                    result = fetched(connection, result);
+                }
+                break;
+        }
+    }
+    if (result == BOLT_WAITING && remaining(&connection->deadline) == 0)
+    {
+        result = timed_out(connection);
+    }
+    if (result != BOLT_WAITING)
+    {
+        connection->stage = BOLT_IDLE;
+        connection->awaiting = 0;
+    }
+    return result;
+}
+
+#if USE_IO_URING
+
+/**
+ * Block until the ring to which the connection is attached completes an
+ * operation relevant to the events awaited by the current operation, or
+ * until its deadline passes.
+ *
+ * @param connection
+ * @return 0 when ready, -1 on error or timeout
+ */
+int wait_ring_b(struct BoltConnection * connection)
+{
+    if (BoltRing_arm(connection) == -1)
+    {
+        set_status(connection, BOLT_DEFUNCT, last_error());
+        return -1;
+    }
+    while (!BoltRing_ready(connection))
+    {
+        int timeout = BoltConnection_time_remaining(connection);
+        if (BoltRing_enter(connection->ring, timeout) == -1)
+        {
+            set_status(connection, BOLT_DEFUNCT, last_error());
+            return -1;
+        }
+        if (!BoltRing_ready(connection) && BoltConnection_time_remaining(connection) == 0)
+        {
+            // Either the deadline has passed or another connection attempt is due
+            return remaining(&connection->deadline) == 0 ? timed_out(connection) : 0;
+        }
+    }
+    connection->ring_slot->completed &= ~BOLT_RING_POLL;
+    return 0;
+}
+
+#endif // USE_IO_URING
+
+/**
+ * Block until the socket is ready for the events awaited by the
+ * current operation, or until its deadline passes.
+ *
+ * @param connection
+ * @return 0 when ready, -1 on error or timeout
+ */
+int wait_b(struct BoltConnection * connection)
+{
+#if USE_IO_URING
+    if (connection->ring != NULL)
+    {
+        return wait_ring_b(connection);
+    }
+#endif
+    struct pollfd poll_fds[BOLT_MAX_CONNECT_ATTEMPTS];
+    int n_poll_fds = 0;
+    short events = (short)(((connection->awaiting & BOLT_READABLE) ? POLLIN : 0) |
+                           ((connection->awaiting & BOLT_WRITABLE) ? POLLOUT : 0));
+    if (connection->stage == BOLT_CONNECTING)
+    {
+        for (; n_poll_fds < connection->n_attempts; n_poll_fds++)
+        {
+            poll_fds[n_poll_fds].fd = connection->attempts[n_poll_fds];
+            poll_fds[n_poll_fds].events = events;
+            poll_fds[n_poll_fds].revents = 0;
+        }
+    }
+    else
+    {
+        poll_fds[0].fd = connection->socket;
+        poll_fds[0].events = events;
+        poll_fds[0].revents = 0;
+        n_poll_fds = 1;
+    }
+    while (1)
+    {
+        int ready = POLL(&poll_fds[0], (nfds_t)(n_poll_fds), BoltConnection_time_remaining(connection));
+        if (ready > 0)
+        {
+            return 0;
+        }
+        if (ready == 0)
+        {
+            // Either the deadline has passed or another connection attempt is due
+            return remaining(&connection->deadline) == 0 ? timed_out(connection) : 0;
+        }
+        if (errno != EINTR)
+        {
+            set_status(connection, BOLT_DEFUNCT, last_error());
+            return -1;
+        }
+    }
+}
+
+/**
+ * Block until the non-blocking operation in progress completes.
+ *
+ * @param connection
+ * @param result the value returned by the call that started the operation
+ * @return outcome of the operation
+ */
+int complete_b(struct BoltConnection * connection, int result)
+{
+    while (result == BOLT_WAITING)
+    {
+        if (wait_b(connection) == -1)
+        {
+            connection->stage = BOLT_IDLE;
+            return -1;
+        }
+        result = BoltConnection_progress(connection);
+    }
+    return result;
+}
+
+void BoltSocketOptions_preset(struct BoltSocketOptions * options, enum BoltSocketPreset preset)
+{
+    memset(options, 0, sizeof(struct BoltSocketOptions));
+    options->keep_alive = 1;
+    options->no_delay = 1;
+    switch (preset)
+    {
+        case BOLT_SOCKET_DEFAULT:
+            break;
+        case BOLT_SOCKET_LOW_LATENCY:
+            options->quick_ack = 1;
+            options->busy_poll = 50;
+            break;
+        case BOLT_SOCKET_BULK_THROUGHPUT:
+            options->send_buffer_size = 4 * 1024 * 1024;
+            options->receive_buffer_size = 4 * 1024 * 1024;
+            options->zero_copy_threshold = 256 * 1024;
+            break;
+    }
+}
+
+struct BoltConnection * BoltConnection_create()
+{
+    const size_t size = sizeof(struct BoltConnection);
+    struct BoltConnection* connection = BoltMem_allocate(size);
+    memset(connection, 0, size);
+    BoltSocketOptions_preset(&connection->socket_options, BOLT_SOCKET_DEFAULT);
+    return connection;
+}
+
+void BoltConnection_destroy(struct BoltConnection* connection)
+{
+    BoltRing_detach(connection);
+    BoltMem_deallocate(connection, sizeof(struct BoltConnection));
+}
+
+int BoltConnection_open_b(struct BoltConnection * connection, enum BoltTransport transport, struct BoltAddress * address)
+{
+    return complete_b(connection, BoltConnection_open_nb(connection, transport, address));
+}
+
+int BoltConnection_open_nb(struct BoltConnection * connection, enum BoltTransport transport, struct BoltAddress * address)
+{
+    if (connection->status != BOLT_DISCONNECTED)
+    {
+        BoltConnection_close_b(connection);
+    }
+    memset(&connection->metrics, 0, sizeof(connection->metrics));
+    connection->transport = transport;
+    connection->address = address;
+    connection->address_index = -1;
+    connection->n_attempts = 0;
+    connection->attempt_error = BOLT_NO_ERROR;
+    connection->n_tx_bytes = 0;
+    connection->corked = 0;
+    connection->zero_copy = 0;
+    connection->zero_copy_sends = 0;
+    connection->zero_copy_releases = 0;
+    begin(connection, BOLT_CONNECTING, connection->timeouts.connect);
+    return BoltConnection_progress(connection);
+}
+
+void BoltConnection_close_b(struct BoltConnection* connection)
+{
+    close_attempts(connection);
+    if (connection->ring != NULL && connection->socket > 0)
+    {
+        // Buffers are released ahead of the socket
+        BoltRing_cancel(connection, connection->socket);
+    }
+    if (connection->rx_buffer != NULL)
+    {
+        BoltBuffer_destroy(connection->rx_buffer);
+        connection->rx_buffer = NULL;
+    }
+    if (connection->tx_buffer != NULL)
+    {
+        BoltBuffer_destroy(connection->tx_buffer);
+        connection->tx_buffer = NULL;
+    }
+    if (connection->tx_record != NULL)
+    {
+        BoltBuffer_destroy(connection->tx_record);
+        connection->tx_record = NULL;
+    }
+    if (connection->tx_segments != NULL)
+    {
+        BoltMem_deallocate(connection->tx_segments, (size_t)(connection->tx_segments_size) * sizeof(struct BoltTransmitSegment));
+        connection->tx_segments = NULL;
+        connection->tx_segments_size = 0;
+        connection->n_tx_segments = 0;
+    }
+    if (connection->pending_responses != NULL)
+    {
+        BoltMem_deallocate(connection->pending_responses,
+                           sizeof_n(struct BoltPendingResponse, connection->pending_responses_size));
+        connection->pending_responses = NULL;
+        connection->pending_responses_size = 0;
+        connection->n_pending_responses = 0;
+    }
+    connection->n_tx_bytes = 0;
+    connection->corked = 0;
+    connection->zero_copy_sends = 0;
+    connection->zero_copy_releases = 0;
+    if (connection->status != BOLT_DISCONNECTED)
+    {
+        close_b(connection);
+    }
+}
+
+int BoltConnection_send_b(struct BoltConnection * connection)
+{
+    return complete_b(connection, BoltConnection_send_nb(connection));
+}
+
+int BoltConnection_send_nb(struct BoltConnection * connection)
+{
+    begin(connection, BOLT_SENDING, connection->timeouts.send);
+    return BoltConnection_progress(connection);
+}
+
+int BoltConnection_receive_b(struct BoltConnection * connection, char * buffer, int size)
+{
+    if (size == 0) return 0;
+    begin(connection, BOLT_IDLE, connection->timeouts.fetch);
+    while (BoltBuffer_unloadable(connection->rx_buffer) < size)
+    {
+        int received = receive_nb(connection);
+        if (received == BOLT_WAITING)
+        {
+            if (wait_b(connection) == -1)
+            {
+                return -1;
+            }
+        }
+        else if (received == -1)
+        {
+            return -1;
+        }
+    }
+    BoltBuffer_unload(connection->rx_buffer, buffer, size);
+    return size;
+}
+
+int BoltConnection_fetch_b(struct BoltConnection * connection, bolt_request_t request)
+{
+    return complete_b(connection, BoltConnection_fetch_nb(connection, request));
+}
+
+int BoltConnection_fetch_batch_b(struct BoltConnection * connection, bolt_request_t request,
+                                 struct BoltValue ** values, int max)
+{
+    if (max < 1)
+    {
+        return -1;
+    }
+    int fetched = BoltConnection_fetch_b(connection, request);
+    if (fetched <= 0)
+    {
+        return fetched;
+    }
+    return connection->protocol->fetch_batch(connection, request, values, max);
+}
+
+/**
+ * Builder for a single result column, which holds typed values in a
+ * flat buffer for as long as every non-null value has the same type,
+ * and falls back to a list of values otherwise.
+ */
+struct column_builder
+{
+    /// Type of the non-null values so far, BOLT_NULL if there are none
+    /// yet or BOLT_LIST once types have been mixed
+    enum BoltType type;
+    /// Int64 or Float64 values, or the bytes of all strings
+    struct BoltBuffer * data;
+    /// Size of each string
+    struct BoltBuffer * sizes;
+    /// Bitmap of null rows
+    struct BoltBuffer * nulls;
+    /// Values of a mixed column, with room for more than `size` of them
+    struct BoltValue * values;
+    /// Number of values in the column
+    int32_t size;
+};
+
+void column_init(struct column_builder * column)
+{
+    column->type = BOLT_NULL;
+    column->data = BoltBuffer_create(0);
+    column->sizes = BoltBuffer_create(0);
+    column->nulls = BoltBuffer_create(0);
+    column->values = NULL;
+    column->size = 0;
+}
+
+void column_destroy(struct column_builder * column)
+{
+    BoltBuffer_destroy(column->data);
+    BoltBuffer_destroy(column->sizes);
+    BoltBuffer_destroy(column->nulls);
+    if (column->values != NULL)
+    {
+        BoltValue_destroy(column->values);
+    }
+}
+
+/**
+ * Append a value to a typed column, writing a zero or empty string for
+ * a null.
+ *
+ * @param column
+ * @param value the value, of the column type, or NULL for a null
+ */
+void column_append_typed(struct column_builder * column, struct BoltValue * value)
+{
+    switch (column->type)
+    {
+        case BOLT_INT64:
+        {
+            int64_t x = value == NULL ? 0 : BoltInt64_get(value);
+            memcpy(BoltBuffer_load_target(column->data, sizeof(x)), &x, sizeof(x));
+            break;
+        }
+        case BOLT_FLOAT64:
+        {
+            double x = value == NULL ? 0.0 : BoltFloat64_get(value);
+            memcpy(BoltBuffer_load_target(column->data, sizeof(x)), &x, sizeof(x));
+            break;
+        }
+        case BOLT_STRING:
+        {
+            int32_t size = value == NULL ? 0 : value->size;
+            if (size > 0)
+            {
+                BoltBuffer_load(column->data, BoltString_get(value), size);
+            }
+            memcpy(BoltBuffer_load_target(column->sizes, sizeof(size)), &size, sizeof(size));
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/**
+ * Append a value to a mixed column, moving it out of the record rather
+ * than copying it.
+ *
+ * @param column
+ * @param value the value, or NULL for a null
+ */
+void column_append_value(struct column_builder * column, struct BoltValue * value)
+{
+    if (column->size == column->values->size)
+    {
+        BoltList_resize(column->values, column->size < 8 ? 8 : 2 * column->size);
+    }
+    if (value != NULL)
+    {
+        _exchange(BoltList_value(column->values, column->size), value);
+    }
+}
+
+/**
+ * Convert a column to a list of values, carrying over those already
+ * appended.
+ *
+ * @param column
+ */
+void column_mix(struct column_builder * column)
+{
+    int32_t size = column->size;
+    column->values = BoltValue_create();
+    BoltValue_to_List(column->values, size < 8 ? 8 : size);
+    int string_offset = 0;
+    for (int32_t i = 0; i < size; i++)
+    {
+        if ((column->nulls->data[i / 8] >> (i % 8)) & 1)
+        {
+            continue;
+        }
+        struct BoltValue * value = BoltList_value(column->values, i);
+        switch (column->type)
+        {
+            case BOLT_INT64:
+            {
+                int64_t x;
+                memcpy(&x, &column->data->data[i * sizeof(x)], sizeof(x));
+                BoltValue_to_Int64(value, x);
+                break;
+            }
+            case BOLT_FLOAT64:
+            {
+                double x;
+                memcpy(&x, &column->data->data[i * sizeof(x)], sizeof(x));
+                BoltValue_to_Float64(value, x);
+                break;
+            }
+            case BOLT_STRING:
+            {
+                int32_t string_size;
+                memcpy(&string_size, &column->sizes->data[i * sizeof(string_size)], sizeof(string_size));
+                BoltValue_to_String(value, &column->data->data[string_offset], string_size);
+                string_offset += string_size;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    column->type = BOLT_LIST;
+}
+
+/**
+ * Append a record field to a column, switching the column to a list of
+ * values if its type does not match.
+ *
+ * @param column
+ * @param value
+ */
+void column_append(struct column_builder * column, struct BoltValue * value)
+{
+    if (column->size % 8 == 0)
+    {
+        *BoltBuffer_load_target(column->nulls, 1) = 0;
+    }
+    enum BoltType type = BoltValue_type(value);
+    if (type == BOLT_NULL)
+    {
+        column->nulls->data[column->size / 8] |= (char)(1 << (column->size % 8));
+        value = NULL;
+    }
+    else if (column->type == BOLT_NULL)
+    {
+        // The first non-null value settles the type of the column
+        int32_t size = column->size;
+        column->type = type == BOLT_INT64 || type == BOLT_FLOAT64 || type == BOLT_STRING ? type : BOLT_LIST;
+        if (column->type == BOLT_LIST)
+        {
+            column->values = BoltValue_create();
+            BoltValue_to_List(column->values, size < 8 ? 8 : size);
+        }
+        else
+        {
+            column->size = 0;
+            for (int32_t i = 0; i < size; i++)
+            {
+                column_append_typed(column, NULL);
+            }
+            column->size = size;
+        }
+    }
+    else if (column->type != BOLT_LIST && column->type != type)
+    {
+        column_mix(column);
+    }
+    if (column->type == BOLT_LIST)
+    {
+        column_append_value(column, value);
+    }
+    else if (column->type != BOLT_NULL)
+    {
+        column_append_typed(column, value);
+    }
+    column->size += 1;
+}
+
+/**
+ * Move a built column into a value, along with its null bitmap.
+ *
+ * @param column
+ * @param value
+ * @param nulls
+ */
+void column_finish(struct column_builder * column, struct BoltValue * value, struct BoltValue * nulls)
+{
+    switch (column->type)
+    {
+        case BOLT_INT64:
+            BoltValue_to_Int64Array(value, (int64_t *)(column->data->data), column->size);
+            break;
+        case BOLT_FLOAT64:
+            BoltValue_to_Float64Array(value, (double *)(column->data->data), column->size);
+            break;
+        case BOLT_STRING:
+        {
+            BoltValue_to_StringArray(value, column->size);
+            int offset = 0;
+            for (int32_t i = 0; i < column->size; i++)
+            {
+                int32_t size;
+                memcpy(&size, &column->sizes->data[i * sizeof(size)], sizeof(size));
+                BoltStringArray_put(value, i, &column->data->data[offset], size);
+                offset += size;
+            }
+            break;
+        }
+        case BOLT_LIST:
+            BoltList_resize(column->values, column->size);
+            _exchange(value, column->values);
+            break;
+        default:
+            // Only nulls, which carry no type
+            BoltValue_to_List(value, column->size);
+            break;
+    }
+    BoltValue_to_ByteArray(nulls, column->nulls->data, column->nulls->extent);
+}
+
+int BoltConnection_fetch_columns_b(struct BoltConnection * connection, bolt_request_t request,
+                                   struct BoltValue * columns, struct BoltValue * nulls)
+{
+    struct column_builder * builders = NULL;
+    int32_t width = 0;
+    int32_t rows = 0;
+    int fetched;
+    while ((fetched = BoltConnection_fetch_b(connection, request)) == 1)
+    {
+        struct BoltValue * record = BoltConnection_data(connection);
+        if (builders == NULL)
+        {
+            width = record->size;
+            builders = BoltMem_allocate(sizeof_n(struct column_builder, width));
+            for (int32_t i = 0; i < width; i++)
+            {
+                column_init(&builders[i]);
+            }
+        }
+        if (record->size != width || rows == INT32_MAX)
+        {
+            fetched = -1;
+            break;
+        }
+        for (int32_t i = 0; i < width; i++)
+        {
+            struct BoltValue * field = BoltConnection_record_field(connection, i);
+            if (field == NULL)
+            {
+                fetched = -1;
+                break;
+            }
+            column_append(&builders[i], field);
+        }
+        if (fetched == -1)
+        {
+            break;
+        }
+        rows += 1;
+    }
+    if (fetched == 0)
+    {
+        BoltValue_to_List(columns, width);
+        BoltValue_to_List(nulls, width);
+        for (int32_t i = 0; i < width; i++)
+        {
+            column_finish(&builders[i], BoltList_value(columns, i), BoltList_value(nulls, i));
+        }
+    }
+    if (builders != NULL)
+    {
+        for (int32_t i = 0; i < width; i++)
+        {
+            column_destroy(&builders[i]);
+        }
+        BoltMem_deallocate(builders, sizeof_n(struct column_builder, width));
+    }
+    return fetched == -1 ? -1 : rows;
+}
+
+int BoltConnection_fetch_nb(struct BoltConnection * connection, bolt_request_t request)
+{
+    begin(connection, BOLT_FETCHING, connection->timeouts.fetch);
+    connection->fetch_request = request;
+    return BoltConnection_progress(connection);
+}
+
+int BoltConnection_fetch_summary_b(struct BoltConnection * connection, bolt_request_t request)
+{
+    int records = 0;
+    int data;
+    do
+    {
+        // Buffered records are passed over undecoded, unless they are
+        // to be streamed through record handlers
+        if (connection->protocol != NULL && connection->record_handlers == NULL)
+        {
+            records += connection->protocol->skip_records(connection, request);
+        }
+        data = BoltConnection_fetch_b(connection, request);
+        if (data < 0)
+        {
+            return data;
+        }
         records += data;
     }
     while (data);
     return records;
 }
 
-struct BoltValue* BoltConnection_data(struct BoltConnection * connection)
+int BoltConnection_set_callbacks(struct BoltConnection * connection, bolt_request_t request,
+                                 const struct BoltResponseCallbacks * callbacks)
+{
+    const int n = connection->n_pending_responses;
+    if (n > 0 && request <= connection->pending_responses[n - 1].request)
+    {
+        BoltLog_error("bolt: Callbacks for request %llu registered out of order", request);
+        return -1;
+    }
+    if (n == connection->pending_responses_size)
+    {
+        int new_size = n == 0 ? INITIAL_PENDING_RESPONSES_SIZE : 2 * n;
+        connection->pending_responses = BoltMem_reallocate(connection->pending_responses,
+                                                           sizeof_n(struct BoltPendingResponse, n),
+                                                           sizeof_n(struct BoltPendingResponse, new_size));
+        connection->pending_responses_size = new_size;
+    }
+    connection->pending_responses[n].request = request;
+    connection->pending_responses[n].callbacks = callbacks;
+    connection->n_pending_responses = n + 1;
+    return 0;
+}
+
+/**
+ * Fetch the response to a request and deliver it to its callbacks.
+ *
+ * @param connection
+ * @param response the request and its callbacks
+ * @return 0 on success, -1 on error
+ */
+int dispatch_b(struct BoltConnection * connection, struct BoltPendingResponse response)
 {
-    switch (connection->protocol_version)
+    const struct BoltResponseCallbacks * callbacks = response.callbacks;
+    int data;
+    do
     {
-        case 1:
+        if (callbacks->on_record == NULL && connection->record_handlers == NULL)
+        {
+            connection->protocol->skip_records(connection, response.request);
+        }
+        data = BoltConnection_fetch_b(connection, response.request);
+        if (data == -1)
+        {
+            return -1;
+        }
+        if (data == 1 && callbacks->on_record != NULL)
         {
-            struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-            return state->data;
+            callbacks->on_record(callbacks->context, connection, response.request, BoltConnection_data(connection));
         }
+    }
+    while (data);
+    struct BoltValue * summary = BoltConnection_data(connection);
+    void (*callback)(void *, struct BoltConnection *, bolt_request_t, struct BoltValue *);
+    switch (BoltMessage_code(summary))
+    {
+        case BOLT_V1_SUCCESS:
+            callback = callbacks->on_success;
+            break;
+        case BOLT_V1_FAILURE:
+            callback = callbacks->on_failure;
+            break;
         default:
-            return NULL;
+            callback = callbacks->on_ignored;
+            break;
+    }
+    if (callback != NULL)
+    {
+        callback(callbacks->context, connection, response.request, summary);
     }
+    return 0;
 }
 
-int BoltConnection_init_b(struct BoltConnection * connection, const struct BoltUserProfile * profile)
+int BoltConnection_dispatch_b(struct BoltConnection * connection)
 {
-    BoltLog_info("bolt: Initialising connection for user '%s'", profile->user);
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
+        return -1;
+    }
+    int dispatched = 0;
+    int result = 0;
+    // Callbacks may register further requests, which extend the queue
+    // while it is being dispatched
+    while (dispatched < connection->n_pending_responses)
+    {
+        if (connection->n_tx_bytes > 0 && BoltConnection_send_b(connection) == -1)
         {
-            int code = BoltProtocolV1_init_b(connection, profile);
-            switch (code)
-            {
-                case BOLT_V1_SUCCESS:
-                    set_status(connection, BOLT_READY, BOLT_NO_ERROR);
-                    return 0;
-                case BOLT_V1_FAILURE:
-                    set_status(connection, BOLT_DEFUNCT, BOLT_PERMISSION_DENIED);
-                    return -1;
-                default:
-                    BoltLog_error("bolt: Protocol violation (received summary code %d)", code);
-                    set_status(connection, BOLT_DEFUNCT, BOLT_PROTOCOL_VIOLATION);
-                    return -1;
-            }
+            result = -1;
+            break;
         }
-        default:
-            set_status(connection, BOLT_DEFUNCT, BOLT_UNSUPPORTED);
-            return -1;
+        if (dispatch_b(connection, connection->pending_responses[dispatched]) == -1)
+        {
+            result = -1;
+            break;
+        }
+        dispatched += 1;
+    }
+    if (dispatched > 0)
+    {
+        connection->n_pending_responses -= dispatched;
+        memmove(&connection->pending_responses[0], &connection->pending_responses[dispatched],
+                sizeof_n(struct BoltPendingResponse, connection->n_pending_responses));
+    }
+    return result == -1 ? -1 : dispatched;
+}
+
+struct BoltValue* BoltConnection_data(struct BoltConnection * connection)
+{
+    if (connection->protocol == NULL)
+    {
+        return NULL;
+    }
+    return connection->protocol->data(connection);
+}
+
+struct BoltValue * BoltConnection_record_field(struct BoltConnection * connection, int32_t index)
+{
+    if (connection->protocol == NULL)
+    {
+        return NULL;
+    }
+    return connection->protocol->record_field(connection, index);
+}
+
+int BoltConnection_init_b(struct BoltConnection * connection, const struct BoltUserProfile * profile)
+{
+    return complete_b(connection, BoltConnection_init_nb(connection, profile));
+}
+
+int BoltConnection_init_nb(struct BoltConnection * connection, const struct BoltUserProfile * profile)
+{
+    BoltLog_info("bolt: Initialising connection for user '%s'", profile->user);
+    if (connection->protocol == NULL)
+    {
+        set_status(connection, BOLT_DEFUNCT, BOLT_UNSUPPORTED);
+        return -1;
     }
+    TRY(connection->protocol->load_init_request(connection, profile));
+    begin(connection, BOLT_INITIALISING, connection->timeouts.handshake);
+    connection->fetch_request = BoltConnection_last_request(connection);
+    return BoltConnection_progress(connection);
 }
 
 int BoltConnection_reset_b(struct BoltConnection * connection)
+{
+    return complete_b(connection, BoltConnection_reset_nb(connection));
+}
+
+int BoltConnection_reset_nb(struct BoltConnection * connection)
 {
     BoltLog_info("bolt: Resetting connection");
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-        {
-            int code = BoltProtocolV1_reset_b(connection);
-            switch (code)
-            {
-                case BOLT_V1_SUCCESS:
-                    set_status(connection, BOLT_READY, BOLT_NO_ERROR);
-                    return 0;
-                default:
-                    BoltLog_error("bolt: Connection failed to reset");
-                    set_status(connection, BOLT_DEFUNCT, BOLT_UNKNOWN_ERROR);
-                    return -1;
-            }
-        }
-        default:
-            set_status(connection, BOLT_DEFUNCT, BOLT_UNSUPPORTED);
-            return -1;
+        set_status(connection, BOLT_DEFUNCT, BOLT_UNSUPPORTED);
+        return -1;
     }
+    TRY(connection->protocol->load_reset_request(connection));
+    begin(connection, BOLT_RESETTING, connection->timeouts.fetch);
+    connection->fetch_request = BoltConnection_last_request(connection);
+    return BoltConnection_progress(connection);
 }
 
 int BoltConnection_cypher(struct BoltConnection * connection, const char * cypher, int32_t n_parameters)
@@ -629,16 +2587,14 @@ int BoltConnection_cypher(struct BoltConnection * connection, const char * cyphe
 
 int BoltConnection_cypher_x(struct BoltConnection * connection, const char * cypher, size_t cypher_size, int32_t n_parameters)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            switch (BoltProtocolV1_set_cypher_template(connection, cypher, cypher_size))
-            {
-                case 0:
-                    return BoltProtocolV1_set_n_cypher_parameters(connection, n_parameters);
-                default:
-                    return -1;
-            }
+        return -1;
+    }
+    switch (connection->protocol->set_cypher_template(connection, cypher, cypher_size))
+    {
+        case 0:
+            return connection->protocol->set_n_cypher_parameters(connection, n_parameters);
         default:
             return -1;
     }
@@ -651,16 +2607,14 @@ struct BoltValue * BoltConnection_cypher_parameter(struct BoltConnection * conne
 
 struct BoltValue * BoltConnection_cypher_parameter_x(struct BoltConnection * connection, int32_t index, const char * key, size_t key_size)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            switch (BoltProtocolV1_set_cypher_parameter_key(connection, index, key, key_size))
-            {
-                case 0:
-                    return BoltProtocolV1_cypher_parameter_value(connection, index);
-                default:
-                    return NULL;
-            }
+        return NULL;
+    }
+    switch (connection->protocol->set_cypher_parameter_key(connection, index, key, key_size))
+    {
+        case 0:
+            return connection->protocol->cypher_parameter_value(connection, index);
         default:
             return NULL;
     }
@@ -668,162 +2622,269 @@ struct BoltValue * BoltConnection_cypher_parameter_x(struct BoltConnection * con
 
 int BoltConnection_load_bookmark(struct BoltConnection * connection, const char * bookmark)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            return BoltProtocolV1_load_bookmark(connection, bookmark);
-        default:
-            return -1;
+        return -1;
+    }
+    return connection->protocol->load_bookmark(connection, bookmark);
+}
+
+int BoltConnection_load_tx_timeout(struct BoltConnection * connection, int64_t timeout)
+{
+    if (connection->protocol == NULL || connection->protocol->load_tx_timeout == NULL)
+    {
+        return -1;
+    }
+    return connection->protocol->load_tx_timeout(connection, timeout);
+}
+
+struct BoltValue * BoltConnection_load_tx_metadata(struct BoltConnection * connection, int32_t size)
+{
+    if (connection->protocol == NULL || connection->protocol->load_tx_metadata == NULL)
+    {
+        return NULL;
     }
+    return connection->protocol->load_tx_metadata(connection, size);
 }
 
 int BoltConnection_load_begin_request(struct BoltConnection * connection)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            return BoltProtocolV1_load_begin_request(connection);
-        default:
-            return -1;
+        return -1;
     }
+    return connection->protocol->load_begin_request(connection);
 }
 
 int BoltConnection_load_commit_request(struct BoltConnection * connection)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            return BoltProtocolV1_load_commit_request(connection);
-        default:
-            return -1;
+        return -1;
     }
+    return connection->protocol->load_commit_request(connection);
 }
 
 int BoltConnection_load_rollback_request(struct BoltConnection * connection)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            return BoltProtocolV1_load_rollback_request(connection);
-        default:
-            return -1;
+        return -1;
     }
+    return connection->protocol->load_rollback_request(connection);
 }
 
 int BoltConnection_load_run_request(struct BoltConnection * connection)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            return BoltProtocolV1_load_run_request(connection);
-        default:
-            return -1;
+        return -1;
+    }
+    return connection->protocol->load_run_request(connection);
+}
+
+struct BoltStatement * BoltStatement_create(const char * cypher, size_t cypher_size, const char ** keys,
+                                            int32_t n_parameters)
+{
+    if (cypher_size > INT32_MAX || n_parameters < 0)
+    {
+        return NULL;
+    }
+    struct BoltStatement * statement = BoltMem_allocate(sizeof(struct BoltStatement));
+    statement->data = BoltBuffer_create((int)(cypher_size) + 16);
+    statement->key_offsets = BoltMem_allocate(sizeof_n(int32_t, n_parameters + 1));
+    statement->n_parameters = n_parameters;
+    if (BoltProtocolV1_compile_statement(statement->data, cypher, (int32_t)(cypher_size), keys, n_parameters,
+                                         statement->key_offsets) == -1)
+    {
+        BoltStatement_destroy(statement);
+        return NULL;
+    }
+    return statement;
+}
+
+void BoltStatement_destroy(struct BoltStatement * statement)
+{
+    BoltBuffer_destroy(statement->data);
+    BoltMem_deallocate(statement->key_offsets, sizeof_n(int32_t, statement->n_parameters + 1));
+    BoltMem_deallocate(statement, sizeof(struct BoltStatement));
+}
+
+int BoltConnection_load_statement_run_request(struct BoltConnection * connection,
+                                              const struct BoltStatement * statement,
+                                              const struct BoltValue * parameters)
+{
+    if (connection->protocol == NULL)
+    {
+        return -1;
+    }
+    return connection->protocol->load_statement_run_request(connection, statement, parameters);
+}
+
+int BoltConnection_begin_run_request(struct BoltConnection * connection, const char * cypher,
+                                     size_t cypher_size, int32_t n_parameters)
+{
+    if (connection->protocol == NULL)
+    {
+        return -1;
+    }
+    return connection->protocol->begin_run_request(connection, cypher, cypher_size, n_parameters);
+}
+
+int BoltConnection_end_run_request(struct BoltConnection * connection)
+{
+    if (connection->protocol == NULL)
+    {
+        return -1;
+    }
+    return connection->protocol->end_run_request(connection);
+}
+
+int BoltConnection_write_key(struct BoltConnection * connection, const char * key, int32_t key_size)
+{
+    return BoltConnection_write_string(connection, key, key_size);
+}
+
+int BoltConnection_write_null(struct BoltConnection * connection)
+{
+    if (connection->protocol == NULL)
+    {
+        return -1;
+    }
+    return connection->protocol->write_null(connection);
+}
+
+int BoltConnection_write_boolean(struct BoltConnection * connection, int value)
+{
+    if (connection->protocol == NULL)
+    {
+        return -1;
+    }
+    return connection->protocol->write_boolean(connection, value);
+}
+
+int BoltConnection_write_integer(struct BoltConnection * connection, int64_t value)
+{
+    if (connection->protocol == NULL)
+    {
+        return -1;
+    }
+    return connection->protocol->write_integer(connection, value);
+}
+
+int BoltConnection_write_float(struct BoltConnection * connection, double value)
+{
+    if (connection->protocol == NULL)
+    {
+        return -1;
+    }
+    return connection->protocol->write_float(connection, value);
+}
+
+int BoltConnection_write_string(struct BoltConnection * connection, const char * data, int32_t size)
+{
+    if (connection->protocol == NULL)
+    {
+        return -1;
+    }
+    return connection->protocol->write_string(connection, data, size);
+}
+
+int BoltConnection_write_bytes(struct BoltConnection * connection, const char * data, int32_t size)
+{
+    if (connection->protocol == NULL)
+    {
+        return -1;
+    }
+    return connection->protocol->write_bytes(connection, data, size);
+}
+
+int BoltConnection_write_list(struct BoltConnection * connection, int32_t size)
+{
+    if (connection->protocol == NULL)
+    {
+        return -1;
+    }
+    return connection->protocol->write_list(connection, size);
+}
+
+int BoltConnection_write_map(struct BoltConnection * connection, int32_t size)
+{
+    if (connection->protocol == NULL)
+    {
+        return -1;
     }
+    return connection->protocol->write_map(connection, size);
 }
 
 int BoltConnection_load_discard_request(struct BoltConnection * connection, int32_t n)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            if (n >= 0)
-            {
-                return -1;
-            }
-            else
-            {
-                struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-                BoltProtocolV1_load_message(connection, state->discard_request);
-                return 0;
-            }
-        default:
-            return -1;
+        return -1;
     }
+    return connection->protocol->load_discard_request(connection, n);
 }
 
 int BoltConnection_load_pull_request(struct BoltConnection * connection, int32_t n)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            return BoltProtocolV1_load_pull_request(connection, n);
-        default:
-            return -1;
+        return -1;
     }
+    return connection->protocol->load_pull_request(connection, n);
 }
 
 bolt_request_t BoltConnection_last_request(struct BoltConnection * connection)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-        {
-            struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-            if (state == NULL)
-            {
-                return 0;
-            }
-            return state->next_request_id - 1;
-        }
-        default:
-        {
-            // TODO
-            return 0;
-        }
+        return 0;
     }
+    return connection->protocol->last_request(connection);
 }
 
 int32_t BoltConnection_n_fields(struct BoltConnection * connection)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            return BoltProtocolV1_n_fields(connection);
-        default:
-            return -1;
+        return -1;
     }
+    return connection->protocol->n_fields(connection);
 }
 
 const char * BoltConnection_field_name(struct BoltConnection * connection, int32_t index)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            return BoltProtocolV1_field_name(connection, index);
-        default:
-            return NULL;
+        return NULL;
     }
+    return connection->protocol->field_name(connection, index);
 }
 
 int32_t BoltConnection_field_name_size(struct BoltConnection * connection, int32_t index)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            return BoltProtocolV1_field_name_size(connection, index);
-        default:
-            return -1;
+        return -1;
     }
+    return connection->protocol->field_name_size(connection, index);
 }
 
 int BoltConnection_dump_field_names(struct BoltConnection * connection, struct BoltBuffer * buffer)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            return BoltProtocolV1_dump(BoltProtocolV1_state(connection)->fields, buffer);
-        default:
-            return -1;
+        return -1;
     }
+    return connection->protocol->dump_field_names(connection, buffer);
 }
 
 int BoltConnection_dump_data(struct BoltConnection * connection, struct BoltBuffer * buffer)
 {
-    switch (connection->protocol_version)
+    if (connection->protocol == NULL)
     {
-        case 1:
-            return BoltProtocolV1_dump(BoltProtocolV1_state(connection)->data, buffer);
-        default:
-            return -1;
+        return -1;
     }
+    return connection->protocol->dump_data(connection, buffer);
 }
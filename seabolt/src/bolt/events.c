@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) 2002-2018 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bolt/config-impl.h"
+#include "bolt/events.h"
+#include "bolt/logging.h"
+#include "bolt/mem.h"
+#include "bolt/ring.h"
+
+
+#define MAX_EVENTS 64
+
+
+#if USE_EPOLL
+
+uint32_t epoll_events(struct BoltConnection * connection)
+{
+    return ((connection->awaiting & BOLT_READABLE) ? EPOLLIN : 0u) |
+           ((connection->awaiting & BOLT_WRITABLE) ? EPOLLOUT : 0u);
+}
+
+/**
+ * Register the socket of a watched connection for the events awaited by
+ * its current operation, re-registering if the socket has changed.
+ *
+ * @param loop
+ * @param watch
+ * @return 0 on success, -1 on error
+ */
+int arm_descriptor(struct BoltEventLoop * loop, struct BoltEventWatch * watch)
+{
+    struct epoll_event event;
+    event.events = epoll_events(watch->connection);
+    event.data.ptr = watch;
+    if (watch->connection->stage == BOLT_CONNECTING)
+    {
+        // Watch every connection attempt in progress; sockets of failed
+        // attempts drop out of the interest list as they are closed
+        for (int i = 0; i < watch->connection->n_attempts; i++)
+        {
+            int attempt = watch->connection->attempts[i];
+            if (epoll_ctl(loop->descriptor, EPOLL_CTL_ADD, attempt, &event) == -1 && errno != EEXIST)
+            {
+                BoltLog_error("bolt: Unable to watch socket %d (error %d)", attempt, errno);
+                return -1;
+            }
+        }
+        watch->socket = -1;
+        watch->events = 0;
+        return 0;
+    }
+    int socket = watch->connection->socket;
+    if (socket == watch->socket && (int)(event.events) == watch->events)
+    {
+        return 0;
+    }
+    if (socket == watch->socket && epoll_ctl(loop->descriptor, EPOLL_CTL_MOD, socket, &event) == 0)
+    {
+        watch->events = (int)(event.events);
+        return 0;
+    }
+    // Either the socket is new or its previous registration was dropped when closed
+    if (epoll_ctl(loop->descriptor, EPOLL_CTL_ADD, socket, &event) == -1)
+    {
+        if (errno != EEXIST || epoll_ctl(loop->descriptor, EPOLL_CTL_MOD, socket, &event) == -1)
+        {
+            BoltLog_error("bolt: Unable to watch socket %d (error %d)", socket, errno);
+            return -1;
+        }
+    }
+    watch->socket = socket;
+    watch->events = (int)(event.events);
+    return 0;
+}
+
+int wait_descriptor(struct BoltEventLoop * loop, int timeout, struct BoltEventWatch ** ready)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int n_events = epoll_wait(loop->descriptor, &events[0], MAX_EVENTS, timeout);
+    if (n_events == -1)
+    {
+        return errno == EINTR ? 0 : -1;
+    }
+    for (int i = 0; i < n_events; i++)
+    {
+        ready[i] = events[i].data.ptr;
+    }
+    return n_events;
+}
+
+/**
+ * Attach a watched connection to the ring of the loop and poll for the
+ * events awaited by its current operation, unless the socket I/O that
+ * it has in flight will complete anyway.
+ *
+ * @param loop
+ * @param watch
+ * @return 0 on success, -1 on error
+ */
+int arm_ring(struct BoltEventLoop * loop, struct BoltEventWatch * watch)
+{
+    struct BoltConnection * connection = watch->connection;
+    if (BoltRing_attach(loop->ring, connection) == -1 || BoltRing_arm(connection) == -1)
+    {
+        BoltLog_error("bolt: Unable to watch socket %d", connection->socket);
+        return -1;
+    }
+    watch->socket = connection->socket;
+    watch->events = connection->awaiting;
+    return 0;
+}
+
+/**
+ * Submit the socket I/O of all connections on the ring of the loop in a
+ * single system call, collecting those with relevant completions.
+ *
+ * @param loop
+ * @param timeout maximum time to wait in milliseconds, or -1 to wait indefinitely
+ * @param ready array of at least MAX_EVENTS watches to fill
+ * @return the number of ready watches, or -1 on error
+ */
+int wait_ring(struct BoltEventLoop * loop, int timeout, struct BoltEventWatch ** ready)
+{
+    for (struct BoltEventWatch * watch = loop->watches; watch != NULL; watch = watch->next)
+    {
+        if (BoltRing_ready(watch->connection))
+        {
+            // Completions left over from the last round need no waiting for
+            timeout = 0;
+            break;
+        }
+    }
+    if (BoltRing_enter(loop->ring, timeout) == -1)
+    {
+        return -1;
+    }
+    int n_ready = 0;
+    for (struct BoltEventWatch * watch = loop->watches; watch != NULL && n_ready < MAX_EVENTS; watch = watch->next)
+    {
+        if (BoltRing_ready(watch->connection))
+        {
+            watch->connection->ring_slot->completed &= ~BOLT_RING_POLL;
+            ready[n_ready] = watch;
+            n_ready += 1;
+        }
+    }
+    return n_ready;
+}
+
+int arm(struct BoltEventLoop * loop, struct BoltEventWatch * watch)
+{
+    return loop->ring != NULL ? arm_ring(loop, watch) : arm_descriptor(loop, watch);
+}
+
+void unwatch(struct BoltEventLoop * loop, struct BoltEventWatch * watch)
+{
+    struct BoltConnection * connection = watch->connection;
+    if (loop->ring == NULL && connection->stage == BOLT_CONNECTING)
+    {
+        for (int i = 0; i < connection->n_attempts; i++)
+        {
+            epoll_ctl(loop->descriptor, EPOLL_CTL_DEL, connection->attempts[i], NULL);
+        }
+    }
+    else if (loop->ring == NULL && watch->socket != -1 && connection->socket == watch->socket)
+    {
+        epoll_ctl(loop->descriptor, EPOLL_CTL_DEL, watch->socket, NULL);
+    }
+    for (int i = 0; i < loop->n_ready; i++)
+    {
+        if (loop->ready[i] == watch)
+        {
+            loop->ready[i] = NULL;
+        }
+    }
+    struct BoltEventWatch ** link = &loop->watches;
+    while (*link != watch)
+    {
+        link = &(*link)->next;
+    }
+    *link = watch->next;
+    loop->n_watched -= 1;
+    BoltMem_deallocate(watch, sizeof(struct BoltEventWatch));
+}
+
+/**
+ * Progress the connection of a watch. Once its operation completes, the
+ * watch is released before the handler is called, as the handler may
+ * destroy the connection or watch it afresh for another operation.
+ *
+ * @param loop
+ * @param watch
+ * @return 1 if the operation completed, 0 otherwise
+ */
+int progress(struct BoltEventLoop * loop, struct BoltEventWatch * watch)
+{
+    struct BoltConnection * connection = watch->connection;
+    int result = BoltConnection_progress(connection);
+    if (result == BOLT_WAITING)
+    {
+        if (arm(loop, watch) == -1)
+        {
+            unwatch(loop, watch);
+        }
+        return 0;
+    }
+    bolt_event_handler_t handler = watch->handler;
+    void * data = watch->data;
+    unwatch(loop, watch);
+    handler(loop, connection, result, data);
+    return 1;
+}
+
+/**
+ * Progress a set of watches, calling handlers for any operations that
+ * complete as a result. Entries are cleared as their watches are
+ * released, including by handlers, so that none is progressed once freed.
+ *
+ * @param loop
+ * @param ready watches to progress
+ * @param n_ready number of watches
+ * @return the number of operations completed
+ */
+int progress_ready(struct BoltEventLoop * loop, struct BoltEventWatch ** ready, int n_ready)
+{
+    loop->ready = ready;
+    loop->n_ready = n_ready;
+    int completed = 0;
+    for (int i = 0; i < n_ready; i++)
+    {
+        struct BoltEventWatch * watch = ready[i];
+        if (watch == NULL)
+        {
+            continue;
+        }
+        // A connection racing several attempts is watched through the socket
+        // of each, so may be reported more than once, but is progressed once
+        for (int j = i + 1; j < n_ready; j++)
+        {
+            if (ready[j] == watch)
+            {
+                ready[j] = NULL;
+            }
+        }
+        completed += progress(loop, watch);
+    }
+    loop->ready = NULL;
+    loop->n_ready = 0;
+    return completed;
+}
+
+/**
+ * Progress watched connections whose deadlines have passed or that are
+ * due to start another connection attempt, calling handlers for any
+ * operations that complete as a result.
+ *
+ * @param loop
+ * @return the number of operations completed
+ */
+int expire(struct BoltEventLoop * loop)
+{
+    struct BoltEventWatch * expired[MAX_EVENTS];
+    int n_expired = 0;
+    for (struct BoltEventWatch * watch = loop->watches; watch != NULL && n_expired < MAX_EVENTS; watch = watch->next)
+    {
+        if (BoltConnection_time_remaining(watch->connection) == 0)
+        {
+            expired[n_expired] = watch;
+            n_expired += 1;
+        }
+    }
+    return progress_ready(loop, &expired[0], n_expired);
+}
+
+struct BoltEventLoop * BoltEventLoop_create()
+{
+    struct BoltRing * ring = NULL;
+#if USE_IO_URING
+    // Fall back to readiness notification where io_uring is unavailable
+    ring = BoltRing_create(BOLT_RING_ENTRIES);
+#endif
+    int descriptor = -1;
+    if (ring == NULL)
+    {
+        descriptor = epoll_create1(EPOLL_CLOEXEC);
+        if (descriptor == -1)
+        {
+            BoltLog_error("bolt: Unable to create event loop (error %d)", errno);
+            return NULL;
+        }
+    }
+    struct BoltEventLoop * loop = BoltMem_allocate(sizeof(struct BoltEventLoop));
+    loop->descriptor = descriptor;
+    loop->ring = ring;
+    loop->n_watched = 0;
+    loop->watches = NULL;
+    loop->ready = NULL;
+    loop->n_ready = 0;
+    return loop;
+}
+
+void BoltEventLoop_destroy(struct BoltEventLoop * loop)
+{
+    while (loop->watches != NULL)
+    {
+        unwatch(loop, loop->watches);
+    }
+    if (loop->ring != NULL)
+    {
+        BoltRing_destroy(loop->ring);
+    }
+    else
+    {
+        close(loop->descriptor);
+    }
+    BoltMem_deallocate(loop, sizeof(struct BoltEventLoop));
+}
+
+int BoltEventLoop_watch(struct BoltEventLoop * loop, struct BoltConnection * connection,
+                        bolt_event_handler_t handler, void * data)
+{
+    struct BoltEventWatch * watch = loop->watches;
+    while (watch != NULL && watch->connection != connection)
+    {
+        watch = watch->next;
+    }
+    if (watch == NULL)
+    {
+        watch = BoltMem_allocate(sizeof(struct BoltEventWatch));
+        watch->connection = connection;
+        watch->socket = -1;
+        watch->events = 0;
+        watch->next = loop->watches;
+        loop->watches = watch;
+        loop->n_watched += 1;
+    }
+    watch->handler = handler;
+    watch->data = data;
+    if (arm(loop, watch) == -1)
+    {
+        unwatch(loop, watch);
+        return -1;
+    }
+    return 0;
+}
+
+int BoltEventLoop_unwatch(struct BoltEventLoop * loop, struct BoltConnection * connection)
+{
+    for (struct BoltEventWatch * watch = loop->watches; watch != NULL; watch = watch->next)
+    {
+        if (watch->connection == connection)
+        {
+            unwatch(loop, watch);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int BoltEventLoop_run_once(struct BoltEventLoop * loop, int timeout)
+{
+    // Wake in time to expire the earliest deadline of any watched connection
+    for (struct BoltEventWatch * watch = loop->watches; watch != NULL; watch = watch->next)
+    {
+        int remaining = BoltConnection_time_remaining(watch->connection);
+        if (remaining >= 0 && (timeout < 0 || remaining < timeout))
+        {
+            timeout = remaining;
+        }
+    }
+    struct BoltEventWatch * ready[MAX_EVENTS];
+    int n_ready = loop->ring != NULL ? wait_ring(loop, timeout, &ready[0]) : wait_descriptor(loop, timeout, &ready[0]);
+    if (n_ready == -1)
+    {
+        return -1;
+    }
+    int completed = progress_ready(loop, &ready[0], n_ready);
+    return completed + expire(loop);
+}
+
+int BoltEventLoop_run(struct BoltEventLoop * loop)
+{
+    while (loop->n_watched > 0)
+    {
+        if (BoltEventLoop_run_once(loop, -1) == -1)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#else
+
+struct BoltEventLoop * BoltEventLoop_create()
+{
+    BoltLog_error("bolt: Event loops are not supported on this platform");
+    return NULL;
+}
+
+void BoltEventLoop_destroy(struct BoltEventLoop * loop)
+{
+    (void)(loop);
+}
+
+int BoltEventLoop_watch(struct BoltEventLoop * loop, struct BoltConnection * connection,
+                        bolt_event_handler_t handler, void * data)
+{
+    (void)(loop);
+    (void)(connection);
+    (void)(handler);
+    (void)(data);
+    return -1;
+}
+
+int BoltEventLoop_unwatch(struct BoltEventLoop * loop, struct BoltConnection * connection)
+{
+    (void)(loop);
+    (void)(connection);
+    return -1;
+}
+
+int BoltEventLoop_run_once(struct BoltEventLoop * loop, int timeout)
+{
+    (void)(loop);
+    (void)(timeout);
+    return -1;
+}
+
+int BoltEventLoop_run(struct BoltEventLoop * loop)
+{
+    (void)(loop);
+    return -1;
+}
+
+#endif // USE_EPOLL
@@ -19,6 +19,7 @@
 
 #include "bolt/lifecycle.h"
 #include "bolt/config-impl.h"
+#include "bolt/security.h"
 
 
 void Bolt_startup()
@@ -29,7 +30,8 @@ void Bolt_startup()
 #endif
 
 #if USE_OPENSSL
-
+    OPENSSL_init_ssl(OPENSSL_INIT_LOAD_SSL_STRINGS | OPENSSL_INIT_LOAD_CRYPTO_STRINGS, NULL);
+    BoltSecurityContext_default();
 #endif
 }
 
@@ -40,4 +42,8 @@ void Bolt_shutdown()
 	//WSACleanup();
 #endif
 
+#if USE_OPENSSL
+    BoltSecurityContext_destroy_default();
+#endif
+
 }
\ No newline at end of file
@@ -98,6 +98,11 @@ int open_init(struct BoltConnectionPool * pool, int index)
             return -1;  // Could not resolve address
     }
     struct BoltConnection * connection = &pool->connections[index];
+    connection->timeouts = pool->timeouts;
+    connection->socket_options = pool->socket_options;
+    connection->flush_policy = pool->flush_policy;
+    connection->retention_policy = pool->retention_policy;
+    connection->security_context = pool->security_context;
     switch (BoltConnection_open_b(connection, pool->transport, pool->address))
     {
         case 0:
@@ -157,6 +162,13 @@ struct BoltConnectionPool * BoltConnectionPool_create(enum BoltTransport transpo
     pool->size = size;
     pool->connections = BoltMem_allocate(size * sizeof(struct BoltConnection));
     memset(pool->connections, 0, size * sizeof(struct BoltConnection));
+    memset(&pool->timeouts, 0, sizeof(struct BoltTimeouts));
+    BoltSocketOptions_preset(&pool->socket_options, BOLT_SOCKET_DEFAULT);
+    memset(&pool->flush_policy, 0, sizeof(struct BoltFlushPolicy));
+    memset(&pool->retention_policy, 0, sizeof(struct BoltRetentionPolicy));
+    // Pooled connections all share one TLS context, so that reconnections
+    // can resume previous sessions with the server
+    pool->security_context = transport == BOLT_SECURE_SOCKET ? BoltSecurityContext_create() : NULL;
     return pool;
 }
 
@@ -167,6 +179,7 @@ void BoltConnectionPool_destroy(struct BoltConnectionPool * pool)
         close_pool_entry(pool, index);
     }
     pool->connections = BoltMem_deallocate(pool->connections, pool->size * sizeof(struct BoltConnection));
+    BoltSecurityContext_destroy(pool->security_context);
     pthread_mutex_destroy(&pool->mutex);
     BoltMem_deallocate(pool, SIZE_OF_CONNECTION_POOL);
 }
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2002-2018 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "protocol.h"
+
+
+const struct BoltProtocol * BoltProtocol_find(int32_t version)
+{
+    switch (version)
+    {
+        case 1:
+            return &BOLT_PROTOCOL_V1;
+        case 2:
+            return &BOLT_PROTOCOL_V2;
+        case 3:
+            return &BOLT_PROTOCOL_V3;
+        default:
+            return NULL;
+    }
+}
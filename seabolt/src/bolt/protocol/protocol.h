@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2002-2018 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_PROTOCOL
+#define SEABOLT_PROTOCOL
+
+#include <stdint.h>
+
+#include "bolt/direct.h"
+
+
+/**
+ * Operations of a Bolt protocol version, through which a connection
+ * carries out all protocol-specific work once a version has been agreed
+ * during the handshake. Operations that a version does not support are
+ * left NULL.
+ */
+struct BoltProtocol
+{
+    /// The version number proposed and agreed during the handshake
+    int32_t version;
+
+    /// Create the protocol state of a connection
+    void (*attach)(struct BoltConnection * connection);
+    /// Destroy the protocol state of a connection
+    void (*detach)(struct BoltConnection * connection);
+
+    int (*fetch)(struct BoltConnection * connection, bolt_request_t request_id);
+    int (*fetch_batch)(struct BoltConnection * connection, bolt_request_t request_id, struct BoltValue ** values,
+                       int max);
+    struct BoltValue * (*record_field)(struct BoltConnection * connection, int32_t index);
+    int (*skip_records)(struct BoltConnection * connection, bolt_request_t request_id);
+    struct BoltValue * (*data)(struct BoltConnection * connection);
+    bolt_request_t (*last_request)(struct BoltConnection * connection);
+
+    int (*load_init_request)(struct BoltConnection * connection, const struct BoltUserProfile * profile);
+    int (*load_reset_request)(struct BoltConnection * connection);
+
+    int (*set_cypher_template)(struct BoltConnection * connection, const char * statement, size_t size);
+    int (*set_n_cypher_parameters)(struct BoltConnection * connection, int32_t size);
+    int (*set_cypher_parameter_key)(struct BoltConnection * connection, int32_t index, const char * key,
+                                    size_t key_size);
+    struct BoltValue * (*cypher_parameter_value)(struct BoltConnection * connection, int32_t index);
+
+    int (*load_bookmark)(struct BoltConnection * connection, const char * bookmark);
+    int (*load_tx_timeout)(struct BoltConnection * connection, int64_t timeout);
+    struct BoltValue * (*load_tx_metadata)(struct BoltConnection * connection, int32_t size);
+
+    int (*load_begin_request)(struct BoltConnection * connection);
+    int (*load_commit_request)(struct BoltConnection * connection);
+    int (*load_rollback_request)(struct BoltConnection * connection);
+    int (*load_run_request)(struct BoltConnection * connection);
+    int (*load_statement_run_request)(struct BoltConnection * connection, const struct BoltStatement * statement,
+                                      const struct BoltValue * parameters);
+    int (*begin_run_request)(struct BoltConnection * connection, const char * cypher, size_t cypher_size,
+                             int32_t n_parameters);
+    int (*end_run_request)(struct BoltConnection * connection);
+    int (*write_null)(struct BoltConnection * connection);
+    int (*write_boolean)(struct BoltConnection * connection, int value);
+    int (*write_integer)(struct BoltConnection * connection, int64_t value);
+    int (*write_float)(struct BoltConnection * connection, double value);
+    int (*write_string)(struct BoltConnection * connection, const char * data, int32_t size);
+    int (*write_bytes)(struct BoltConnection * connection, const char * data, int32_t size);
+    int (*write_list)(struct BoltConnection * connection, int32_t size);
+    int (*write_map)(struct BoltConnection * connection, int32_t size);
+    int (*load_discard_request)(struct BoltConnection * connection, int32_t n);
+    int (*load_pull_request)(struct BoltConnection * connection, int32_t n);
+
+    int32_t (*n_fields)(struct BoltConnection * connection);
+    const char * (*field_name)(struct BoltConnection * connection, int32_t index);
+    int32_t (*field_name_size)(struct BoltConnection * connection, int32_t index);
+    int (*dump_field_names)(struct BoltConnection * connection, struct BoltBuffer * buffer);
+    int (*dump_data)(struct BoltConnection * connection, struct BoltBuffer * buffer);
+};
+
+/// Bolt v1: the original message set, with transactions run as Cypher statements
+extern const struct BoltProtocol BOLT_PROTOCOL_V1;
+
+/// Bolt v2: the v1 message set, with spatial and temporal structures
+extern const struct BoltProtocol BOLT_PROTOCOL_V2;
+
+/// Bolt v3: HELLO and native BEGIN, COMMIT and ROLLBACK, with transaction metadata
+extern const struct BoltProtocol BOLT_PROTOCOL_V3;
+
+/**
+ * Look up the operations of a protocol version.
+ *
+ * @param version
+ * @return the protocol, or NULL if the version is not supported
+ */
+const struct BoltProtocol * BoltProtocol_find(int32_t version);
+
+
+#endif // SEABOLT_PROTOCOL
@@ -25,6 +25,7 @@
 #include "bolt/buffering.h"
 #include "bolt/logging.h"
 #include "bolt/mem.h"
+#include "protocol.h"
 #include "v1.h"
 
 #define INIT        0x01
@@ -35,13 +36,14 @@
 #define PULL_ALL    0x3F
 
 #define INITIAL_TX_BUFFER_SIZE 8192
-#define INITIAL_RX_BUFFER_SIZE 8192
 
 #define MAX_BOOKMARK_SIZE 40
 #define MAX_SERVER_SIZE 200
 
 #define MAX_LOGGED_RECORDS 3
 
+#define MAX_CHUNK_SIZE 0xFFFF
+
 #define char_to_uint16be(array) ((uint8_t)(header[0]) << 8) | (uint8_t)(header[1]);
 
 #define TRY(code) { int status = (code); if (status == -1) { return status; } }
@@ -83,6 +85,7 @@ void compile_RUN(struct _run_request * run, int32_t n_parameters)
     run->statement = BoltMessage_value(run->request, 0);
     run->parameters = BoltMessage_value(run->request, 1);
     BoltValue_to_Dictionary(run->parameters, n_parameters);
+    run->metadata = NULL;
 }
 
 struct BoltProtocolV1State* BoltProtocolV1_create_state()
@@ -90,7 +93,11 @@ struct BoltProtocolV1State* BoltProtocolV1_create_state()
     struct BoltProtocolV1State* state = BoltMem_allocate(sizeof(struct BoltProtocolV1State));
 
     state->tx_buffer = BoltBuffer_create(INITIAL_TX_BUFFER_SIZE);
-    state->rx_buffer = BoltBuffer_create(INITIAL_RX_BUFFER_SIZE);
+    state->write_offset = -1;
+    state->write_remaining = 0;
+    state->chunk_remaining = 0;
+    state->scratch = NULL;
+    state->scratch_size = 0;
 
     state->server = BoltMem_allocate(MAX_SERVER_SIZE);
     memset(state->server, 0, MAX_SERVER_SIZE);
@@ -119,6 +126,21 @@ struct BoltProtocolV1State* BoltProtocolV1_create_state()
     BoltValue_to_Message(state->reset_request, RESET, 0);
 
     state->data = BoltValue_create();
+
+    state->record = NULL;
+    state->record_held = 0;
+    state->message_start = -1;
+    state->record_offsets = NULL;
+    state->record_decoded = NULL;
+    state->record_capacity = 0;
+    state->record_size = -1;
+
+    state->retained = NULL;
+    state->retained_messages = NULL;
+    state->retained_first = 0;
+    state->retained_count = 0;
+    state->retained_capacity = 0;
+    state->retained_bytes = 0;
     return state;
 }
 
@@ -127,7 +149,7 @@ void BoltProtocolV1_destroy_state(struct BoltProtocolV1State* state)
     if (state == NULL) return;
 
     BoltBuffer_destroy(state->tx_buffer);
-    BoltBuffer_destroy(state->rx_buffer);
+    BoltMem_deallocate(state->scratch, (size_t)(state->scratch_size));
 
     BoltValue_destroy(state->run.request);
     BoltValue_destroy(state->begin.request);
@@ -145,6 +167,19 @@ void BoltProtocolV1_destroy_state(struct BoltProtocolV1State* state)
 
     BoltValue_destroy(state->data);
 
+    if (state->record != NULL)
+    {
+        BoltBuffer_destroy(state->record);
+    }
+    BoltMem_deallocate(state->record_offsets, (size_t)(state->record_capacity) * sizeof(int32_t));
+    BoltMem_deallocate(state->record_decoded, (size_t)(state->record_capacity));
+
+    if (state->retained != NULL)
+    {
+        BoltBuffer_destroy(state->retained);
+    }
+    BoltMem_deallocate(state->retained_messages, sizeof_n(struct _retained_message, state->retained_capacity));
+
     BoltMem_deallocate(state, sizeof(struct BoltProtocolV1State));
 }
 
@@ -153,6 +188,47 @@ struct BoltProtocolV1State* BoltProtocolV1_state(struct BoltConnection* connecti
     return (struct BoltProtocolV1State*)(connection->protocol_state);
 }
 
+void BoltProtocolV1_attach(struct BoltConnection * connection)
+{
+    connection->protocol_state = BoltProtocolV1_create_state();
+}
+
+void BoltProtocolV1_detach(struct BoltConnection * connection)
+{
+    BoltProtocolV1_destroy_state(connection->protocol_state);
+    connection->protocol_state = NULL;
+}
+
+/**
+ * Decode any fields of a lazily fetched record that have not yet been
+ * accessed, leaving the data holder fully decoded.
+ *
+ * @param connection
+ * @return 0 on success, -1 on error
+ */
+int complete_record(struct BoltConnection * connection);
+
+struct BoltValue * BoltProtocolV1_data(struct BoltConnection * connection)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    // Only fields accessed through BoltProtocolV1_record_field are decoded lazily
+    if (state->record_size != -1 && complete_record(connection) == -1)
+    {
+        return NULL;
+    }
+    return state->data;
+}
+
+bolt_request_t BoltProtocolV1_last_request(struct BoltConnection * connection)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    if (state == NULL)
+    {
+        return 0;
+    }
+    return state->next_request_id - 1;
+}
+
 enum BoltProtocolV1Type marker_type(uint8_t marker)
 {
     if (marker < 0x80 || (marker >= 0xC8 && marker <= 0xCB) || marker >= 0xF0)
@@ -196,11 +272,13 @@ enum BoltProtocolV1Type marker_type(uint8_t marker)
 int load(struct BoltBuffer * buffer, struct BoltValue * value);
 
 /**
- * Copy request data from buffer 1 to buffer 0, also adding chunks.
+ * Queue an encoded message for transmission, wrapped in chunk framing.
  *
  * @param connection
+ * @param offset position of the encoded message within the protocol transmit buffer
+ * @return 0 on success, -1 if the queue could not be transmitted as required by the flush policy
  */
-void enqueue(struct BoltConnection * connection);
+int enqueue(struct BoltConnection * connection, int offset);
 
 int load_null(struct BoltBuffer * buffer)
 {
@@ -404,13 +482,23 @@ int load_message(struct BoltConnection * connection, struct BoltValue * value)
 {
     assert(BoltValue_type(value) == BOLT_MESSAGE);
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-    TRY(load_structure_header(state->tx_buffer, BoltMessage_code(value), value->size));
-    for (int32_t i = 0; i < value->size; i++)
+    if (state->write_offset >= 0 || BoltConnection_reclaim_b(connection) == -1)
     {
-        TRY(load(state->tx_buffer, BoltMessage_value(value, i)));
+        return -1;
     }
-    enqueue(connection);
-    return 0;
+    int offset = state->tx_buffer->extent;
+    int loaded = load_structure_header(state->tx_buffer, BoltMessage_code(value), value->size);
+    for (int32_t i = 0; loaded == 0 && i < value->size; i++)
+    {
+        loaded = load(state->tx_buffer, BoltMessage_value(value, i));
+    }
+    if (loaded != 0)
+    {
+        // Discard the partially encoded message
+        state->tx_buffer->extent = offset;
+        return loaded;
+    }
+    return enqueue(connection, offset);
 }
 
 int BoltProtocolV1_load_message(struct BoltConnection * connection, struct BoltValue * value)
@@ -545,35 +633,154 @@ int load(struct BoltBuffer * buffer, struct BoltValue * value)
 }
 
 /**
- * Copy request data from buffer 1 to buffer 0, also adding chunks.
+ * Queue an encoded message for transmission, wrapped in chunk framing.
+ *
+ * Only chunk headers and the end marker are written to the connection
+ * transmit buffer; the encoded message is split into chunks of at most
+ * MAX_CHUNK_SIZE bytes and transmitted directly from the protocol
+ * transmit buffer.
  *
  * @param connection
- * @return request ID
+ * @param offset position of the encoded message within the protocol transmit buffer
+ * @return 0 on success, -1 if the queue could not be transmitted as required by the flush policy
  */
-void enqueue(struct BoltConnection * connection)
+int enqueue(struct BoltConnection * connection, int offset)
 {
-    // TODO: more chunks if size is too big
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-    int size = BoltBuffer_unloadable(state->tx_buffer);
-    char header[2];
-    header[0] = (char)(size >> 8);
-    header[1] = (char)(size);
-    BoltBuffer_load(connection->tx_buffer, &header[0], sizeof(header));
-    BoltBuffer_load(connection->tx_buffer, BoltBuffer_unload_target(state->tx_buffer, size), size);
-    header[0] = (char)(0);
-    header[1] = (char)(0);
-    BoltBuffer_load(connection->tx_buffer, &header[0], sizeof(header));
-    BoltBuffer_compact(state->tx_buffer);
+    int end = state->tx_buffer->extent;
+    while (offset < end)
+    {
+        int size = end - offset < MAX_CHUNK_SIZE ? end - offset : MAX_CHUNK_SIZE;
+        int header_offset = connection->tx_buffer->extent;
+        char * header = BoltBuffer_load_target(connection->tx_buffer, 2);
+        header[0] = (char)(size >> 8);
+        header[1] = (char)(size);
+        BoltConnection_queue(connection, connection->tx_buffer, header_offset, 2);
+        BoltConnection_queue(connection, state->tx_buffer, offset, size);
+        offset += size;
+    }
+    int marker_offset = connection->tx_buffer->extent;
+    char * marker = BoltBuffer_load_target(connection->tx_buffer, 2);
+    marker[0] = (char)(0);
+    marker[1] = (char)(0);
+    BoltConnection_queue(connection, connection->tx_buffer, marker_offset, 2);
     state->next_request_id += 1;
+    return BoltConnection_loaded(connection);
+}
+
+/**
+ * Move on to the next chunk of the message being decoded if the current
+ * chunk has been fully consumed.
+ *
+ * @param connection
+ * @return 0 on success, -1 if the end of the message has been reached
+ */
+int next_chunk(struct BoltConnection * connection)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct BoltBuffer * buffer = connection->rx_buffer;
+    while (state->chunk_remaining == 0)
+    {
+        if (BoltBuffer_unloadable(buffer) < 2)
+        {
+            return -1;
+        }
+        char * header = &buffer->data[buffer->cursor];
+        uint16_t chunk_size = char_to_uint16be(header);
+        if (chunk_size == 0)
+        {
+            // Leave the end marker in place for end_message
+            return -1;
+        }
+        buffer->cursor += 2;
+        state->chunk_remaining = chunk_size;
+    }
+    return 0;
+}
+
+/**
+ * Copy raw bytes of the message being decoded directly out of the
+ * receive buffer, following the message across chunk boundaries.
+ *
+ * @param connection
+ * @param data
+ * @param size
+ * @return 0 on success, -1 if the message is too short
+ */
+int unload_raw(struct BoltConnection * connection, char * data, int size)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    while (size > 0)
+    {
+        TRY(next_chunk(connection));
+        int n = size < state->chunk_remaining ? size : state->chunk_remaining;
+        BoltBuffer_unload(connection->rx_buffer, data, n);
+        state->chunk_remaining -= n;
+        data += n;
+        size -= n;
+    }
+    return 0;
+}
+
+/**
+ * Unload a big-endian number from the message being decoded. Numbers
+ * that lie wholly within a chunk are read in place.
+ *
+ * @param connection
+ * @param x
+ * @param size
+ * @return 0 on success, -1 if the message is too short
+ */
+int unload_be(struct BoltConnection * connection, void * x, int size)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    TRY(next_chunk(connection));
+    if (state->chunk_remaining >= size)
+    {
+        struct BoltBuffer * buffer = connection->rx_buffer;
+        memcpy_be(x, &buffer->data[buffer->cursor], (size_t)(size));
+        buffer->cursor += size;
+        state->chunk_remaining -= size;
+        return 0;
+    }
+    char data[8];
+    TRY(unload_raw(connection, &data[0], size));
+    memcpy_be(x, &data[0], (size_t)(size));
+    return 0;
+}
+
+int peek_marker(struct BoltConnection * connection, uint8_t * marker)
+{
+    TRY(next_chunk(connection));
+    BoltBuffer_peek_uint8(connection->rx_buffer, marker);
+    return 0;
+}
+
+/**
+ * Discard any undecoded remainder of the current message, including
+ * its end marker.
+ *
+ * @param connection
+ */
+void end_message(struct BoltConnection * connection)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct BoltBuffer * buffer = connection->rx_buffer;
+    do
+    {
+        BoltBuffer_unload_target(buffer, state->chunk_remaining);
+        char header[2];
+        BoltBuffer_unload(buffer, &header[0], 2);
+        state->chunk_remaining = char_to_uint16be(header);
+    } while (state->chunk_remaining != 0);
 }
 
 int unload(struct BoltConnection * connection, struct BoltValue * value);
 
 int unload_null(struct BoltConnection * connection, struct BoltValue * value)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    TRY(unload_be(connection, &marker, sizeof(marker)));
     if (marker == 0xC0)
     {
         BoltValue_to_Null(value);
@@ -587,9 +794,8 @@ int unload_null(struct BoltConnection * connection, struct BoltValue * value)
 
 int unload_boolean(struct BoltConnection * connection, struct BoltValue * value)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    TRY(unload_be(connection, &marker, sizeof(marker)));
     if (marker == 0xC3)
     {
         BoltValue_to_Bit(value, 1);
@@ -607,9 +813,8 @@ int unload_boolean(struct BoltConnection * connection, struct BoltValue * value)
 
 int unload_integer(struct BoltConnection * connection, struct BoltValue * value)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    TRY(unload_be(connection, &marker, sizeof(marker)));
     if (marker < 0x80)
     {
         BoltValue_to_Int64(value, marker);
@@ -621,25 +826,25 @@ int unload_integer(struct BoltConnection * connection, struct BoltValue * value)
     else if (marker == 0xC8)
     {
         int8_t x;
-        BoltBuffer_unload_int8(state->rx_buffer, &x);
+        TRY(unload_be(connection, &x, sizeof(x)));
         BoltValue_to_Int64(value, x);
     }
     else if (marker == 0xC9)
     {
         int16_t x;
-        BoltBuffer_unload_int16_be(state->rx_buffer, &x);
+        TRY(unload_be(connection, &x, sizeof(x)));
         BoltValue_to_Int64(value, x);
     }
     else if (marker == 0xCA)
     {
         int32_t x;
-        BoltBuffer_unload_int32_be(state->rx_buffer, &x);
+        TRY(unload_be(connection, &x, sizeof(x)));
         BoltValue_to_Int64(value, x);
     }
     else if (marker == 0xCB)
     {
         int64_t x;
-        BoltBuffer_unload_int64_be(state->rx_buffer, &x);
+        TRY(unload_be(connection, &x, sizeof(x)));
         BoltValue_to_Int64(value, x);
     }
     else
@@ -651,13 +856,12 @@ int unload_integer(struct BoltConnection * connection, struct BoltValue * value)
 
 int unload_float(struct BoltConnection * connection, struct BoltValue * value)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    TRY(unload_be(connection, &marker, sizeof(marker)));
     if (marker == 0xC1)
     {
         double x;
-        BoltBuffer_unload_double_be(state->rx_buffer, &x);
+        TRY(unload_be(connection, &x, sizeof(x)));
         BoltValue_to_Float64(value, x);
     }
     else
@@ -669,39 +873,38 @@ int unload_float(struct BoltConnection * connection, struct BoltValue * value)
 
 int unload_string(struct BoltConnection * connection, struct BoltValue * value)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    TRY(unload_be(connection, &marker, sizeof(marker)));
     if (marker >= 0x80 && marker <= 0x8F)
     {
         int32_t size;
         size = marker & 0x0F;
         BoltValue_to_String(value, NULL, size);
-        BoltBuffer_unload(state->rx_buffer, BoltString_get(value), size);
+        TRY(unload_raw(connection, BoltString_get(value), size));
         return 0;
     }
     if (marker == 0xD0)
     {
         uint8_t size;
-        BoltBuffer_unload_uint8(state->rx_buffer, &size);
+        TRY(unload_be(connection, &size, sizeof(size)));
         BoltValue_to_String(value, NULL, size);
-        BoltBuffer_unload(state->rx_buffer, BoltString_get(value), size);
+        TRY(unload_raw(connection, BoltString_get(value), size));
         return 0;
     }
     if (marker == 0xD1)
     {
         uint16_t size;
-        BoltBuffer_unload_uint16_be(state->rx_buffer, &size);
+        TRY(unload_be(connection, &size, sizeof(size)));
         BoltValue_to_String(value, NULL, size);
-        BoltBuffer_unload(state->rx_buffer, BoltString_get(value), size);
+        TRY(unload_raw(connection, BoltString_get(value), size));
         return 0;
     }
     if (marker == 0xD2)
     {
         int32_t size;
-        BoltBuffer_unload_int32_be(state->rx_buffer, &size);
+        TRY(unload_be(connection, &size, sizeof(size)));
         BoltValue_to_String(value, NULL, size);
-        BoltBuffer_unload(state->rx_buffer, BoltString_get(value), size);
+        TRY(unload_raw(connection, BoltString_get(value), size));
         return 0;
     }
     BoltLog_error("bolt: Unknown marker: %d", marker);
@@ -710,31 +913,30 @@ int unload_string(struct BoltConnection * connection, struct BoltValue * value)
 
 int unload_bytes(struct BoltConnection * connection, struct BoltValue * value)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    TRY(unload_be(connection, &marker, sizeof(marker)));
     if (marker == 0xCC)
     {
         uint8_t size;
-        BoltBuffer_unload_uint8(state->rx_buffer, &size);
+        TRY(unload_be(connection, &size, sizeof(size)));
         BoltValue_to_ByteArray(value, NULL, size);
-        BoltBuffer_unload(state->rx_buffer, BoltByteArray_get_all(value), size);
+        TRY(unload_raw(connection, BoltByteArray_get_all(value), size));
         return 0;
     }
     if (marker == 0xCD)
     {
         uint16_t size;
-        BoltBuffer_unload_uint16_be(state->rx_buffer, &size);
+        TRY(unload_be(connection, &size, sizeof(size)));
         BoltValue_to_ByteArray(value, NULL, size);
-        BoltBuffer_unload(state->rx_buffer, BoltByteArray_get_all(value), size);
+        TRY(unload_raw(connection, BoltByteArray_get_all(value), size));
         return 0;
     }
     if (marker == 0xCE)
     {
         int32_t size;
-        BoltBuffer_unload_int32_be(state->rx_buffer, &size);
+        TRY(unload_be(connection, &size, sizeof(size)));
         BoltValue_to_ByteArray(value, NULL, size);
-        BoltBuffer_unload(state->rx_buffer, BoltByteArray_get_all(value), size);
+        TRY(unload_raw(connection, BoltByteArray_get_all(value), size));
         return 0;
     }
     BoltLog_error("bolt: Unknown marker: %d", marker);
@@ -743,10 +945,9 @@ int unload_bytes(struct BoltConnection * connection, struct BoltValue * value)
 
 int unload_list(struct BoltConnection * connection, struct BoltValue * value)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
     int32_t size;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    TRY(unload_be(connection, &marker, sizeof(marker)));
     if (marker >= 0x90 && marker <= 0x9F)
     {
         size = marker & 0x0F;
@@ -754,19 +955,19 @@ int unload_list(struct BoltConnection * connection, struct BoltValue * value)
     else if (marker == 0xD4)
     {
         uint8_t size_;
-        BoltBuffer_unload_uint8(state->rx_buffer, &size_);
+        TRY(unload_be(connection, &size_, sizeof(size_)));
         size = size_;
     }
     else if (marker == 0xD5)
     {
         uint16_t size_;
-        BoltBuffer_unload_uint16_be(state->rx_buffer, &size_);
+        TRY(unload_be(connection, &size_, sizeof(size_)));
         size = size_;
     }
     else if (marker == 0xD6)
     {
         int32_t size_;
-        BoltBuffer_unload_int32_be(state->rx_buffer, &size_);
+        TRY(unload_be(connection, &size_, sizeof(size_)));
         size = size_;
     }
     else
@@ -780,17 +981,16 @@ int unload_list(struct BoltConnection * connection, struct BoltValue * value)
     BoltValue_to_List(value, size);
     for (int i = 0; i < size; i++)
     {
-        unload(connection, BoltList_value(value, i));
+        TRY(unload(connection, BoltList_value(value, i)));
     }
     return size;
 }
 
 int unload_map(struct BoltConnection * connection, struct BoltValue * value)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
     int32_t size;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    TRY(unload_be(connection, &marker, sizeof(marker)));
     if (marker >= 0xA0 && marker <= 0xAF)
     {
         size = marker & 0x0F;
@@ -798,19 +998,19 @@ int unload_map(struct BoltConnection * connection, struct BoltValue * value)
     else if (marker == 0xD8)
     {
         uint8_t size_;
-        BoltBuffer_unload_uint8(state->rx_buffer, &size_);
+        TRY(unload_be(connection, &size_, sizeof(size_)));
         size = size_;
     }
     else if (marker == 0xD9)
     {
         uint16_t size_;
-        BoltBuffer_unload_uint16_be(state->rx_buffer, &size_);
+        TRY(unload_be(connection, &size_, sizeof(size_)));
         size = size_;
     }
     else if (marker == 0xDA)
     {
         int32_t size_;
-        BoltBuffer_unload_int32_be(state->rx_buffer, &size_);
+        TRY(unload_be(connection, &size_, sizeof(size_)));
         size = size_;
     }
     else
@@ -824,27 +1024,26 @@ int unload_map(struct BoltConnection * connection, struct BoltValue * value)
     BoltValue_to_Dictionary(value, size);
     for (int i = 0; i < size; i++)
     {
-        unload(connection, BoltDictionary_key(value, i));
-        unload(connection, BoltDictionary_value(value, i));
+        TRY(unload(connection, BoltDictionary_key(value, i)));
+        TRY(unload(connection, BoltDictionary_value(value, i)));
     }
     return size;
 }
 
 int unload_structure(struct BoltConnection * connection, struct BoltValue * value)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
     int8_t code;
     int32_t size;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
+    TRY(unload_be(connection, &marker, sizeof(marker)));
     if (marker >= 0xB0 && marker <= 0xBF)
     {
         size = marker & 0x0F;
-        BoltBuffer_unload_int8(state->rx_buffer, &code);
+        TRY(unload_be(connection, &code, sizeof(code)));
         BoltValue_to_Structure(value, code, size);
         for (int i = 0; i < size; i++)
         {
-            unload(connection, BoltStructure_value(value, i));
+            TRY(unload(connection, BoltStructure_value(value, i)));
         }
         return 0;
     }
@@ -854,9 +1053,8 @@ int unload_structure(struct BoltConnection * connection, struct BoltValue * valu
 
 int unload(struct BoltConnection * connection, struct BoltValue * value)
 {
-    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
     uint8_t marker;
-    BoltBuffer_peek_uint8(state->rx_buffer, &marker);
+    TRY(peek_marker(connection, &marker));
     switch(marker_type(marker))
     {
         case BOLT_V1_NULL:
@@ -883,136 +1081,1061 @@ int unload(struct BoltConnection * connection, struct BoltValue * value)
     }
 }
 
-int BoltProtocolV1_fetch_b(struct BoltConnection * connection, bolt_request_t request_id)
+/**
+ * Unload the size of a string, byte array, list or map that follows a
+ * marker with an explicit 8, 16 or 32-bit size.
+ *
+ * @param connection
+ * @param marker
+ * @param base the marker for an 8-bit size
+ * @param size
+ * @return 0 on success, -1 on error
+ */
+int unload_size(struct BoltConnection * connection, uint8_t marker, uint8_t base, int32_t * size)
 {
-    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
-    bolt_request_t response_id;
-    do
+    switch (marker - base)
     {
-        char header[2];
-        int fetched = BoltConnection_receive_b(connection, &header[0], 2);
-        if (fetched == -1)
+        case 0:
         {
-            BoltLog_error("bolt: Could not fetch chunk header");
-            return -1;
+            uint8_t size_;
+            TRY(unload_be(connection, &size_, sizeof(size_)));
+            *size = size_;
+            return 0;
         }
-        uint16_t chunk_size = char_to_uint16be(header);
-        BoltBuffer_compact(state->rx_buffer);
-        while (chunk_size != 0)
+        case 1:
         {
-            fetched = BoltConnection_receive_b(connection, BoltBuffer_load_target(state->rx_buffer, chunk_size),
-                                               chunk_size);
-            if (fetched == -1)
-            {
-                BoltLog_error("bolt: Could not fetch chunk data");
-                return -1;
-            }
-            fetched = BoltConnection_receive_b(connection, &header[0], 2);
-            if (fetched == -1)
-            {
-                BoltLog_error("bolt: Could not fetch chunk header");
-                return -1;
-            }
-            chunk_size = char_to_uint16be(header);
+            uint16_t size_;
+            TRY(unload_be(connection, &size_, sizeof(size_)));
+            *size = size_;
+            return 0;
         }
-        response_id = state->response_counter;
-        BoltProtocolV1_unload(connection);
-        if (BoltValue_type(state->data) == BOLT_MESSAGE)
+        case 2:
         {
-            state->response_counter += 1;
+            int32_t size_;
+            TRY(unload_be(connection, &size_, sizeof(size_)));
+            *size = size_;
+            return size_ < 0 ? -1 : 0;
         }
-    } while (response_id != request_id);
-    if (BoltValue_type(state->data) == BOLT_MESSAGE)
-    {
-        BoltProtocolV1_extract_metadata(connection, state->data);
-        return 0;
+        default:
+            return -1;  // BOLT_ERROR_WRONG_TYPE
     }
-    return 1;
 }
 
-int BoltProtocolV1_unload(struct BoltConnection* connection)
+/**
+ * Unload string or byte data without copying it where it lies wholly
+ * within a chunk, and otherwise gather it into the scratch buffer.
+ *
+ * @param connection
+ * @param size
+ * @param data set to the location of the data
+ * @return 0 on success, -1 if the message is too short
+ */
+int unload_in_place(struct BoltConnection * connection, int32_t size, const char ** data)
 {
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-    if (BoltBuffer_unloadable(state->rx_buffer) == 0)
+    if (size == 0)
     {
+        *data = "";
         return 0;
     }
-    uint8_t marker;
-    uint8_t code;
-    int32_t size;
-    BoltBuffer_unload_uint8(state->rx_buffer, &marker);
-    if (marker_type(marker) != BOLT_V1_STRUCTURE)
+    TRY(next_chunk(connection));
+    struct BoltBuffer * buffer = connection->rx_buffer;
+    if (state->chunk_remaining >= size)
     {
-        return -1;
+        *data = &buffer->data[buffer->cursor];
+        buffer->cursor += size;
+        state->chunk_remaining -= size;
+        return 0;
     }
-    size = marker & 0x0F;
-    struct BoltValue* received = ((struct BoltProtocolV1State*)(connection->protocol_state))->data;
-    BoltBuffer_unload_uint8(state->rx_buffer, &code);
-    if (code == BOLT_V1_RECORD)
+    if (state->scratch_size < size)
+    {
+        state->scratch = BoltMem_adjust(state->scratch, (size_t)(state->scratch_size), (size_t)(size));
+        state->scratch_size = size;
+    }
+    TRY(unload_raw(connection, state->scratch, size));
+    *data = state->scratch;
+    return 0;
+}
+
+/**
+ * Decode a value and pass it to the application through callbacks,
+ * without building a BoltValue.
+ *
+ * @param connection
+ * @param handlers
+ * @return 0 on success, -1 on error
+ */
+int stream(struct BoltConnection * connection, const struct BoltValueHandlers * handlers)
+{
+    uint8_t marker;
+    int32_t size;
+    TRY(unload_be(connection, &marker, sizeof(marker)));
+    switch (marker_type(marker))
     {
-        if (size >= 1)
+        case BOLT_V1_NULL:
+            if (handlers->on_null != NULL) handlers->on_null(handlers->context);
+            return 0;
+        case BOLT_V1_BOOLEAN:
+            if (handlers->on_boolean != NULL) handlers->on_boolean(handlers->context, marker == 0xC3);
+            return 0;
+        case BOLT_V1_INTEGER:
         {
-            unload(connection, received);
-            if (size > 1)
+            int64_t x;
+            if (marker < 0x80)
             {
-                struct BoltValue* black_hole = BoltValue_create();
-                for (int i = 1; i < size; i++)
-                {
-                    unload(connection, black_hole);
-                }
-                BoltValue_destroy(black_hole);
+                x = marker;
+            }
+            else if (marker >= 0xF0)
+            {
+                x = marker - 0x100;
+            }
+            else if (marker == 0xC8)
+            {
+                int8_t x_;
+                TRY(unload_be(connection, &x_, sizeof(x_)));
+                x = x_;
+            }
+            else if (marker == 0xC9)
+            {
+                int16_t x_;
+                TRY(unload_be(connection, &x_, sizeof(x_)));
+                x = x_;
+            }
+            else if (marker == 0xCA)
+            {
+                int32_t x_;
+                TRY(unload_be(connection, &x_, sizeof(x_)));
+                x = x_;
+            }
+            else
+            {
+                TRY(unload_be(connection, &x, sizeof(x)));
             }
+            if (handlers->on_integer != NULL) handlers->on_integer(handlers->context, x);
+            return 0;
         }
-        else
+        case BOLT_V1_FLOAT:
         {
-            BoltValue_to_Null(received);
+            double x;
+            TRY(unload_be(connection, &x, sizeof(x)));
+            if (handlers->on_float != NULL) handlers->on_float(handlers->context, x);
+            return 0;
         }
-        if (state->record_counter < MAX_LOGGED_RECORDS)
+        case BOLT_V1_STRING:
         {
-            BoltLog_message("S", state->response_counter, state->data, connection->protocol_version);
+            const char * data;
+            if (marker <= 0x8F)
+            {
+                size = marker & 0x0F;
+            }
+            else
+            {
+                TRY(unload_size(connection, marker, 0xD0, &size));
+            }
+            TRY(unload_in_place(connection, size, &data));
+            if (handlers->on_string != NULL) handlers->on_string(handlers->context, data, size);
+            return 0;
         }
-        state->record_counter += 1;
-    }
-    else /* Summary */
-    {
-        BoltValue_to_Message(received, code, size);
-        for (int i = 0; i < size; i++)
+        case BOLT_V1_BYTES:
         {
-            unload(connection, BoltMessage_value(received, i));
+            const char * data;
+            TRY(unload_size(connection, marker, 0xCC, &size));
+            TRY(unload_in_place(connection, size, &data));
+            if (handlers->on_bytes != NULL) handlers->on_bytes(handlers->context, data, size);
+            return 0;
         }
-        if (state->record_counter > MAX_LOGGED_RECORDS)
+        case BOLT_V1_LIST:
         {
-            BoltLog_info("bolt: S[%d]: Received %llu more records", state->response_counter, state->record_counter - MAX_LOGGED_RECORDS);
+            if (marker <= 0x9F)
+            {
+                size = marker & 0x0F;
+            }
+            else
+            {
+                TRY(unload_size(connection, marker, 0xD4, &size));
+            }
+            if (handlers->begin_list != NULL) handlers->begin_list(handlers->context, size);
+            for (int32_t i = 0; i < size; i++)
+            {
+                TRY(stream(connection, handlers));
+            }
+            if (handlers->end_list != NULL) handlers->end_list(handlers->context);
+            return 0;
         }
-        state->record_counter = 0;
-        BoltLog_message("S", state->response_counter, received, connection->protocol_version);
+        case BOLT_V1_MAP:
+        {
+            if (marker <= 0xAF)
+            {
+                size = marker & 0x0F;
+            }
+            else
+            {
+                TRY(unload_size(connection, marker, 0xD8, &size));
+            }
+            if (handlers->begin_map != NULL) handlers->begin_map(handlers->context, size);
+            for (int32_t i = 0; i < size; i++)
+            {
+                TRY(stream(connection, handlers));
+                TRY(stream(connection, handlers));
+            }
+            if (handlers->end_map != NULL) handlers->end_map(handlers->context);
+            return 0;
+        }
+        case BOLT_V1_STRUCTURE:
+        {
+            int8_t code;
+            if (marker > 0xBF)
+            {
+                // TODO: bigger structures (that are never actually used)
+                return -1;  // BOLT_ERROR_WRONG_TYPE
+            }
+            size = marker & 0x0F;
+            TRY(unload_be(connection, &code, sizeof(code)));
+            if (handlers->begin_structure != NULL) handlers->begin_structure(handlers->context, code, size);
+            for (int32_t i = 0; i < size; i++)
+            {
+                TRY(stream(connection, handlers));
+            }
+            if (handlers->end_structure != NULL) handlers->end_structure(handlers->context);
+            return 0;
+        }
+        default:
+            BoltLog_error("bolt: Unknown marker: %d", marker);
+            return -1;  // BOLT_UNSUPPORTED_MARKER
     }
-    return 1;
 }
 
-const char* BoltProtocolV1_structure_name(int16_t code)
+/**
+ * Scan the chunk headers buffered from the current position onwards
+ * to determine whether a complete message has been received.
+ *
+ * @param buffer
+ * @return 1 if a complete message is available, 0 otherwise
+ */
+int message_available(struct BoltBuffer * buffer)
 {
-    switch(code)
+    int cursor = buffer->cursor;
+    while (cursor + 2 <= buffer->extent)
     {
-        case 'N':
-            return "Node";
-        case 'R':
-            return "Relationship";
-        case 'r':
-            return "UnboundRelationship";
-        case 'P':
-            return "Path";
-        default:
-            return "?";
+        int chunk_size = ((uint8_t)(buffer->data[cursor]) << 8) | (uint8_t)(buffer->data[cursor + 1]);
+        cursor += 2;
+        if (chunk_size == 0)
+        {
+            return 1;
+        }
+        cursor += chunk_size;
     }
+    return 0;
 }
 
-const char* BoltProtocolV1_message_name(int16_t code)
+/**
+ * Determine whether the message buffered at the current position, which
+ * must already be known to be complete, is a record.
+ *
+ * @param buffer
+ * @return 1 if the message is a record, 0 otherwise
+ */
+int record_buffered(struct BoltBuffer * buffer)
 {
-    switch(code)
+    if (BoltBuffer_unloadable(buffer) < 4)
     {
-        case 0x01:
-            return "INIT";
+        return 0;
+    }
+    const char * header = &buffer->data[buffer->cursor];
+    uint16_t chunk_size = char_to_uint16be(header);
+    uint8_t marker = (uint8_t)(header[2]);
+    return chunk_size >= 2 && marker >= 0xB0 && marker <= 0xBF && header[3] == BOLT_V1_RECORD;
+}
+
+/**
+ * Determine whether a complete record message is buffered at the
+ * current position.
+ *
+ * @param buffer
+ * @return 1 if a complete record is available, 0 otherwise
+ */
+int record_available(struct BoltBuffer * buffer)
+{
+    return message_available(buffer) && record_buffered(buffer);
+}
+
+/**
+ * Pass over a complete message without decoding any of it, by
+ * following its chunk headers to the end marker.
+ *
+ * @param connection
+ */
+void skip_message(struct BoltConnection * connection)
+{
+    BoltProtocolV1_state(connection)->chunk_remaining = 0;
+    end_message(connection);
+}
+
+/**
+ * Copy the undecoded remainder of the current message out of the
+ * receive buffer, without its chunk headers.
+ *
+ * @param connection
+ * @param buffer
+ */
+void copy_message(struct BoltConnection * connection, struct BoltBuffer * buffer)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    while (next_chunk(connection) == 0)
+    {
+        int n = state->chunk_remaining;
+        BoltBuffer_unload(connection->rx_buffer, BoltBuffer_load_target(buffer, n), n);
+        state->chunk_remaining = 0;
+    }
+}
+
+/**
+ * Determine the number of bytes in the complete message buffered at the
+ * current position, excluding chunk headers.
+ *
+ * @param buffer
+ * @return the size of the message
+ */
+int message_size(struct BoltBuffer * buffer)
+{
+    int size = 0;
+    int cursor = buffer->cursor;
+    while (cursor + 2 <= buffer->extent)
+    {
+        int chunk_size = ((uint8_t)(buffer->data[cursor]) << 8) | (uint8_t)(buffer->data[cursor + 1]);
+        if (chunk_size == 0)
+        {
+            break;
+        }
+        size += chunk_size;
+        cursor += 2 + chunk_size;
+    }
+    return size;
+}
+
+/**
+ * Drop fetched messages from the queue once they take up more of the
+ * retained buffer than the messages still queued, moving the rest down
+ * to the start of the buffer. Without this, a single unfetched message
+ * would hold the space of every message queued after it.
+ *
+ * @param state
+ */
+void compact_retained(struct BoltProtocolV1State * state)
+{
+    if (state->retained == NULL || state->retained->extent - state->retained_bytes <= state->retained_bytes)
+    {
+        return;
+    }
+    int extent = 0;
+    int count = 0;
+    for (int i = state->retained_first; i < state->retained_count; i++)
+    {
+        struct _retained_message message = state->retained_messages[i];
+        if (message.size == -1)
+        {
+            continue;
+        }
+        memmove(&state->retained->data[extent], &state->retained->data[message.offset], (size_t)(message.size));
+        message.offset = extent;
+        extent += message.size;
+        state->retained_messages[count] = message;
+        count += 1;
+    }
+    state->retained->extent = extent;
+    state->retained_first = 0;
+    state->retained_count = count;
+}
+
+/**
+ * Queue the complete message buffered at the current position for a
+ * later fetch, or spill it if it would exceed the limit of the
+ * retention policy.
+ *
+ * @param connection
+ * @param request_id the request to which the message responds
+ * @return 0 on success, -1 if the message exceeds the limit and there
+ *         is no spill callback
+ */
+int retain_message(struct BoltConnection * connection, bolt_request_t request_id)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    const struct BoltRetentionPolicy * policy = &connection->retention_policy;
+    int size = message_size(connection->rx_buffer);
+    int spill = policy->max_bytes > 0 && size > policy->max_bytes - state->retained_bytes;
+    if (spill && policy->spill == NULL)
+    {
+        BoltLog_error("bolt: Retained responses would exceed %d bytes", policy->max_bytes);
+        return -1;
+    }
+    if (state->retained == NULL)
+    {
+        state->retained = BoltBuffer_create(MAX_CHUNK_SIZE);
+    }
+    compact_retained(state);
+    int offset = state->retained->extent;
+    state->chunk_remaining = 0;
+    copy_message(connection, state->retained);
+    end_message(connection);
+    if (spill)
+    {
+        policy->spill(policy->context, request_id, &state->retained->data[offset], size);
+        state->retained->extent = offset;
+        return 0;
+    }
+    if (state->retained_count == state->retained_capacity)
+    {
+        int capacity = state->retained_capacity < 16 ? 16 : 2 * state->retained_capacity;
+        state->retained_messages = BoltMem_adjust(state->retained_messages,
+                                                  sizeof_n(struct _retained_message, state->retained_capacity),
+                                                  sizeof_n(struct _retained_message, capacity));
+        state->retained_capacity = capacity;
+    }
+    struct _retained_message * message = &state->retained_messages[state->retained_count];
+    message->request_id = request_id;
+    message->offset = offset;
+    message->size = size;
+    state->retained_count += 1;
+    state->retained_bytes += size;
+    return 0;
+}
+
+/**
+ * Find the first queued message for a request.
+ *
+ * @param state
+ * @param request_id
+ * @return the index of the message, or -1 if none is queued
+ */
+int find_retained(struct BoltProtocolV1State * state, bolt_request_t request_id)
+{
+    for (int i = state->retained_first; i < state->retained_count; i++)
+    {
+        if (state->retained_messages[i].request_id == request_id && state->retained_messages[i].size != -1)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Remove a message from the queue once fetched, releasing the space
+ * taken by the queue once every message has been fetched.
+ *
+ * @param state
+ * @param index
+ */
+void release_retained(struct BoltProtocolV1State * state, int index)
+{
+    state->retained_bytes -= state->retained_messages[index].size;
+    state->retained_messages[index].size = -1;
+    while (state->retained_first < state->retained_count &&
+           state->retained_messages[state->retained_first].size == -1)
+    {
+        state->retained_first += 1;
+    }
+    if (state->retained_first == state->retained_count)
+    {
+        state->retained_first = 0;
+        state->retained_count = 0;
+        state->retained->extent = 0;
+    }
+}
+
+/**
+ * Determine whether a queued message is a record.
+ *
+ * @param state
+ * @param index
+ * @return 1 if the message is a record, 0 otherwise
+ */
+int retained_record(struct BoltProtocolV1State * state, int index)
+{
+    const struct _retained_message * message = &state->retained_messages[index];
+    const char * data = &state->retained->data[message->offset];
+    uint8_t marker = (uint8_t)(data[0]);
+    return message->size >= 2 && marker >= 0xB0 && marker <= 0xBF && data[1] == BOLT_V1_RECORD;
+}
+
+/**
+ * Fetch a queued message, decoding it from the retained buffer in place
+ * of the receive buffer.
+ *
+ * @param connection
+ * @param index
+ * @return 1 if record data is fetched, 0 if summary metadata is fetched,
+ *         -1 on error
+ */
+int fetch_retained(struct BoltConnection * connection, int index)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    const struct _retained_message * message = &state->retained_messages[index];
+    // A view of just this message, so that decoding cannot run past it
+    struct BoltBuffer view = *state->retained;
+    view.cursor = message->offset;
+    view.extent = message->offset + message->size;
+    struct BoltBuffer * rx_buffer = connection->rx_buffer;
+    connection->rx_buffer = &view;
+    state->chunk_remaining = message->size;
+    int unloaded = BoltProtocolV1_unload(connection);
+    connection->rx_buffer = rx_buffer;
+    state->chunk_remaining = 0;
+    release_retained(state, index);
+    if (unloaded == -1)
+    {
+        return -1;
+    }
+    if (BoltValue_type(state->data) == BOLT_MESSAGE)
+    {
+        BoltProtocolV1_extract_metadata(connection, state->data);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Pass over a lazily fetched record held unread in the receive buffer,
+ * leaving any of its fields not yet accessed undecoded.
+ *
+ * @param connection
+ */
+void release_record(struct BoltConnection * connection)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    if (state->record_held > 0)
+    {
+        connection->rx_buffer->cursor += state->record_held;
+        state->record_held = 0;
+    }
+    state->record_size = -1;
+}
+
+int BoltProtocolV1_fetch(struct BoltConnection * connection, bolt_request_t request_id)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    release_record(connection);
+    if (state->retained_count > 0)
+    {
+        int index = find_retained(state, request_id);
+        if (index != -1)
+        {
+            return fetch_retained(connection, index);
+        }
+    }
+    if (request_id < state->response_counter)
+    {
+        // The response has already been passed over, or spilled
+        BoltLog_error("bolt: No response remains for request %llu", request_id);
+        return -1;
+    }
+    bolt_request_t response_id;
+    do
+    {
+        if (!message_available(connection->rx_buffer))
+        {
+            return BOLT_WAITING;
+        }
+        response_id = state->response_counter;
+        if (response_id != request_id && connection->retention_policy.retain)
+        {
+            int record = record_buffered(connection->rx_buffer);
+            if (retain_message(connection, response_id) == -1)
+            {
+                return -1;
+            }
+            if (!record)
+            {
+                state->response_counter += 1;
+            }
+            continue;
+        }
+        if (response_id != request_id && record_buffered(connection->rx_buffer))
+        {
+            // Records of earlier responses are dropped without decoding
+            skip_message(connection);
+            state->record_counter += 1;
+            continue;
+        }
+        state->chunk_remaining = 0;
+        state->message_start = connection->rx_buffer->cursor;
+        int unloaded = BoltProtocolV1_unload(connection);
+        state->message_start = -1;
+        if (state->record_held == 0)
+        {
+            end_message(connection);
+        }
+        if (unloaded == -1)
+        {
+            return -1;
+        }
+        if (BoltValue_type(state->data) == BOLT_MESSAGE)
+        {
+            state->response_counter += 1;
+        }
+    } while (response_id != request_id);
+    if (BoltValue_type(state->data) == BOLT_MESSAGE)
+    {
+        BoltProtocolV1_extract_metadata(connection, state->data);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Read a big-endian size of 1, 2 or 4 bytes from a flat sequence of bytes.
+ *
+ * @param data
+ * @param width
+ * @return the size, or -1 if negative
+ */
+int64_t flat_size(const char * data, int width)
+{
+    int64_t size = 0;
+    for (int i = 0; i < width; i++)
+    {
+        size = (size << 8) | (uint8_t)(data[i]);
+    }
+    return width == 4 && size > INT32_MAX ? -1 : size;
+}
+
+/**
+ * Find the end of a value encoded within a flat sequence of bytes,
+ * without decoding it. Containers are walked iteratively by counting
+ * the values still to be passed over.
+ *
+ * @param data
+ * @param size number of bytes in the sequence
+ * @param offset position of the value
+ * @return the position following the value, or -1 if the value is
+ *         malformed or overruns the sequence
+ */
+int skip_flat(const char * data, int size, int offset)
+{
+    int64_t pending = 1;
+    while (pending > 0)
+    {
+        if (offset >= size)
+        {
+            return -1;
+        }
+        uint8_t marker = (uint8_t)(data[offset]);
+        int width = 0;
+        int64_t length = 0;
+        int64_t items = 0;
+        switch (marker_type(marker))
+        {
+            case BOLT_V1_NULL:
+            case BOLT_V1_BOOLEAN:
+                break;
+            case BOLT_V1_INTEGER:
+                length = marker >= 0xC8 && marker <= 0xCB ? 1 << (marker - 0xC8) : 0;
+                break;
+            case BOLT_V1_FLOAT:
+                length = 8;
+                break;
+            case BOLT_V1_STRING:
+                width = marker >= 0xD0 ? 1 << (marker - 0xD0) : 0;
+                break;
+            case BOLT_V1_BYTES:
+                width = 1 << (marker - 0xCC);
+                break;
+            case BOLT_V1_LIST:
+                width = marker >= 0xD4 ? 1 << (marker - 0xD4) : 0;
+                break;
+            case BOLT_V1_MAP:
+                width = marker >= 0xD8 ? 1 << (marker - 0xD8) : 0;
+                break;
+            case BOLT_V1_STRUCTURE:
+                width = marker >= 0xDC ? 1 << (marker - 0xDC) : 0;
+                length = 1;     // signature
+                break;
+            default:
+                return -1;
+        }
+        offset += 1;
+        int64_t count = marker & 0x0F;
+        if (width > 0)
+        {
+            if (offset + width > size)
+            {
+                return -1;
+            }
+            count = flat_size(&data[offset], width);
+            if (count < 0)
+            {
+                return -1;
+            }
+            offset += width;
+        }
+        switch (marker_type(marker))
+        {
+            case BOLT_V1_STRING:
+            case BOLT_V1_BYTES:
+                length = count;
+                break;
+            case BOLT_V1_LIST:
+            case BOLT_V1_STRUCTURE:
+                items = count;
+                break;
+            case BOLT_V1_MAP:
+                items = 2 * count;
+                break;
+            default:
+                break;
+        }
+        if (length > size - offset)
+        {
+            return -1;
+        }
+        offset += (int)(length);
+        pending += items - 1;
+    }
+    return offset;
+}
+
+/**
+ * Index the fields of the record list in the remainder of a record
+ * message without decoding them, so that each can be decoded on first
+ * access. The value is turned into a list of nulls, one per field.
+ *
+ * A record fetched in a single chunk is indexed in place, and held
+ * unread in the receive buffer until it is released by the next fetch.
+ * A record spanning several chunks is first copied out of the receive
+ * buffer, without its chunk headers.
+ *
+ * @param connection
+ * @param value destination for the record values
+ * @return 0 on success, -1 on error
+ */
+int index_record(struct BoltConnection * connection, struct BoltValue * value)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct BoltBuffer * rx_buffer = connection->rx_buffer;
+    const char * data;
+    int size;
+    // Offset of the record list from the start of the held or copied bytes
+    int base;
+    int end = rx_buffer->cursor + state->chunk_remaining;
+    if (state->message_start >= 0 && rx_buffer->cursor == state->message_start + 4 &&
+        end + 2 <= rx_buffer->extent && rx_buffer->data[end] == 0 && rx_buffer->data[end + 1] == 0)
+    {
+        // The chunk header, structure marker and signature precede the list
+        data = &rx_buffer->data[rx_buffer->cursor];
+        size = state->chunk_remaining;
+        base = 4;
+        state->record_held = end + 2 - state->message_start;
+        rx_buffer->cursor = state->message_start;
+        state->chunk_remaining = 0;
+    }
+    else
+    {
+        if (state->record == NULL)
+        {
+            state->record = BoltBuffer_create(MAX_CHUNK_SIZE);
+        }
+        struct BoltBuffer * record = state->record;
+        record->cursor = 0;
+        record->extent = 0;
+        copy_message(connection, record);
+        data = record->data;
+        size = record->extent;
+        base = 0;
+        state->record_held = 0;
+    }
+    if (size < 1 || marker_type((uint8_t)(data[0])) != BOLT_V1_LIST)
+    {
+        return -1;
+    }
+    uint8_t marker = (uint8_t)(data[0]);
+    int offset = 1;
+    int64_t n_fields = marker & 0x0F;
+    if (marker >= 0xD4)
+    {
+        int width = 1 << (marker - 0xD4);
+        if (offset + width > size)
+        {
+            return -1;
+        }
+        n_fields = flat_size(&data[offset], width);
+        offset += width;
+    }
+    if (n_fields < 0 || n_fields > size)
+    {
+        return -1;
+    }
+    if (state->record_capacity < n_fields + 1)
+    {
+        state->record_offsets = BoltMem_adjust(state->record_offsets,
+                                               (size_t)(state->record_capacity) * sizeof(int32_t),
+                                               (size_t)(n_fields + 1) * sizeof(int32_t));
+        state->record_decoded = BoltMem_adjust(state->record_decoded, (size_t)(state->record_capacity),
+                                               (size_t)(n_fields + 1));
+        state->record_capacity = (int32_t)(n_fields + 1);
+    }
+    for (int32_t i = 0; i < n_fields; i++)
+    {
+        state->record_offsets[i] = base + offset;
+        state->record_decoded[i] = 0;
+        offset = skip_flat(data, size, offset);
+        if (offset == -1)
+        {
+            return -1;
+        }
+    }
+    state->record_offsets[n_fields] = base + offset;
+    BoltValue_to_List(value, (int32_t)(n_fields));
+    state->record_size = (int32_t)(n_fields);
+    return 0;
+}
+
+/**
+ * Decode a field of the record last fetched lazily, by pointing the
+ * decoder at the indexed bytes of that field, either within the receive
+ * buffer or within the copied record.
+ *
+ * @param connection
+ * @param index
+ * @param value
+ * @return 0 on success, -1 on error
+ */
+int unload_field(struct BoltConnection * connection, int32_t index, struct BoltValue * value)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    struct BoltBuffer * rx_buffer = connection->rx_buffer;
+    int cursor = rx_buffer->cursor;
+    int chunk_remaining = state->chunk_remaining;
+    state->chunk_remaining = state->record_offsets[index + 1] - state->record_offsets[index];
+    if (state->record_held > 0)
+    {
+        // The held record starts at the cursor of the receive buffer
+        rx_buffer->cursor = cursor + state->record_offsets[index];
+    }
+    else
+    {
+        state->record->cursor = state->record_offsets[index];
+        connection->rx_buffer = state->record;
+    }
+    int unloaded = unload(connection, value);
+    connection->rx_buffer = rx_buffer;
+    rx_buffer->cursor = cursor;
+    state->chunk_remaining = chunk_remaining;
+    return unloaded;
+}
+
+/**
+ * Decode any fields of a lazily fetched record that have not yet been
+ * accessed, leaving the data holder fully decoded.
+ *
+ * @param connection
+ * @return 0 on success, -1 on error
+ */
+int complete_record(struct BoltConnection * connection)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    for (int32_t i = 0; i < state->record_size; i++)
+    {
+        if (!state->record_decoded[i])
+        {
+            TRY(unload_field(connection, i, BoltList_value(state->data, i)));
+            state->record_decoded[i] = 1;
+        }
+    }
+    release_record(connection);
+    return 0;
+}
+
+/**
+ * Unload the first field of a record message, once its marker and
+ * signature have been unloaded. Any further fields are left for
+ * end_message to pass over undecoded.
+ *
+ * @param connection
+ * @param value destination for the record values
+ * @param size number of fields in the record message
+ * @param lazy non-zero to index the record values for decoding on access
+ * @return 0 on success, -1 on error
+ */
+int unload_record(struct BoltConnection * connection, struct BoltValue * value, int32_t size, int lazy)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    const struct BoltValueHandlers * handlers = connection->record_handlers;
+    if (size >= 1)
+    {
+        if (handlers != NULL)
+        {
+            BoltValue_to_Null(value);
+            TRY(stream(connection, handlers));
+        }
+        else if (lazy)
+        {
+            // Any further fields of the message are held or copied but never indexed
+            TRY(index_record(connection, value));
+        }
+        else
+        {
+            TRY(unload(connection, value));
+        }
+    }
+    else
+    {
+        BoltValue_to_Null(value);
+    }
+    if (state->record_counter < MAX_LOGGED_RECORDS && handlers == NULL && !lazy)
+    {
+        BoltLog_message("S", state->response_counter, value, connection->protocol_version);
+    }
+    state->record_counter += 1;
+    return 0;
+}
+
+int BoltProtocolV1_skip_records(struct BoltConnection * connection, bolt_request_t request_id)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    release_record(connection);
+    int n = 0;
+    int index;
+    while (state->retained_count > 0 && (index = find_retained(state, request_id)) != -1 &&
+           retained_record(state, index))
+    {
+        release_retained(state, index);
+        n += 1;
+    }
+    while (state->response_counter == request_id && record_available(connection->rx_buffer))
+    {
+        skip_message(connection);
+        n += 1;
+    }
+    state->record_counter += n;
+    return n;
+}
+
+/**
+ * Determine whether the next message of a response is a record that can
+ * be fetched without waiting, either from the queue of retained messages
+ * or from the receive buffer.
+ *
+ * @param connection
+ * @param request_id
+ * @return 1 if a record is ready, 0 otherwise
+ */
+int record_ready(struct BoltConnection * connection, bolt_request_t request_id)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    if (state->retained_count > 0)
+    {
+        int index = find_retained(state, request_id);
+        if (index != -1)
+        {
+            return retained_record(state, index);
+        }
+    }
+    return state->response_counter == request_id && record_available(connection->rx_buffer);
+}
+
+int BoltProtocolV1_fetch_batch(struct BoltConnection * connection, bolt_request_t request_id,
+                               struct BoltValue ** values, int max)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    int n = 0;
+    do
+    {
+        if (n > 0 && BoltProtocolV1_fetch(connection, request_id) != 1)
+        {
+            return -1;
+        }
+        // The index of a lazily fetched record does not move with it, so
+        // records of a batch are decoded in full
+        TRY(complete_record(connection));
+        // The record just fetched is moved out of the data slot rather than copied
+        _exchange(values[n], state->data);
+        n += 1;
+    } while (n < max && record_ready(connection, request_id));
+    return n;
+}
+
+struct BoltValue * BoltProtocolV1_record_field(struct BoltConnection * connection, int32_t index)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    if (BoltValue_type(state->data) != BOLT_LIST || index < 0 || index >= state->data->size)
+    {
+        return NULL;
+    }
+    struct BoltValue * field = BoltList_value(state->data, index);
+    if (state->record_size != -1 && !state->record_decoded[index])
+    {
+        if (unload_field(connection, index, field) == -1)
+        {
+            return NULL;
+        }
+        state->record_decoded[index] = 1;
+    }
+    return field;
+}
+
+int BoltProtocolV1_unload(struct BoltConnection* connection)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (next_chunk(connection) == -1)
+    {
+        return 0;
+    }
+    uint8_t marker;
+    uint8_t code;
+    int32_t size;
+    state->record_size = -1;
+    TRY(unload_be(connection, &marker, sizeof(marker)));
+    if (marker_type(marker) != BOLT_V1_STRUCTURE)
+    {
+        return -1;
+    }
+    size = marker & 0x0F;
+    struct BoltValue* received = ((struct BoltProtocolV1State*)(connection->protocol_state))->data;
+    TRY(unload_be(connection, &code, sizeof(code)));
+    if (code == BOLT_V1_RECORD)
+    {
+        TRY(unload_record(connection, received, size, connection->lazy_records));
+    }
+    else /* Summary */
+    {
+        BoltValue_to_Message(received, code, size);
+        for (int i = 0; i < size; i++)
+        {
+            TRY(unload(connection, BoltMessage_value(received, i)));
+        }
+        if (state->record_counter > MAX_LOGGED_RECORDS)
+        {
+            BoltLog_info("bolt: S[%d]: Received %llu more records", state->response_counter, state->record_counter - MAX_LOGGED_RECORDS);
+        }
+        state->record_counter = 0;
+        BoltLog_message("S", state->response_counter, received, connection->protocol_version);
+    }
+    return 1;
+}
+
+const char* BoltProtocolV1_structure_name(int16_t code)
+{
+    switch(code)
+    {
+        case 'N':
+            return "Node";
+        case 'R':
+            return "Relationship";
+        case 'r':
+            return "UnboundRelationship";
+        case 'P':
+            return "Path";
+        default:
+            return "?";
+    }
+}
+
+const char* BoltProtocolV1_message_name(int16_t code)
+{
+    switch(code)
+    {
+        case 0x01:
+            return "INIT";
         case 0x0E:
             return "ACK_FAILURE";
         case 0x0F:
@@ -1034,7 +2157,7 @@ const char* BoltProtocolV1_message_name(int16_t code)
     }
 }
 
-int BoltProtocolV1_init_b(struct BoltConnection * connection, const struct BoltUserProfile * profile)
+int BoltProtocolV1_load_init_request(struct BoltConnection * connection, const struct BoltUserProfile * profile)
 {
     struct BoltUserProfile masked_profile;
     memcpy(&masked_profile, profile, sizeof(struct BoltUserProfile));
@@ -1044,22 +2167,21 @@ int BoltProtocolV1_init_b(struct BoltConnection * connection, const struct BoltU
     struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
     BoltLog_message("C", state->next_request_id, init, connection->protocol_version);
     BoltProtocolV1_compile_INIT(init, profile);
-    BoltProtocolV1_load_message_quietly(connection, init);
-    bolt_request_t init_request = BoltConnection_last_request(connection);
+    int loaded = BoltProtocolV1_load_message_quietly(connection, init);
     BoltValue_destroy(init);
-    TRY(BoltConnection_send_b(connection));
-    TRY(BoltConnection_fetch_summary_b(connection, init_request));
-    return BoltMessage_code(BoltConnection_data(connection));
+    return loaded;
 }
 
-int BoltProtocolV1_reset_b(struct BoltConnection * connection)
+int BoltProtocolV1_load_reset_request(struct BoltConnection * connection)
 {
     struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
-    BoltProtocolV1_load_message(connection, state->reset_request);
-    bolt_request_t reset_request = BoltConnection_last_request(connection);
-    TRY(BoltConnection_send_b(connection));
-    TRY(BoltConnection_fetch_summary_b(connection, reset_request));
-    return BoltMessage_code(BoltConnection_data(connection));
+    if (state->write_offset >= 0)
+    {
+        // A reset abandons any RUN message left partially written
+        state->tx_buffer->extent = state->write_offset;
+        state->write_offset = -1;
+    }
+    return BoltProtocolV1_load_message(connection, state->reset_request);
 }
 
 void BoltProtocolV1_extract_metadata(struct BoltConnection * connection, struct BoltValue * summary)
@@ -1208,35 +2330,259 @@ int BoltProtocolV1_load_bookmark(struct BoltConnection * connection, const char
 int BoltProtocolV1_load_begin_request(struct BoltConnection * connection)
 {
     struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
-    BoltProtocolV1_load_message(connection, state->begin.request);
+    int loaded = BoltProtocolV1_load_message(connection, state->begin.request);
     BoltValue_to_Dictionary(state->begin.parameters, 0);
-    BoltProtocolV1_load_message(connection, state->discard_request);
-    return 0;
+    TRY(loaded);
+    return BoltProtocolV1_load_message(connection, state->discard_request);
 }
 
 int BoltProtocolV1_load_commit_request(struct BoltConnection * connection)
 {
     struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
-    BoltProtocolV1_load_message(connection, state->commit.request);
-    BoltProtocolV1_load_message(connection, state->discard_request);
-    return 0;
+    TRY(BoltProtocolV1_load_message(connection, state->commit.request));
+    return BoltProtocolV1_load_message(connection, state->discard_request);
 }
 
 int BoltProtocolV1_load_rollback_request(struct BoltConnection * connection)
 {
     struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
-    BoltProtocolV1_load_message(connection, state->rollback.request);
-    BoltProtocolV1_load_message(connection, state->discard_request);
-    return 0;
+    TRY(BoltProtocolV1_load_message(connection, state->rollback.request));
+    return BoltProtocolV1_load_message(connection, state->discard_request);
 }
 
 int BoltProtocolV1_load_run_request(struct BoltConnection * connection)
 {
     struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
-    BoltProtocolV1_load_message(connection, state->run.request);
+    return BoltProtocolV1_load_message(connection, state->run.request);
+}
+
+int BoltProtocolV1_compile_statement(struct BoltBuffer * buffer, const char * cypher, int32_t size,
+                                     const char ** keys, int32_t n_keys, int32_t * offsets)
+{
+    TRY(load_string(buffer, cypher, size));
+    TRY(load_map_header(buffer, n_keys));
+    for (int32_t i = 0; i < n_keys; i++)
+    {
+        size_t key_size = strlen(keys[i]);
+        if (key_size > INT32_MAX)
+        {
+            return -1;
+        }
+        offsets[i] = buffer->extent;
+        TRY(load_string(buffer, keys[i], (int32_t)(key_size)));
+    }
+    offsets[n_keys] = buffer->extent;
+    return 0;
+}
+
+int BoltProtocolV1_load_statement(struct BoltConnection * connection, const struct BoltStatement * statement,
+                                  const struct BoltValue * parameters, struct BoltValue * metadata)
+{
+    int32_t n = statement->n_parameters;
+    if (parameters == NULL ? n != 0 : BoltValue_type(parameters) != BOLT_LIST || parameters->size != n)
+    {
+        return -1;
+    }
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (state->write_offset >= 0 || BoltConnection_reclaim_b(connection) == -1)
+    {
+        return -1;
+    }
+    BoltLog_info("bolt: C[%llu]: RUN <statement with %d parameters>", state->next_request_id, n);
+    struct BoltBuffer * buffer = state->tx_buffer;
+    const char * data = statement->data->data;
+    const int32_t * offsets = statement->key_offsets;
+    int offset = buffer->extent;
+    int loaded = load_structure_header(buffer, RUN, (int8_t)(metadata == NULL ? 2 : 3));
+    if (loaded == 0)
+    {
+        BoltBuffer_load(buffer, data, offsets[0]);
+    }
+    for (int32_t i = 0; loaded == 0 && i < n; i++)
+    {
+        BoltBuffer_load(buffer, &data[offsets[i]], offsets[i + 1] - offsets[i]);
+        loaded = load(buffer, BoltList_value(parameters, i));
+    }
+    if (loaded == 0 && metadata != NULL)
+    {
+        loaded = load(buffer, metadata);
+    }
+    if (loaded != 0)
+    {
+        // Discard the partially encoded message
+        buffer->extent = offset;
+        return -1;
+    }
+    return enqueue(connection, offset);
+}
+
+int BoltProtocolV1_load_statement_run_request(struct BoltConnection * connection,
+                                              const struct BoltStatement * statement,
+                                              const struct BoltValue * parameters)
+{
+    return BoltProtocolV1_load_statement(connection, statement, parameters, NULL);
+}
+
+int BoltProtocolV1_begin_run(struct BoltConnection * connection, const char * cypher, size_t cypher_size,
+                             int32_t n_parameters, int8_t n_fields)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (state->write_offset >= 0 || cypher_size > INT32_MAX || BoltConnection_reclaim_b(connection) == -1)
+    {
+        return -1;
+    }
+    BoltLog_info("bolt: C[%llu]: RUN \"%.*s\" <%d parameters written>", state->next_request_id, (int)(cypher_size),
+                 cypher, n_parameters);
+    struct BoltBuffer * buffer = state->tx_buffer;
+    int offset = buffer->extent;
+    int loaded = load_structure_header(buffer, RUN, n_fields);
+    if (loaded == 0)
+    {
+        loaded = load_string(buffer, cypher, (int32_t)(cypher_size));
+    }
+    if (loaded == 0)
+    {
+        loaded = load_map_header(buffer, n_parameters);
+    }
+    if (loaded != 0)
+    {
+        buffer->extent = offset;
+        return -1;
+    }
+    state->write_offset = offset;
+    state->write_remaining = 2 * (int64_t)(n_parameters);
+    return 0;
+}
+
+int BoltProtocolV1_end_run(struct BoltConnection * connection, struct BoltValue * metadata)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    int offset = state->write_offset;
+    if (offset < 0 || state->write_remaining != 0)
+    {
+        return -1;
+    }
+    state->write_offset = -1;
+    if (metadata != NULL && load(state->tx_buffer, metadata) != 0)
+    {
+        // Discard the encoded message
+        state->tx_buffer->extent = offset;
+        return -1;
+    }
+    return enqueue(connection, offset);
+}
+
+int BoltProtocolV1_begin_run_request(struct BoltConnection * connection, const char * cypher, size_t cypher_size,
+                                     int32_t n_parameters)
+{
+    return BoltProtocolV1_begin_run(connection, cypher, cypher_size, n_parameters, 2);
+}
+
+int BoltProtocolV1_end_run_request(struct BoltConnection * connection)
+{
+    return BoltProtocolV1_end_run(connection, NULL);
+}
+
+/**
+ * Obtain the buffer into which the next parameter value of the RUN
+ * message being written is encoded, accounting for that value and any
+ * values it contains.
+ *
+ * @param connection
+ * @param contents number of values contained by the value to be written
+ * @return the buffer, or NULL if no further values are expected
+ */
+struct BoltBuffer * write_target(struct BoltConnection * connection, int64_t contents)
+{
+    struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+    if (state->write_offset < 0 || state->write_remaining == 0 || contents < 0)
+    {
+        return NULL;
+    }
+    state->write_remaining += contents - 1;
+    return state->tx_buffer;
+}
+
+/**
+ * Abandon the RUN message being written if a value could not be encoded.
+ *
+ * @param connection
+ * @param loaded outcome of encoding the value
+ * @return 0 if the value was encoded, -1 otherwise
+ */
+int written(struct BoltConnection * connection, int loaded)
+{
+    if (loaded != 0)
+    {
+        struct BoltProtocolV1State* state = BoltProtocolV1_state(connection);
+        state->tx_buffer->extent = state->write_offset;
+        state->write_offset = -1;
+        return -1;
+    }
     return 0;
 }
 
+int BoltProtocolV1_write_null(struct BoltConnection * connection)
+{
+    struct BoltBuffer * buffer = write_target(connection, 0);
+    return buffer == NULL ? -1 : written(connection, load_null(buffer));
+}
+
+int BoltProtocolV1_write_boolean(struct BoltConnection * connection, int value)
+{
+    struct BoltBuffer * buffer = write_target(connection, 0);
+    return buffer == NULL ? -1 : written(connection, load_boolean(buffer, value));
+}
+
+int BoltProtocolV1_write_integer(struct BoltConnection * connection, int64_t value)
+{
+    struct BoltBuffer * buffer = write_target(connection, 0);
+    return buffer == NULL ? -1 : written(connection, load_integer(buffer, value));
+}
+
+int BoltProtocolV1_write_float(struct BoltConnection * connection, double value)
+{
+    struct BoltBuffer * buffer = write_target(connection, 0);
+    return buffer == NULL ? -1 : written(connection, load_float(buffer, value));
+}
+
+int BoltProtocolV1_write_string(struct BoltConnection * connection, const char * data, int32_t size)
+{
+    struct BoltBuffer * buffer = write_target(connection, 0);
+    return buffer == NULL ? -1 : written(connection, load_string(buffer, data, size));
+}
+
+int BoltProtocolV1_write_bytes(struct BoltConnection * connection, const char * data, int32_t size)
+{
+    struct BoltBuffer * buffer = write_target(connection, 0);
+    return buffer == NULL ? -1 : written(connection, load_bytes(buffer, data, size));
+}
+
+int BoltProtocolV1_write_list(struct BoltConnection * connection, int32_t size)
+{
+    struct BoltBuffer * buffer = write_target(connection, size);
+    return buffer == NULL ? -1 : written(connection, load_list_header(buffer, size));
+}
+
+int BoltProtocolV1_write_map(struct BoltConnection * connection, int32_t size)
+{
+    struct BoltBuffer * buffer = write_target(connection, 2 * (int64_t)(size));
+    return buffer == NULL ? -1 : written(connection, load_map_header(buffer, size));
+}
+
+int BoltProtocolV1_load_discard_request(struct BoltConnection * connection, int32_t n)
+{
+    if (n >= 0)
+    {
+        return -1;
+    }
+    else
+    {
+        struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+        return BoltProtocolV1_load_message(connection, state->discard_request);
+    }
+}
+
 int BoltProtocolV1_load_pull_request(struct BoltConnection * connection, int32_t n)
 {
     if (n >= 0)
@@ -1246,8 +2592,7 @@ int BoltProtocolV1_load_pull_request(struct BoltConnection * connection, int32_t
     else
     {
         struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
-        BoltProtocolV1_load_message(connection, state->pull_request);
-        return 0;
+        return BoltProtocolV1_load_message(connection, state->pull_request);
     }
 }
 
@@ -1305,3 +2650,102 @@ int BoltProtocolV1_dump(struct BoltValue * value, struct BoltBuffer * buffer)
 {
     return load(buffer, value);
 }
+
+int BoltProtocolV1_dump_field_names(struct BoltConnection * connection, struct BoltBuffer * buffer)
+{
+    return BoltProtocolV1_dump(BoltProtocolV1_state(connection)->fields, buffer);
+}
+
+int BoltProtocolV1_dump_data(struct BoltConnection * connection, struct BoltBuffer * buffer)
+{
+    TRY(complete_record(connection));
+    return BoltProtocolV1_dump(BoltProtocolV1_state(connection)->data, buffer);
+}
+
+const struct BoltProtocol BOLT_PROTOCOL_V1 = {
+    .version = 1,
+    .attach = BoltProtocolV1_attach,
+    .detach = BoltProtocolV1_detach,
+    .fetch = BoltProtocolV1_fetch,
+    .fetch_batch = BoltProtocolV1_fetch_batch,
+    .record_field = BoltProtocolV1_record_field,
+    .skip_records = BoltProtocolV1_skip_records,
+    .data = BoltProtocolV1_data,
+    .last_request = BoltProtocolV1_last_request,
+    .load_init_request = BoltProtocolV1_load_init_request,
+    .load_reset_request = BoltProtocolV1_load_reset_request,
+    .set_cypher_template = BoltProtocolV1_set_cypher_template,
+    .set_n_cypher_parameters = BoltProtocolV1_set_n_cypher_parameters,
+    .set_cypher_parameter_key = BoltProtocolV1_set_cypher_parameter_key,
+    .cypher_parameter_value = BoltProtocolV1_cypher_parameter_value,
+    .load_bookmark = BoltProtocolV1_load_bookmark,
+    .load_tx_timeout = NULL,
+    .load_tx_metadata = NULL,
+    .load_begin_request = BoltProtocolV1_load_begin_request,
+    .load_commit_request = BoltProtocolV1_load_commit_request,
+    .load_rollback_request = BoltProtocolV1_load_rollback_request,
+    .load_run_request = BoltProtocolV1_load_run_request,
+    .load_statement_run_request = BoltProtocolV1_load_statement_run_request,
+    .begin_run_request = BoltProtocolV1_begin_run_request,
+    .end_run_request = BoltProtocolV1_end_run_request,
+    .write_null = BoltProtocolV1_write_null,
+    .write_boolean = BoltProtocolV1_write_boolean,
+    .write_integer = BoltProtocolV1_write_integer,
+    .write_float = BoltProtocolV1_write_float,
+    .write_string = BoltProtocolV1_write_string,
+    .write_bytes = BoltProtocolV1_write_bytes,
+    .write_list = BoltProtocolV1_write_list,
+    .write_map = BoltProtocolV1_write_map,
+    .load_discard_request = BoltProtocolV1_load_discard_request,
+    .load_pull_request = BoltProtocolV1_load_pull_request,
+    .n_fields = BoltProtocolV1_n_fields,
+    .field_name = BoltProtocolV1_field_name,
+    .field_name_size = BoltProtocolV1_field_name_size,
+    .dump_field_names = BoltProtocolV1_dump_field_names,
+    .dump_data = BoltProtocolV1_dump_data,
+};
+
+// Version 2 only adds structure types, which are decoded generically,
+// so its messaging is exactly that of version 1.
+const struct BoltProtocol BOLT_PROTOCOL_V2 = {
+    .version = 2,
+    .attach = BoltProtocolV1_attach,
+    .detach = BoltProtocolV1_detach,
+    .fetch = BoltProtocolV1_fetch,
+    .fetch_batch = BoltProtocolV1_fetch_batch,
+    .record_field = BoltProtocolV1_record_field,
+    .skip_records = BoltProtocolV1_skip_records,
+    .data = BoltProtocolV1_data,
+    .last_request = BoltProtocolV1_last_request,
+    .load_init_request = BoltProtocolV1_load_init_request,
+    .load_reset_request = BoltProtocolV1_load_reset_request,
+    .set_cypher_template = BoltProtocolV1_set_cypher_template,
+    .set_n_cypher_parameters = BoltProtocolV1_set_n_cypher_parameters,
+    .set_cypher_parameter_key = BoltProtocolV1_set_cypher_parameter_key,
+    .cypher_parameter_value = BoltProtocolV1_cypher_parameter_value,
+    .load_bookmark = BoltProtocolV1_load_bookmark,
+    .load_tx_timeout = NULL,
+    .load_tx_metadata = NULL,
+    .load_begin_request = BoltProtocolV1_load_begin_request,
+    .load_commit_request = BoltProtocolV1_load_commit_request,
+    .load_rollback_request = BoltProtocolV1_load_rollback_request,
+    .load_run_request = BoltProtocolV1_load_run_request,
+    .load_statement_run_request = BoltProtocolV1_load_statement_run_request,
+    .begin_run_request = BoltProtocolV1_begin_run_request,
+    .end_run_request = BoltProtocolV1_end_run_request,
+    .write_null = BoltProtocolV1_write_null,
+    .write_boolean = BoltProtocolV1_write_boolean,
+    .write_integer = BoltProtocolV1_write_integer,
+    .write_float = BoltProtocolV1_write_float,
+    .write_string = BoltProtocolV1_write_string,
+    .write_bytes = BoltProtocolV1_write_bytes,
+    .write_list = BoltProtocolV1_write_list,
+    .write_map = BoltProtocolV1_write_map,
+    .load_discard_request = BoltProtocolV1_load_discard_request,
+    .load_pull_request = BoltProtocolV1_load_pull_request,
+    .n_fields = BoltProtocolV1_n_fields,
+    .field_name = BoltProtocolV1_field_name,
+    .field_name_size = BoltProtocolV1_field_name_size,
+    .dump_field_names = BoltProtocolV1_dump_field_names,
+    .dump_data = BoltProtocolV1_dump_data,
+};
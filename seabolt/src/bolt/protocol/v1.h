@@ -54,13 +54,34 @@ struct _run_request
     struct BoltValue* request;
     struct BoltValue* statement;
     struct BoltValue* parameters;
+    /// Transaction metadata field (protocol v3 onwards, NULL otherwise)
+    struct BoltValue* metadata;
+};
+
+/// A response message queued while fetching the response to a later request
+struct _retained_message
+{
+    bolt_request_t request_id;
+    /// Position of the message bytes within the retained buffer
+    int offset;
+    /// Number of message bytes, or -1 once the message has been fetched
+    int size;
 };
 
 struct BoltProtocolV1State
 {
-    // These buffers exclude chunk headers.
+    // This buffer excludes chunk headers.
     struct BoltBuffer* tx_buffer;
-    struct BoltBuffer* rx_buffer;
+    /// Position within the transmit buffer of the RUN message being written
+    /// value by value, or -1 if none is being written
+    int write_offset;
+    /// Number of values still to be written to complete that message
+    int64_t write_remaining;
+    /// Bytes not yet decoded from the current chunk of the received message
+    int chunk_remaining;
+    /// Buffer for gathering streamed string and byte data that spans chunks
+    char * scratch;
+    int scratch_size;
 
     /// The product name and version of the remote server
     char * server;
@@ -83,6 +104,38 @@ struct BoltProtocolV1State
 
     /// Holder for fetched data and metadata
     struct BoltValue* data;
+
+    /// Undecoded bytes of the last record fetched lazily, when that record
+    /// spans more than one chunk
+    struct BoltBuffer* record;
+    /// Number of bytes of the last record fetched lazily that are held
+    /// unread at the head of the receive buffer, or 0 if it was copied
+    int record_held;
+    /// Position in the receive buffer of the message being unloaded by a
+    /// fetch, or -1
+    int message_start;
+    /// Offsets of the record fields within the held or copied bytes,
+    /// followed by their end
+    int32_t* record_offsets;
+    /// Flags marking the record fields already decoded into the data holder
+    char* record_decoded;
+    /// Number of offsets and flags allocated
+    int32_t record_capacity;
+    /// Number of fields of the last record fetched lazily, or -1 if the
+    /// data holder is fully decoded
+    int32_t record_size;
+
+    /// Undecoded bytes of the messages queued under the retention policy
+    struct BoltBuffer* retained;
+    /// Queued messages in order of arrival, the first `retained_first` of
+    /// which have all been fetched; fetched messages are dropped once they
+    /// take up more of the buffer than those still queued
+    struct _retained_message* retained_messages;
+    int retained_first;
+    int retained_count;
+    int retained_capacity;
+    /// Number of bytes of queued messages not yet fetched
+    int retained_bytes;
 };
 
 struct BoltProtocolV1State* BoltProtocolV1_create_state();
@@ -91,13 +144,113 @@ void BoltProtocolV1_destroy_state(struct BoltProtocolV1State* state);
 
 struct BoltProtocolV1State* BoltProtocolV1_state(struct BoltConnection* connection);
 
+void BoltProtocolV1_attach(struct BoltConnection * connection);
+
+void BoltProtocolV1_detach(struct BoltConnection * connection);
+
+struct BoltValue * BoltProtocolV1_data(struct BoltConnection * connection);
+
+bolt_request_t BoltProtocolV1_last_request(struct BoltConnection * connection);
+
 int BoltProtocolV1_load_message(struct BoltConnection * connection, struct BoltValue * value);
 
 int BoltProtocolV1_load_message_quietly(struct BoltConnection * connection, struct BoltValue * value);
 
 int BoltProtocolV1_compile_INIT(struct BoltValue* value, const struct BoltUserProfile * profile);
 
-int BoltProtocolV1_fetch_b(struct BoltConnection * connection, bolt_request_t request_id);
+/**
+ * Fetch the next value for a given request from the data already
+ * buffered on the connection, discarding the responses of any earlier
+ * requests on the way.
+ *
+ * @param connection
+ * @param request_id
+ * @return 1 if record data is fetched, 0 if summary metadata is fetched,
+ *         -1 on error or BOLT_WAITING if no complete message is buffered
+ */
+int BoltProtocolV1_fetch(struct BoltConnection * connection, bolt_request_t request_id);
+
+/**
+ * Move the record just fetched for a given request into the first of an
+ * array of values, then decode further records of that request into the
+ * rest of the array for as long as complete records remain buffered.
+ *
+ * @param connection
+ * @param request_id
+ * @param values
+ * @param max number of values in the array, at least 1
+ * @return the number of records placed in the array, or -1 on error
+ */
+int BoltProtocolV1_fetch_batch(struct BoltConnection * connection, bolt_request_t request_id,
+                               struct BoltValue ** values, int max);
+
+/**
+ * Pass over the records of a given request that are already buffered,
+ * without decoding them, stopping at the first message that is not a
+ * complete record.
+ *
+ * @param connection
+ * @param request_id
+ * @return the number of records skipped
+ */
+int BoltProtocolV1_skip_records(struct BoltConnection * connection, bolt_request_t request_id);
+
+/**
+ * Access a field of the record last fetched, decoding it first if the
+ * record was fetched lazily and the field has not been touched yet.
+ *
+ * @param connection
+ * @param index
+ * @return the field value, or NULL if no record is held, the index is
+ *         out of range or the field cannot be decoded
+ */
+struct BoltValue * BoltProtocolV1_record_field(struct BoltConnection * connection, int32_t index);
+
+/**
+ * Begin writing a RUN message into the transmit buffer, encoding the
+ * statement and the header of its parameter map, so that parameters can
+ * then be written one value at a time.
+ *
+ * @param connection
+ * @param cypher
+ * @param cypher_size
+ * @param n_parameters
+ * @param n_fields number of message fields, including any metadata following the parameters
+ * @return 0 on success, -1 if a message is already being written or the statement cannot be encoded
+ */
+int BoltProtocolV1_begin_run(struct BoltConnection * connection, const char * cypher, size_t cypher_size,
+                             int32_t n_parameters, int8_t n_fields);
+
+/**
+ * Complete the RUN message being written and queue it for transmission.
+ *
+ * @param connection
+ * @param metadata transaction metadata to append, or NULL
+ * @return 0 on success, -1 if no message is being written or not all of
+ *         its parameters have been written
+ */
+int BoltProtocolV1_end_run(struct BoltConnection * connection, struct BoltValue * metadata);
+
+int BoltProtocolV1_begin_run_request(struct BoltConnection * connection, const char * cypher, size_t cypher_size,
+                                     int32_t n_parameters);
+
+int BoltProtocolV1_end_run_request(struct BoltConnection * connection);
+
+int BoltProtocolV1_write_null(struct BoltConnection * connection);
+
+int BoltProtocolV1_write_boolean(struct BoltConnection * connection, int value);
+
+int BoltProtocolV1_write_integer(struct BoltConnection * connection, int64_t value);
+
+int BoltProtocolV1_write_float(struct BoltConnection * connection, double value);
+
+int BoltProtocolV1_write_string(struct BoltConnection * connection, const char * data, int32_t size);
+
+int BoltProtocolV1_write_bytes(struct BoltConnection * connection, const char * data, int32_t size);
+
+int BoltProtocolV1_write_list(struct BoltConnection * connection, int32_t size);
+
+int BoltProtocolV1_write_map(struct BoltConnection * connection, int32_t size);
 
 /**
  * Top-level unload.
@@ -114,9 +267,9 @@ const char* BoltProtocolV1_structure_name(int16_t code);
 
 const char* BoltProtocolV1_message_name(int16_t code);
 
-int BoltProtocolV1_init_b(struct BoltConnection * connection, const struct BoltUserProfile * profile);
+int BoltProtocolV1_load_init_request(struct BoltConnection * connection, const struct BoltUserProfile * profile);
 
-int BoltProtocolV1_reset_b(struct BoltConnection * connection);
+int BoltProtocolV1_load_reset_request(struct BoltConnection * connection);
 
 void BoltProtocolV1_extract_metadata(struct BoltConnection * connection, struct BoltValue * summary);
 
@@ -139,6 +292,41 @@ int BoltProtocolV1_load_rollback_request(struct BoltConnection * connection);
 
 int BoltProtocolV1_load_run_request(struct BoltConnection * connection);
 
+/**
+ * Encode a statement string, followed by the header of a parameter map
+ * and the parameter keys, for copying into RUN messages.
+ *
+ * @param buffer
+ * @param cypher
+ * @param size
+ * @param keys
+ * @param n_keys
+ * @param offsets receives the offset of each key, followed by their end
+ * @return 0 on success, -1 if the statement cannot be encoded
+ */
+int BoltProtocolV1_compile_statement(struct BoltBuffer * buffer, const char * cypher, int32_t size,
+                                     const char ** keys, int32_t n_keys, int32_t * offsets);
+
+/**
+ * Load a RUN message for a compiled statement, encoding only the
+ * parameter values.
+ *
+ * @param connection
+ * @param statement
+ * @param parameters list of values, one per key, or NULL if there are none
+ * @param metadata transaction metadata to append as a third field, or
+ *                 NULL for a two-field message
+ * @return 0 on success, -1 on error
+ */
+int BoltProtocolV1_load_statement(struct BoltConnection * connection, const struct BoltStatement * statement,
+                                  const struct BoltValue * parameters, struct BoltValue * metadata);
+
+int BoltProtocolV1_load_statement_run_request(struct BoltConnection * connection,
+                                              const struct BoltStatement * statement,
+                                              const struct BoltValue * parameters);
+
+int BoltProtocolV1_load_discard_request(struct BoltConnection * connection, int32_t n);
+
 int BoltProtocolV1_load_pull_request(struct BoltConnection * connection, int32_t n);
 
 int32_t BoltProtocolV1_n_fields(struct BoltConnection * connection);
@@ -149,5 +337,9 @@ int32_t BoltProtocolV1_field_name_size(struct BoltConnection * connection, int32
 
 int BoltProtocolV1_dump(struct BoltValue * value, struct BoltBuffer * buffer);
 
+int BoltProtocolV1_dump_field_names(struct BoltConnection * connection, struct BoltBuffer * buffer);
+
+int BoltProtocolV1_dump_data(struct BoltConnection * connection, struct BoltBuffer * buffer);
+
 
 #endif // SEABOLT_PROTOCOL_V1
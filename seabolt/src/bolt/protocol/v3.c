@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2002-2018 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <memory.h>
+
+#include "bolt/logging.h"
+#include "protocol.h"
+#include "v1.h"
+#include "v3.h"
+
+#define HELLO       0x01
+#define GOODBYE     0x02
+#define RUN         0x10
+#define BEGIN       0x11
+#define COMMIT      0x12
+#define ROLLBACK    0x13
+
+
+int BoltProtocolV3_compile_HELLO(struct BoltValue * value, const struct BoltUserProfile * profile)
+{
+    switch(profile->auth_scheme)
+    {
+        case BOLT_AUTH_BASIC:
+        {
+            BoltValue_to_Message(value, HELLO, 1);
+            struct BoltValue* extra = BoltMessage_value(value, 0);
+            if (profile->user == NULL || profile->password == NULL)
+            {
+                BoltValue_to_Dictionary(extra, 1);
+            }
+            else
+            {
+                BoltValue_to_Dictionary(extra, 4);
+                BoltDictionary_set_key(extra, 1, "scheme", 6);
+                BoltDictionary_set_key(extra, 2, "principal", 9);
+                BoltDictionary_set_key(extra, 3, "credentials", 11);
+                BoltValue_to_String(BoltDictionary_value(extra, 1), "basic", 5);
+                BoltValue_to_String(BoltDictionary_value(extra, 2), profile->user, strlen(profile->user));
+                BoltValue_to_String(BoltDictionary_value(extra, 3), profile->password, strlen(profile->password));
+            }
+            BoltDictionary_set_key(extra, 0, "user_agent", 10);
+            BoltValue_to_String(BoltDictionary_value(extra, 0), profile->user_agent, strlen(profile->user_agent));
+        }
+        break;
+    }
+    return 0;
+}
+
+void BoltProtocolV3_attach(struct BoltConnection * connection)
+{
+    BoltProtocolV1_attach(connection);
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+
+    // RUN carries transaction metadata for auto-commit transactions
+    BoltValue_to_Message(state->run.request, RUN, 3);
+    state->run.statement = BoltMessage_value(state->run.request, 0);
+    state->run.parameters = BoltMessage_value(state->run.request, 1);
+    state->run.metadata = BoltMessage_value(state->run.request, 2);
+    BoltValue_to_Dictionary(state->run.parameters, 0);
+    BoltValue_to_Dictionary(state->run.metadata, 0);
+
+    // Metadata for the next transaction accumulates in the BEGIN message
+    BoltValue_to_Message(state->begin.request, BEGIN, 1);
+    state->begin.statement = NULL;
+    state->begin.parameters = NULL;
+    state->begin.metadata = BoltMessage_value(state->begin.request, 0);
+    BoltValue_to_Dictionary(state->begin.metadata, 0);
+
+    BoltValue_to_Message(state->commit.request, COMMIT, 0);
+    state->commit.statement = NULL;
+    state->commit.parameters = NULL;
+
+    BoltValue_to_Message(state->rollback.request, ROLLBACK, 0);
+    state->rollback.statement = NULL;
+    state->rollback.parameters = NULL;
+}
+
+int BoltProtocolV3_load_init_request(struct BoltConnection * connection, const struct BoltUserProfile * profile)
+{
+    struct BoltUserProfile masked_profile;
+    memcpy(&masked_profile, profile, sizeof(struct BoltUserProfile));
+    masked_profile.password = "*******";
+    struct BoltValue * hello = BoltValue_create();
+    BoltProtocolV3_compile_HELLO(hello, &masked_profile);
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    BoltLog_message("C", state->next_request_id, hello, connection->protocol_version);
+    BoltProtocolV3_compile_HELLO(hello, profile);
+    int loaded = BoltProtocolV1_load_message_quietly(connection, hello);
+    BoltValue_destroy(hello);
+    return loaded;
+}
+
+/**
+ * Find an entry of the metadata for the next transaction, adding it if
+ * not already present.
+ *
+ * @param connection
+ * @param key
+ * @param key_size
+ * @return the value of the entry
+ */
+struct BoltValue * tx_metadata_entry(struct BoltConnection * connection, const char * key, size_t key_size)
+{
+    struct BoltValue * metadata = BoltProtocolV1_state(connection)->begin.metadata;
+    for (int32_t i = 0; i < metadata->size; i++)
+    {
+        if (BoltDictionary_get_key_size(metadata, i) == (int32_t)(key_size) &&
+            memcmp(BoltDictionary_get_key(metadata, i), key, key_size) == 0)
+        {
+            return BoltDictionary_value(metadata, i);
+        }
+    }
+    int32_t index = metadata->size;
+    BoltValue_to_Dictionary(metadata, index + 1);
+    BoltDictionary_set_key(metadata, index, key, key_size);
+    return BoltDictionary_value(metadata, index);
+}
+
+int BoltProtocolV3_load_bookmark(struct BoltConnection * connection, const char * bookmark)
+{
+    if (bookmark == NULL)
+    {
+        return 0;
+    }
+    size_t bookmark_size = strlen(bookmark);
+    if (bookmark_size > INT32_MAX)
+    {
+        return -1;
+    }
+    struct BoltValue * bookmarks = tx_metadata_entry(connection, "bookmarks", 9);
+    if (BoltValue_type(bookmarks) != BOLT_LIST)
+    {
+        BoltValue_to_List(bookmarks, 0);
+    }
+    int32_t n_bookmarks = bookmarks->size;
+    BoltList_resize(bookmarks, n_bookmarks + 1);
+    BoltValue_to_String(BoltList_value(bookmarks, n_bookmarks), bookmark, (int32_t)(bookmark_size));
+    return 1;
+}
+
+int BoltProtocolV3_load_tx_timeout(struct BoltConnection * connection, int64_t timeout)
+{
+    if (timeout < 0)
+    {
+        return -1;
+    }
+    BoltValue_to_Int64(tx_metadata_entry(connection, "tx_timeout", 10), timeout);
+    return 0;
+}
+
+struct BoltValue * BoltProtocolV3_load_tx_metadata(struct BoltConnection * connection, int32_t size)
+{
+    if (size < 0)
+    {
+        return NULL;
+    }
+    struct BoltValue * metadata = tx_metadata_entry(connection, "tx_metadata", 11);
+    BoltValue_to_Dictionary(metadata, size);
+    return metadata;
+}
+
+int BoltProtocolV3_load_begin_request(struct BoltConnection * connection)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    int loaded = BoltProtocolV1_load_message(connection, state->begin.request);
+    BoltValue_to_Dictionary(state->begin.metadata, 0);
+    return loaded;
+}
+
+int BoltProtocolV3_load_commit_request(struct BoltConnection * connection)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    return BoltProtocolV1_load_message(connection, state->commit.request);
+}
+
+int BoltProtocolV3_load_rollback_request(struct BoltConnection * connection)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    return BoltProtocolV1_load_message(connection, state->rollback.request);
+}
+
+int BoltProtocolV3_load_run_request(struct BoltConnection * connection)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    if (state->begin.metadata->size == 0)
+    {
+        return BoltProtocolV1_load_message(connection, state->run.request);
+    }
+    // Metadata loaded since the last BEGIN applies to this auto-commit
+    // transaction instead, and is moved into place rather than copied
+    _exchange(state->run.metadata, state->begin.metadata);
+    int loaded = BoltProtocolV1_load_message(connection, state->run.request);
+    _exchange(state->run.metadata, state->begin.metadata);
+    BoltValue_to_Dictionary(state->begin.metadata, 0);
+    return loaded;
+}
+
+int BoltProtocolV3_load_statement_run_request(struct BoltConnection * connection,
+                                              const struct BoltStatement * statement,
+                                              const struct BoltValue * parameters)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    int loaded = BoltProtocolV1_load_statement(connection, statement, parameters, state->begin.metadata);
+    if (loaded == 0)
+    {
+        BoltValue_to_Dictionary(state->begin.metadata, 0);
+    }
+    return loaded;
+}
+
+int BoltProtocolV3_begin_run_request(struct BoltConnection * connection, const char * cypher, size_t cypher_size,
+                                     int32_t n_parameters)
+{
+    return BoltProtocolV1_begin_run(connection, cypher, cypher_size, n_parameters, 3);
+}
+
+int BoltProtocolV3_end_run_request(struct BoltConnection * connection)
+{
+    struct BoltProtocolV1State * state = BoltProtocolV1_state(connection);
+    int loaded = BoltProtocolV1_end_run(connection, state->begin.metadata);
+    if (loaded == 0)
+    {
+        BoltValue_to_Dictionary(state->begin.metadata, 0);
+    }
+    return loaded;
+}
+
+const char* BoltProtocolV3_structure_name(int16_t code)
+{
+    switch(code)
+    {
+        case 'X':
+            return "Point2D";
+        case 'Y':
+            return "Point3D";
+        case 'D':
+            return "Date";
+        case 'T':
+            return "Time";
+        case 't':
+            return "LocalTime";
+        case 'F':
+            return "DateTime";
+        case 'f':
+            return "DateTimeZoneId";
+        case 'd':
+            return "LocalDateTime";
+        case 'E':
+            return "Duration";
+        default:
+            return BoltProtocolV1_structure_name(code);
+    }
+}
+
+const char* BoltProtocolV3_message_name(int16_t code)
+{
+    switch(code)
+    {
+        case HELLO:
+            return "HELLO";
+        case GOODBYE:
+            return "GOODBYE";
+        case BEGIN:
+            return "BEGIN";
+        case COMMIT:
+            return "COMMIT";
+        case ROLLBACK:
+            return "ROLLBACK";
+        default:
+            return BoltProtocolV1_message_name(code);
+    }
+}
+
+const struct BoltProtocol BOLT_PROTOCOL_V3 = {
+    .version = 3,
+    .attach = BoltProtocolV3_attach,
+    .detach = BoltProtocolV1_detach,
+    .fetch = BoltProtocolV1_fetch,
+    .fetch_batch = BoltProtocolV1_fetch_batch,
+    .record_field = BoltProtocolV1_record_field,
+    .skip_records = BoltProtocolV1_skip_records,
+    .data = BoltProtocolV1_data,
+    .last_request = BoltProtocolV1_last_request,
+    .load_init_request = BoltProtocolV3_load_init_request,
+    .load_reset_request = BoltProtocolV1_load_reset_request,
+    .set_cypher_template = BoltProtocolV1_set_cypher_template,
+    .set_n_cypher_parameters = BoltProtocolV1_set_n_cypher_parameters,
+    .set_cypher_parameter_key = BoltProtocolV1_set_cypher_parameter_key,
+    .cypher_parameter_value = BoltProtocolV1_cypher_parameter_value,
+    .load_bookmark = BoltProtocolV3_load_bookmark,
+    .load_tx_timeout = BoltProtocolV3_load_tx_timeout,
+    .load_tx_metadata = BoltProtocolV3_load_tx_metadata,
+    .load_begin_request = BoltProtocolV3_load_begin_request,
+    .load_commit_request = BoltProtocolV3_load_commit_request,
+    .load_rollback_request = BoltProtocolV3_load_rollback_request,
+    .load_run_request = BoltProtocolV3_load_run_request,
+    .load_statement_run_request = BoltProtocolV3_load_statement_run_request,
+    .begin_run_request = BoltProtocolV3_begin_run_request,
+    .end_run_request = BoltProtocolV3_end_run_request,
+    .write_null = BoltProtocolV1_write_null,
+    .write_boolean = BoltProtocolV1_write_boolean,
+    .write_integer = BoltProtocolV1_write_integer,
+    .write_float = BoltProtocolV1_write_float,
+    .write_string = BoltProtocolV1_write_string,
+    .write_bytes = BoltProtocolV1_write_bytes,
+    .write_list = BoltProtocolV1_write_list,
+    .write_map = BoltProtocolV1_write_map,
+    .load_discard_request = BoltProtocolV1_load_discard_request,
+    .load_pull_request = BoltProtocolV1_load_pull_request,
+    .n_fields = BoltProtocolV1_n_fields,
+    .field_name = BoltProtocolV1_field_name,
+    .field_name_size = BoltProtocolV1_field_name_size,
+    .dump_field_names = BoltProtocolV1_dump_field_names,
+    .dump_data = BoltProtocolV1_dump_data,
+};
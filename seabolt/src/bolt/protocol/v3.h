@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2002-2018 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SEABOLT_PROTOCOL_V3
+#define SEABOLT_PROTOCOL_V3
+
+#include <stdint.h>
+
+#include "bolt/direct.h"
+
+
+// Bolt v3 keeps the v1 framing, encoding and protocol state; only the
+// messages that initialise connections and demarcate transactions change.
+
+int BoltProtocolV3_compile_HELLO(struct BoltValue * value, const struct BoltUserProfile * profile);
+
+void BoltProtocolV3_attach(struct BoltConnection * connection);
+
+int BoltProtocolV3_load_init_request(struct BoltConnection * connection, const struct BoltUserProfile * profile);
+
+int BoltProtocolV3_load_bookmark(struct BoltConnection * connection, const char * bookmark);
+
+int BoltProtocolV3_load_tx_timeout(struct BoltConnection * connection, int64_t timeout);
+
+struct BoltValue * BoltProtocolV3_load_tx_metadata(struct BoltConnection * connection, int32_t size);
+
+int BoltProtocolV3_load_begin_request(struct BoltConnection * connection);
+
+int BoltProtocolV3_load_commit_request(struct BoltConnection * connection);
+
+int BoltProtocolV3_load_rollback_request(struct BoltConnection * connection);
+
+int BoltProtocolV3_load_run_request(struct BoltConnection * connection);
+
+int BoltProtocolV3_load_statement_run_request(struct BoltConnection * connection,
+                                              const struct BoltStatement * statement,
+                                              const struct BoltValue * parameters);
+
+int BoltProtocolV3_begin_run_request(struct BoltConnection * connection, const char * cypher, size_t cypher_size,
+                                     int32_t n_parameters);
+
+int BoltProtocolV3_end_run_request(struct BoltConnection * connection);
+
+const char* BoltProtocolV3_structure_name(int16_t code);
+
+const char* BoltProtocolV3_message_name(int16_t code);
+
+
+#endif // SEABOLT_PROTOCOL_V3
@@ -0,0 +1,711 @@
+/*
+ * Copyright (c) 2002-2018 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+
+#include "bolt/config-impl.h"
+#include "bolt/buffering.h"
+#include "bolt/logging.h"
+#include "bolt/mem.h"
+#include "bolt/ring.h"
+
+
+#if USE_IO_URING
+
+/// Maximum number of segments gathered into a single send
+#define MAX_RING_VECTOR_SIZE 64
+
+/// Size of the sparse table of registered buffers, one per attached connection
+#define MAX_RING_BUFFERS 256
+
+/// User data bits identifying the operation of a completion; the rest identify the slot
+#define OPERATION_MASK 7u
+
+/// User data of cancellations, which belong to no slot
+#define CANCELLATION 0u
+
+/**
+ * A slot together with the message gathered for its send. Sends complete
+ * during the system call that submits them, so the message need only
+ * live as long as the slot.
+ */
+struct BoltRingEntry
+{
+    struct BoltRingSlot slot;
+    struct msghdr message;
+    struct iovec vector[MAX_RING_VECTOR_SIZE];
+};
+
+struct BoltRing
+{
+    int descriptor;
+    unsigned entries;
+
+    unsigned * sq_head;
+    unsigned * sq_tail;
+    unsigned sq_mask;
+    unsigned * sq_array;
+    struct io_uring_sqe * sqes;
+
+    unsigned * cq_head;
+    unsigned * cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe * cqes;
+
+    void * sq_ring;
+    size_t sq_ring_size;
+    void * cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    /// Number of entries in the registered buffer table, or zero if buffers cannot be registered
+    int n_buffers;
+    /// Non-zero for each index in the buffer table reserved by a slot
+    char * buffers_used;
+    /// Number of cancellations submitted and not yet completed
+    int n_cancellations;
+    struct BoltRingSlot * slots;
+};
+
+
+int ring_setup(unsigned entries, struct io_uring_params * params)
+{
+    return (int)(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ring_enter(int descriptor, unsigned to_submit, unsigned min_complete, unsigned flags, void * arg, size_t size)
+{
+    return (int)(syscall(__NR_io_uring_enter, descriptor, to_submit, min_complete, flags, arg, size));
+}
+
+int ring_register(int descriptor, unsigned opcode, void * arg, unsigned n_args)
+{
+    return (int)(syscall(__NR_io_uring_register, descriptor, opcode, arg, n_args));
+}
+
+int map_ring(struct BoltRing * ring, const struct io_uring_params * params)
+{
+    ring->sq_ring_size = params->sq_off.array + params->sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+    if (params->features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+        {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->descriptor, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+    {
+        return -1;
+    }
+    ring->cq_ring = ring->sq_ring;
+    if (!(params->features & IORING_FEAT_SINGLE_MMAP))
+    {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->descriptor, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED)
+        {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+            return -1;
+        }
+    }
+    ring->sqes_size = params->sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->descriptor, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        if (ring->cq_ring != ring->sq_ring)
+        {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        return -1;
+    }
+    char * sq = ring->sq_ring;
+    char * cq = ring->cq_ring;
+    ring->entries = params->sq_entries;
+    ring->sq_head = (unsigned *)(sq + params->sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params->sq_off.tail);
+    ring->sq_mask = *(unsigned *)(sq + params->sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params->sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params->cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params->cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + params->cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params->cq_off.cqes);
+    return 0;
+}
+
+void unmap_ring(struct BoltRing * ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring)
+    {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+}
+
+/**
+ * Record a completion against the slot that submitted the operation.
+ */
+void complete(struct BoltRing * ring, uint64_t user_data, int result)
+{
+    if (user_data == CANCELLATION)
+    {
+        ring->n_cancellations -= 1;
+        return;
+    }
+    struct BoltRingSlot * slot = (struct BoltRingSlot *)(uintptr_t)(user_data & ~(uint64_t)(OPERATION_MASK));
+    int operation = (int)(user_data & OPERATION_MASK);
+    switch (operation)
+    {
+        case BOLT_RING_SEND:
+            slot->send_result = result;
+            slot->pending &= ~BOLT_RING_SEND;
+            break;
+        case BOLT_RING_RECEIVE:
+            slot->receive_result = result;
+            slot->pending &= ~BOLT_RING_RECEIVE;
+            break;
+        case BOLT_RING_POLL:
+            slot->n_polls -= 1;
+            if (slot->n_polls == 0)
+            {
+                slot->pending &= ~BOLT_RING_POLL;
+                slot->poll_events = 0;
+            }
+            slot->blocked = 0;
+            break;
+        default:
+            return;
+    }
+    slot->completed |= operation;
+}
+
+/**
+ * Record all completions available in the completion queue.
+ *
+ * @return the number of completions
+ */
+int reap(struct BoltRing * ring)
+{
+    int n_completions = 0;
+    unsigned head = *ring->cq_head;
+    while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+    {
+        struct io_uring_cqe * cqe = &ring->cqes[head & ring->cq_mask];
+        complete(ring, cqe->user_data, cqe->res);
+        head += 1;
+        n_completions += 1;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return n_completions;
+}
+
+/**
+ * Submit queued entries and wait for completions.
+ *
+ * @param ring
+ * @param min_complete number of completions to wait for
+ * @param timeout maximum time to wait in milliseconds, or -1 to wait indefinitely
+ * @return the number of completions, or -1 on error
+ */
+int submit(struct BoltRing * ring, unsigned min_complete, int timeout)
+{
+    unsigned to_submit = *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (to_submit == 0 && min_complete == 0)
+    {
+        return reap(ring);
+    }
+    struct __kernel_timespec time;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0;
+    if (timeout >= 0)
+    {
+        time.tv_sec = timeout / 1000;
+        time.tv_nsec = (timeout % 1000) * 1000000LL;
+        arg.ts = (uint64_t)(uintptr_t)(&time);
+    }
+    int entered = ring_enter(ring->descriptor, to_submit, min_complete, flags,
+                             min_complete > 0 ? &arg : NULL, min_complete > 0 ? sizeof(arg) : 0);
+    if (entered == -1 && errno != ETIME && errno != EINTR && errno != EBUSY)
+    {
+        BoltLog_error("bolt: Unable to enter ring (error %d)", errno);
+        return -1;
+    }
+    return reap(ring);
+}
+
+/**
+ * Take the next free submission queue entry, submitting queued entries
+ * first if the queue is full.
+ */
+struct io_uring_sqe * next_entry(struct BoltRing * ring, uint64_t user_data)
+{
+    unsigned tail = *ring->sq_tail;
+    while (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->entries)
+    {
+        if (submit(ring, 0, 0) == -1)
+        {
+            return NULL;
+        }
+    }
+    struct io_uring_sqe * sqe = &ring->sqes[tail & ring->sq_mask];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->user_data = user_data;
+    ring->sq_array[tail & ring->sq_mask] = tail & ring->sq_mask;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+uint64_t tag(struct BoltRingSlot * slot, enum BoltRingOperation operation)
+{
+    return (uint64_t)(uintptr_t)(slot) | (uint64_t)(operation);
+}
+
+/**
+ * Gather the segments queued on a connection into a message and submit
+ * a send for it. The send is flagged not to wait, so that it completes
+ * during submission and no segment buffer is referenced afterwards.
+ */
+int prepare_send(struct BoltRing * ring, struct BoltRingEntry * entry)
+{
+    struct BoltRingSlot * slot = &entry->slot;
+    struct BoltConnection * connection = slot->connection;
+    int n_vector = connection->n_tx_segments < MAX_RING_VECTOR_SIZE ? connection->n_tx_segments : MAX_RING_VECTOR_SIZE;
+    for (int i = 0; i < n_vector; i++)
+    {
+        struct BoltTransmitSegment * segment = &connection->tx_segments[i];
+        entry->vector[i].iov_base = &segment->buffer->data[segment->offset];
+        entry->vector[i].iov_len = (size_t)(segment->size);
+    }
+    memset(&entry->message, 0, sizeof(entry->message));
+    entry->message.msg_iov = &entry->vector[0];
+    entry->message.msg_iovlen = (size_t)(n_vector);
+    struct io_uring_sqe * sqe = next_entry(ring, tag(slot, BOLT_RING_SEND));
+    if (sqe == NULL)
+    {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = connection->socket;
+    sqe->addr = (uint64_t)(uintptr_t)(&entry->message);
+    sqe->len = 1;
+    sqe->msg_flags = (uint32_t)(slot->send_flags | MSG_DONTWAIT);
+    slot->pending |= BOLT_RING_SEND;
+    return 0;
+}
+
+/**
+ * Point the registered buffer of a slot at the current receive buffer
+ * of its connection, giving up the registration if the kernel refuses.
+ */
+void register_buffer(struct BoltRing * ring, struct BoltRingSlot * slot)
+{
+    struct BoltBuffer * buffer = slot->connection->rx_buffer;
+    if (slot->buffer_index == -1 || (slot->registered_data == buffer->data && slot->registered_size == buffer->size))
+    {
+        return;
+    }
+    struct iovec vector;
+    vector.iov_base = buffer->data;
+    vector.iov_len = (size_t)(buffer->size);
+    struct io_uring_rsrc_update2 update;
+    memset(&update, 0, sizeof(update));
+    update.offset = (uint32_t)(slot->buffer_index);
+    update.data = (uint64_t)(uintptr_t)(&vector);
+    update.nr = 1;
+    if (ring_register(ring->descriptor, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) == -1)
+    {
+        BoltLog_info("bolt: Unable to register receive buffer (error %d)", errno);
+        ring->buffers_used[slot->buffer_index] = 0;
+        slot->buffer_index = -1;
+        slot->registered_data = NULL;
+        slot->registered_size = 0;
+        return;
+    }
+    slot->registered_data = buffer->data;
+    slot->registered_size = buffer->size;
+}
+
+void release_buffer(struct BoltRing * ring, struct BoltRingSlot * slot)
+{
+    if (slot->buffer_index == -1)
+    {
+        return;
+    }
+    if (slot->registered_data != NULL)
+    {
+        struct iovec vector;
+        memset(&vector, 0, sizeof(vector));
+        struct io_uring_rsrc_update2 update;
+        memset(&update, 0, sizeof(update));
+        update.offset = (uint32_t)(slot->buffer_index);
+        update.data = (uint64_t)(uintptr_t)(&vector);
+        update.nr = 1;
+        ring_register(ring->descriptor, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update));
+    }
+    ring->buffers_used[slot->buffer_index] = 0;
+    slot->buffer_index = -1;
+    slot->registered_data = NULL;
+    slot->registered_size = 0;
+}
+
+int poll_socket(struct BoltRing * ring, struct BoltRingSlot * slot, int socket, int events)
+{
+    struct io_uring_sqe * sqe = next_entry(ring, tag(slot, BOLT_RING_POLL));
+    if (sqe == NULL)
+    {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = socket;
+    sqe->poll32_events = (uint32_t)(events);
+    slot->pending |= BOLT_RING_POLL;
+    slot->n_polls += 1;
+    return 0;
+}
+
+struct BoltRing * BoltRing_create(int entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int descriptor = ring_setup((unsigned)(entries), &params);
+    if (descriptor == -1)
+    {
+        BoltLog_error("bolt: Unable to create ring (error %d)", errno);
+        return NULL;
+    }
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+    {
+        BoltLog_error("bolt: Ring features unavailable on this kernel");
+        close(descriptor);
+        return NULL;
+    }
+    struct BoltRing * ring = BoltMem_allocate(sizeof(struct BoltRing));
+    memset(ring, 0, sizeof(struct BoltRing));
+    ring->descriptor = descriptor;
+    if (map_ring(ring, &params) == -1)
+    {
+        BoltLog_error("bolt: Unable to map ring (error %d)", errno);
+        close(descriptor);
+        BoltMem_deallocate(ring, sizeof(struct BoltRing));
+        return NULL;
+    }
+    struct io_uring_rsrc_register buffers;
+    memset(&buffers, 0, sizeof(buffers));
+    buffers.nr = MAX_RING_BUFFERS;
+    buffers.flags = IORING_RSRC_REGISTER_SPARSE;
+    if (ring_register(descriptor, IORING_REGISTER_BUFFERS2, &buffers, sizeof(buffers)) == 0)
+    {
+        ring->n_buffers = MAX_RING_BUFFERS;
+        ring->buffers_used = BoltMem_allocate((size_t)(ring->n_buffers));
+        memset(ring->buffers_used, 0, (size_t)(ring->n_buffers));
+    }
+    else
+    {
+        BoltLog_info("bolt: Receiving into unregistered buffers (error %d)", errno);
+    }
+    return ring;
+}
+
+void BoltRing_destroy(struct BoltRing * ring)
+{
+    while (ring->slots != NULL)
+    {
+        BoltRing_detach(ring->slots->connection);
+    }
+    unmap_ring(ring);
+    close(ring->descriptor);
+    BoltMem_deallocate(ring->buffers_used, (size_t)(ring->n_buffers));
+    BoltMem_deallocate(ring, sizeof(struct BoltRing));
+}
+
+int BoltRing_attach(struct BoltRing * ring, struct BoltConnection * connection)
+{
+    if (connection->ring == ring)
+    {
+        return 0;
+    }
+    if (connection->ring != NULL)
+    {
+        BoltRing_detach(connection);
+    }
+    struct BoltRingEntry * entry = BoltMem_allocate(sizeof(struct BoltRingEntry));
+    memset(entry, 0, sizeof(struct BoltRingEntry));
+    struct BoltRingSlot * slot = &entry->slot;
+    slot->connection = connection;
+    slot->buffer_index = -1;
+    for (int i = 0; i < ring->n_buffers; i++)
+    {
+        if (!ring->buffers_used[i])
+        {
+            ring->buffers_used[i] = 1;
+            slot->buffer_index = i;
+            break;
+        }
+    }
+    slot->next = ring->slots;
+    ring->slots = slot;
+    connection->ring = ring;
+    connection->ring_slot = slot;
+    return 0;
+}
+
+void BoltRing_detach(struct BoltConnection * connection)
+{
+    struct BoltRing * ring = connection->ring;
+    struct BoltRingSlot * slot = connection->ring_slot;
+    if (ring == NULL)
+    {
+        return;
+    }
+    if (connection->socket > 0)
+    {
+        BoltRing_cancel(connection, connection->socket);
+    }
+    for (int i = 0; i < connection->n_attempts; i++)
+    {
+        BoltRing_cancel(connection, connection->attempts[i]);
+    }
+    while (slot->pending != 0)
+    {
+        if (submit(ring, 1, -1) == -1)
+        {
+            break;
+        }
+    }
+    release_buffer(ring, slot);
+    struct BoltRingSlot ** link = &ring->slots;
+    while (*link != slot)
+    {
+        link = &(*link)->next;
+    }
+    *link = slot->next;
+    BoltMem_deallocate(slot, sizeof(struct BoltRingEntry));
+    connection->ring = NULL;
+    connection->ring_slot = NULL;
+}
+
+int BoltRing_enter(struct BoltRing * ring, int timeout)
+{
+    for (struct BoltRingSlot * slot = ring->slots; slot != NULL; slot = slot->next)
+    {
+        if (slot->requested & BOLT_RING_SEND)
+        {
+            slot->requested &= ~BOLT_RING_SEND;
+            if (prepare_send(ring, (struct BoltRingEntry *)(slot)) == -1)
+            {
+                return -1;
+            }
+        }
+    }
+    return submit(ring, timeout == 0 ? 0 : 1, timeout);
+}
+
+void BoltRing_send(struct BoltConnection * connection, int flags)
+{
+    struct BoltRingSlot * slot = connection->ring_slot;
+    slot->send_flags = flags;
+    slot->requested |= BOLT_RING_SEND;
+}
+
+int BoltRing_receive(struct BoltConnection * connection, int offset, int size)
+{
+    struct BoltRing * ring = connection->ring;
+    struct BoltRingSlot * slot = connection->ring_slot;
+    register_buffer(ring, slot);
+    struct io_uring_sqe * sqe = next_entry(ring, tag(slot, BOLT_RING_RECEIVE));
+    if (sqe == NULL)
+    {
+        return -1;
+    }
+    sqe->fd = connection->socket;
+    sqe->addr = (uint64_t)(uintptr_t)(&connection->rx_buffer->data[offset]);
+    sqe->len = (uint32_t)(size);
+    if (slot->buffer_index == -1)
+    {
+        sqe->opcode = IORING_OP_RECV;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = (uint16_t)(slot->buffer_index);
+    }
+    slot->receive_offset = offset;
+    slot->pending |= BOLT_RING_RECEIVE;
+    return 0;
+}
+
+int BoltRing_arm(struct BoltConnection * connection)
+{
+    struct BoltRing * ring = connection->ring;
+    struct BoltRingSlot * slot = connection->ring_slot;
+    int events = ((connection->awaiting & BOLT_READABLE) ? POLLIN : 0) |
+                 ((connection->awaiting & BOLT_WRITABLE) ? POLLOUT : 0);
+    if (connection->stage == BOLT_CONNECTING)
+    {
+        // Attempts come and go, so each is polled afresh; polls on closed
+        // attempts are cancelled along with the attempt
+        for (int i = 0; i < connection->n_attempts; i++)
+        {
+            if (poll_socket(ring, slot, connection->attempts[i], events) == -1)
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (((slot->requested | slot->pending) & (BOLT_RING_SEND | BOLT_RING_RECEIVE)) != 0 ||
+        BoltRing_ready(connection) || (events & ~slot->poll_events) == 0)
+    {
+        return 0;
+    }
+    if (poll_socket(ring, slot, connection->socket, events) == -1)
+    {
+        return -1;
+    }
+    slot->poll_events |= events;
+    return 0;
+}
+
+int BoltRing_ready(struct BoltConnection * connection)
+{
+    int relevant = BOLT_RING_POLL;
+    if (connection->awaiting & BOLT_READABLE)
+    {
+        relevant |= BOLT_RING_RECEIVE;
+    }
+    if (connection->awaiting & BOLT_WRITABLE)
+    {
+        relevant |= BOLT_RING_SEND;
+    }
+    return (connection->ring_slot->completed & relevant) != 0;
+}
+
+void BoltRing_cancel(struct BoltConnection * connection, int socket)
+{
+    struct BoltRing * ring = connection->ring;
+    struct BoltRingSlot * slot = connection->ring_slot;
+    if (socket == connection->socket)
+    {
+        // Nothing further is sent or received on this socket
+        slot->requested = 0;
+        slot->completed &= ~(BOLT_RING_SEND | BOLT_RING_RECEIVE);
+        slot->blocked = 0;
+        slot->registered_data = NULL;
+        slot->registered_size = 0;
+    }
+    if (slot->pending == 0 && *ring->sq_tail == __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+    struct io_uring_sqe * sqe = next_entry(ring, CANCELLATION);
+    if (sqe == NULL)
+    {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = socket;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    ring->n_cancellations += 1;
+    while (ring->n_cancellations > 0)
+    {
+        if (submit(ring, 1, -1) == -1)
+        {
+            break;
+        }
+    }
+    if (socket == connection->socket)
+    {
+        slot->completed &= ~(BOLT_RING_SEND | BOLT_RING_RECEIVE);
+    }
+}
+
+#else
+
+struct BoltRing * BoltRing_create(int entries)
+{
+    (void)(entries);
+    BoltLog_error("bolt: Rings are not supported in this build");
+    return NULL;
+}
+
+void BoltRing_destroy(struct BoltRing * ring)
+{
+    (void)(ring);
+}
+
+int BoltRing_attach(struct BoltRing * ring, struct BoltConnection * connection)
+{
+    (void)(ring);
+    (void)(connection);
+    return -1;
+}
+
+void BoltRing_detach(struct BoltConnection * connection)
+{
+    (void)(connection);
+}
+
+int BoltRing_enter(struct BoltRing * ring, int timeout)
+{
+    (void)(ring);
+    (void)(timeout);
+    return -1;
+}
+
+void BoltRing_send(struct BoltConnection * connection, int flags)
+{
+    (void)(connection);
+    (void)(flags);
+}
+
+int BoltRing_receive(struct BoltConnection * connection, int offset, int size)
+{
+    (void)(connection);
+    (void)(offset);
+    (void)(size);
+    return -1;
+}
+
+int BoltRing_arm(struct BoltConnection * connection)
+{
+    (void)(connection);
+    return -1;
+}
+
+int BoltRing_ready(struct BoltConnection * connection)
+{
+    (void)(connection);
+    return 0;
+}
+
+void BoltRing_cancel(struct BoltConnection * connection, int socket)
+{
+    (void)(connection);
+    (void)(socket);
+}
+
+#endif // USE_IO_URING
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2002-2018 "Neo Technology,"
+ * Network Engine for Objects in Lund AB [http://neotechnology.com]
+ *
+ * This file is part of Neo4j.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "bolt/config-impl.h"
+#include "bolt/logging.h"
+#include "bolt/mem.h"
+#include "bolt/security.h"
+
+
+static pthread_mutex_t default_context_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct BoltSecurityContext * default_context = NULL;
+
+static pthread_once_t server_index_once = PTHREAD_ONCE_INIT;
+static int server_index = -1;
+
+
+void free_server(void * parent, void * server, CRYPTO_EX_DATA * data, int index, long arg_l, void * arg_p)
+{
+    if (server != NULL)
+    {
+        BoltMem_deallocate(server, strlen(server) + 1);
+    }
+}
+
+void create_server_index()
+{
+    server_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, free_server);
+}
+
+
+/**
+ * Find the position in the session cache for a given server, claiming
+ * a new position if the server has not been seen before.
+ *
+ * @param context
+ * @param server
+ * @return position within the session cache
+ */
+int find_session(struct BoltSecurityContext * context, const char * server)
+{
+    for (int i = 0; i < context->n_sessions; i++)
+    {
+        if (strcmp(context->sessions[i].server, server) == 0)
+        {
+            return i;
+        }
+    }
+    int index = context->next_session;
+    struct BoltCachedSession * entry = &context->sessions[index];
+    if (index < context->n_sessions)
+    {
+        // Evict the oldest server
+        BoltMem_deallocate(entry->server, strlen(entry->server) + 1);
+        if (entry->session != NULL)
+        {
+            SSL_SESSION_free(entry->session);
+        }
+    }
+    else
+    {
+        context->n_sessions += 1;
+    }
+    size_t server_size = strlen(server) + 1;
+    entry->server = BoltMem_allocate(server_size);
+    memcpy(entry->server, server, server_size);
+    entry->session = NULL;
+    context->next_session = (index + 1) % BOLT_MAX_CACHED_SESSIONS;
+    return index;
+}
+
+/**
+ * Callback invoked by OpenSSL whenever a new session is established
+ * for a client connection. For TLS 1.3, this happens after the
+ * handshake, when the server sends a session ticket.
+ *
+ * @param ssl
+ * @param session
+ * @return 1 to retain the session reference
+ */
+int new_session(SSL * ssl, SSL_SESSION * session)
+{
+    struct BoltSecurityContext * context = SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+    const char * server = SSL_get_ex_data(ssl, server_index);
+    if (context == NULL || server == NULL)
+    {
+        return 0;
+    }
+    pthread_mutex_lock(&context->mutex);
+    struct BoltCachedSession * entry = &context->sessions[find_session(context, server)];
+    if (entry->session != NULL)
+    {
+        SSL_SESSION_free(entry->session);
+    }
+    entry->session = session;
+    pthread_mutex_unlock(&context->mutex);
+    return 1;
+}
+
+struct BoltSecurityContext * BoltSecurityContext_create()
+{
+    pthread_once(&server_index_once, create_server_index);
+    SSL_CTX * ssl_context = SSL_CTX_new(TLS_client_method());
+    if (ssl_context == NULL)
+    {
+        BoltLog_error("bolt: Unable to create TLS context");
+        return NULL;
+    }
+    // The trust store is loaded once here and shared by all connections
+    if (SSL_CTX_set_default_verify_paths(ssl_context) != 1)
+    {
+        BoltLog_error("bolt: Unable to load trust store");
+        SSL_CTX_free(ssl_context);
+        return NULL;
+    }
+    // TLS 1.3 is preferred as it completes the handshake a round trip sooner
+    SSL_CTX_set_min_proto_version(ssl_context, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(ssl_context, TLS1_3_VERSION);
+    SSL_CTX_set_session_cache_mode(ssl_context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ssl_context, new_session);
+    struct BoltSecurityContext * context = BoltMem_allocate(sizeof(struct BoltSecurityContext));
+    memset(context, 0, sizeof(struct BoltSecurityContext));
+    pthread_mutex_init(&context->mutex, NULL);
+    context->ssl_context = ssl_context;
+    SSL_CTX_set_app_data(ssl_context, context);
+    return context;
+}
+
+void BoltSecurityContext_destroy(struct BoltSecurityContext * context)
+{
+    if (context == NULL) return;
+    for (int i = 0; i < context->n_sessions; i++)
+    {
+        BoltMem_deallocate(context->sessions[i].server, strlen(context->sessions[i].server) + 1);
+        if (context->sessions[i].session != NULL)
+        {
+            SSL_SESSION_free(context->sessions[i].session);
+        }
+    }
+    SSL_CTX_free(context->ssl_context);
+    pthread_mutex_destroy(&context->mutex);
+    BoltMem_deallocate(context, sizeof(struct BoltSecurityContext));
+}
+
+int BoltSecurityContext_set_tls_versions(struct BoltSecurityContext * context, int min_version, int max_version)
+{
+    if (min_version < BOLT_TLS_1_2 || max_version > BOLT_TLS_1_3 || min_version > max_version)
+    {
+        BoltLog_error("bolt: Invalid TLS version range %04X-%04X", min_version, max_version);
+        return -1;
+    }
+    if (SSL_CTX_set_min_proto_version(context->ssl_context, min_version) != 1 ||
+        SSL_CTX_set_max_proto_version(context->ssl_context, max_version) != 1)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+void BoltSecurityContext_set_early_data(struct BoltSecurityContext * context, int enabled)
+{
+    context->early_data = enabled;
+}
+
+int BoltSecurityContext_set_kernel_tls(struct BoltSecurityContext * context, int enabled)
+{
+#ifdef SSL_OP_ENABLE_KTLS
+    if (enabled)
+    {
+        SSL_CTX_set_options(context->ssl_context, SSL_OP_ENABLE_KTLS);
+    }
+    else
+    {
+        SSL_CTX_clear_options(context->ssl_context, SSL_OP_ENABLE_KTLS);
+    }
+    return 0;
+#else
+    return enabled ? -1 : 0;
+#endif
+}
+
+struct BoltSecurityContext * BoltSecurityContext_default()
+{
+    pthread_mutex_lock(&default_context_mutex);
+    if (default_context == NULL)
+    {
+        default_context = BoltSecurityContext_create();
+    }
+    pthread_mutex_unlock(&default_context_mutex);
+    return default_context;
+}
+
+void BoltSecurityContext_destroy_default()
+{
+    pthread_mutex_lock(&default_context_mutex);
+    BoltSecurityContext_destroy(default_context);
+    default_context = NULL;
+    pthread_mutex_unlock(&default_context_mutex);
+}
+
+struct ssl_st * BoltSecurityContext_create_ssl(struct BoltSecurityContext * context, const char * server)
+{
+    SSL * ssl = SSL_new(context->ssl_context);
+    if (ssl == NULL)
+    {
+        return NULL;
+    }
+    pthread_mutex_lock(&context->mutex);
+    struct BoltCachedSession * entry = &context->sessions[find_session(context, server)];
+    if (entry->session != NULL)
+    {
+        SSL_set_session(ssl, entry->session);
+    }
+    pthread_mutex_unlock(&context->mutex);
+    // Identify the server when a new session arrives, which for TLS 1.3
+    // can be at any point during the connection
+    size_t server_size = strlen(server) + 1;
+    char * server_copy = BoltMem_allocate(server_size);
+    memcpy(server_copy, server, server_size);
+    SSL_set_ex_data(ssl, server_index, server_copy);
+    return ssl;
+}
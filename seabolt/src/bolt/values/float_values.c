@@ -33,7 +33,7 @@ void BoltValue_to_Float64Array(struct BoltValue* value, double * data, int32_t l
     if (length <= sizeof(value->data) / sizeof(double))
     {
         _format(value, BOLT_FLOAT64_ARRAY, 0, length, NULL, 0);
-        memcpy(value->data.as_double, data, (size_t)(length));
+        memcpy(value->data.as_double, data, sizeof_n(double, length));
     }
     else
     {
@@ -48,7 +48,7 @@ void BoltValue_to_Int16Array(struct BoltValue* value, int16_t* data, int32_t len
     if (length <= sizeof(value->data) / sizeof(int16_t))
     {
         _format(value, BOLT_INT16_ARRAY, 0, length, NULL, 0);
-        memcpy(value->data.as_int16, data, (size_t)(length));
+        memcpy(value->data.as_int16, data, sizeof_n(int16_t, length));
     }
     else
     {
@@ -61,7 +61,7 @@ void BoltValue_to_Int32Array(struct BoltValue* value, int32_t* data, int32_t len
     if (length <= sizeof(value->data) / sizeof(int32_t))
     {
         _format(value, BOLT_INT32_ARRAY, 0, length, NULL, 0);
-        memcpy(value->data.as_int32, data, (size_t)(length));
+        memcpy(value->data.as_int32, data, sizeof_n(int32_t, length));
     }
     else
     {
@@ -74,7 +74,7 @@ void BoltValue_to_Int64Array(struct BoltValue* value, int64_t* data, int32_t len
     if (length <= sizeof(value->data) / sizeof(int64_t))
     {
         _format(value, BOLT_INT64_ARRAY, 0, length, NULL, 0);
-        memcpy(value->data.as_int64, data, (size_t)(length));
+        memcpy(value->data.as_int64, data, sizeof_n(int64_t, length));
     }
     else
     {
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <bolt/values.h>
 #include "../protocol/v1.h"
+#include "../protocol/v3.h"
 #include "bolt/mem.h"
 
 
@@ -101,8 +102,11 @@ int BoltStructure_write(struct BoltValue * value, FILE * file, int32_t protocol_
     switch (protocol_version)
     {
         case 1:
+        case 2:
+        case 3:
         {
-            const char* name = BoltProtocolV1_structure_name(code);
+            const char* name = protocol_version == 1 ? BoltProtocolV1_structure_name(code)
+                                                     : BoltProtocolV3_structure_name(code);
             fprintf(file, "&%s", name);
             break;
         }
@@ -126,8 +130,11 @@ int BoltStructureArray_write(struct BoltValue * value, FILE * file, int32_t prot
     switch (protocol_version)
     {
         case 1:
+        case 2:
+        case 3:
         {
-            const char* name = BoltProtocolV1_structure_name(code);
+            const char* name = protocol_version == 1 ? BoltProtocolV1_structure_name(code)
+                                                     : BoltProtocolV3_structure_name(code);
             if (name == NULL)
             {
                 fprintf(file, "&#%c%c%c%c", hex3(&code, 0), hex2(&code, 0), hex1(&code, 0), hex0(&code, 0));
@@ -162,8 +169,11 @@ int BoltMessage_write(struct BoltValue * value, FILE * file, int32_t protocol_ve
     switch (protocol_version)
     {
         case 1:
+        case 2:
+        case 3:
         {
-            const char* name = BoltProtocolV1_message_name(code);
+            const char* name = protocol_version == 3 ? BoltProtocolV3_message_name(code)
+                                                     : BoltProtocolV1_message_name(code);
             if (name == NULL)
             {
                 fprintf(file, "msg<#%c%c>", hex1(&code, 0), hex0(&code, 0));
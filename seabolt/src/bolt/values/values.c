@@ -123,6 +123,14 @@ void _resize(struct BoltValue* value, int32_t size, int multiplier)
     }
 }
 
+void _exchange(struct BoltValue* value, struct BoltValue* other)
+{
+    struct BoltValue x;
+    memcpy(&x, value, sizeof(struct BoltValue));
+    memcpy(value, other, sizeof(struct BoltValue));
+    memcpy(other, &x, sizeof(struct BoltValue));
+}
+
 struct BoltValue* BoltValue_create()
 {
     size_t size = sizeof(struct BoltValue);